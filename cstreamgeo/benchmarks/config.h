@@ -0,0 +1,2 @@
+#define BENCHMARK_DATA_DIR "/root/repo/cstreamgeo/benchmarks/realdata/"
+#define TEST_DATA_DIR "/root/repo/cstreamgeo/tests/testdata/"
@@ -2,6 +2,8 @@
 #define CSTREAMGEO_H
 
 #include <stddef.h>
+#include <cstreamgeo/stridedmask.h>
+#include <cstreamgeo/workspace.h>
 
 /* ---------------- Core data structure types ---------------- */
 
@@ -22,6 +24,34 @@ typedef struct {
     float cost;          // Result of aligning two streams.
 } warp_summary_t;
 
+typedef struct {
+    size_t start;        // Index of the first point of the longer stream covered by the match.
+    size_t end;          // Index of the last point of the longer stream covered by the match (inclusive).
+    float cost;          // DTW cost of aligning the whole shorter stream to points [start, end] of the longer one.
+} subsequence_match_t;
+
+typedef struct dtw_stream_state dtw_stream_state_t;
+
+typedef struct {
+    size_t evaluated;               // Pairs passed to `similarity`.
+    size_t rejected_improper;       // Pairs where a stream has fewer than two points.
+    size_t rejected_distance_ratio; // Pairs whose stream lengths differ too much.
+    size_t rejected_bounding_box;   // Pairs whose bounding boxes are too far apart (`similarity_strict` only).
+    size_t rejected_lb_kim;         // Pairs rejected on start/mid/end points, or min/max extents when strict.
+    size_t rejected_lb_keogh;       // Pairs rejected against the query envelope (`similarity_strict` only).
+    size_t aligned;                 // Pairs that survived every tier and were aligned with FastDTW.
+} similarity_stats_t;
+
+typedef enum {
+    ALIGNMENT_FULL,      // Exact O(M*N) dynamic timewarping.
+    ALIGNMENT_FAST       // Approximate FastDTW with a caller-provided radius.
+} alignment_mode_t;
+
+typedef enum {
+    PATH_RECOVERY_TABLE,        // Trace back through the full M*N table: fastest, O(M*N) memory.
+    PATH_RECOVERY_LINEAR_SPACE  // Hirschberg divide and conquer: about twice the time, O(M+N) memory.
+} path_recovery_t;
+
 
 /* ---------------- Stream Utility Functions ---------------- */
 
@@ -92,6 +122,14 @@ float stream_distance(const stream_t* stream);
  */
 float* stream_sparsity_create(const stream_t *stream);
 
+/**
+ * Same as `stream_sparsity_create`, but allocates from a workspace (see workspace.h).
+ * @param stream
+ * @param ws Workspace, or NULL for the heap
+ * @return Outputs sparsity data. Release with `streamgeo_workspace_free(ws, ...)`.
+ */
+float* stream_sparsity_create_ws(const stream_t *stream, streamgeo_workspace_t* ws);
+
 /**
  * Returns the COST of the optimal alignment of stream `a` to stream `b`, but not the path.
  * Uses an approach that is O(M*N) in TIME but only O(max(M, N)) in space - we can get away
@@ -103,6 +141,45 @@ float* stream_sparsity_create(const stream_t *stream);
  */
 float full_dtw_cost(const stream_t* a, const stream_t* b);
 
+/**
+ * Returns the COST of the optimal alignment of stream `a` to stream `b` if it is at most `cutoff`, and +INFINITY otherwise.
+ * Abandons early as soon as every cell in the current row of the DP exceeds `cutoff`: every warp path passes through
+ * every row, so no alignment can finish below the cutoff from there. Useful for threshold and nearest-neighbour
+ * queries, where `cutoff` is the threshold (or the best cost found so far).
+ * O(M*N) in TIME in the worst case, O(N) in space.
+ * @param a First input stream
+ * @param b Second input stream
+ * @param cutoff Largest cost of interest
+ * @return The cost of aligning the two streams, or INFINITY if it exceeds `cutoff`.
+ */
+float full_dtw_cost_bounded(const stream_t* a, const stream_t* b, const float cutoff);
+
+/**
+ * Returns the COST of the optimal alignment of stream `a` to stream `b` among warp paths that stay inside `window`,
+ * e.g. a Sakoe-Chiba band or Itakura parallelogram (see stridedmask.h). The result is never below `full_dtw_cost`,
+ * and equals it when the optimal path fits in the window.
+ * O(window area) in TIME, O(N) in space.
+ * `window` must have a->n rows and b->n cols, cover cell (0, 0) and cell (a->n - 1, b->n - 1),
+ * and satisfy the strided mask invariants (see stridedmask.h).
+ * @param a First input stream
+ * @param b Second input stream
+ * @param window Search window over the (a->n x b->n) cost matrix
+ * @return The windowed cost of aligning the two streams.
+ */
+float windowed_dtw_cost(const stream_t* a, const stream_t* b, const strided_mask_t* window);
+
+/**
+ * Windowed equivalent of `full_dtw_cost_bounded`: only cells inside `window` are considered.
+ * `window` must have a->n rows and b->n cols, cover cell (0, 0) and cell (a->n - 1, b->n - 1),
+ * and satisfy the strided mask invariants (see stridedmask.h).
+ * @param a First input stream
+ * @param b Second input stream
+ * @param window Search window over the (a->n x b->n) cost matrix
+ * @param cutoff Largest cost of interest
+ * @return The windowed cost of aligning the two streams, or INFINITY if it exceeds `cutoff`.
+ */
+float windowed_dtw_cost_bounded(const stream_t* a, const stream_t* b, const strided_mask_t* window, const float cutoff);
+
 /**
  * Returns the optimal alignment of stream `a` to stream `b`.
  * Uses the full O(M*N) dynamic timewarping algorithm.
@@ -113,6 +190,44 @@ float full_dtw_cost(const stream_t* a, const stream_t* b);
  */
 warp_summary_t* full_warp_summary_create(const stream_t *a, const stream_t *b);
 
+/**
+ * Returns the optimal alignment of stream `a` to stream `b` among warp paths that stay inside `window`
+ * (see `windowed_dtw_cost`). Memory scales with the window area rather than M*N.
+ * Allocates memory for returned warp_summary object; caller is responsible for cleanup.
+ * @param a First input stream
+ * @param b Second input stream
+ * @param window Search window over the (a->n x b->n) cost matrix
+ * @return A warp_summary object containing the warp path, number of points in the warp path, and cost of alignment.
+ */
+warp_summary_t* windowed_warp_summary_create(const stream_t *a, const stream_t *b, const strided_mask_t* window);
+
+/**
+ * Same as `full_warp_summary_create`, but every allocation, including the result, comes from a workspace
+ * (see workspace.h). The result stays valid until the workspace is reset; do not pass it to `warp_summary_destroy`.
+ * Scratch memory is handed back before returning, so the workspace only grows by the size of the result.
+ * @param a First input stream
+ * @param b Second input stream
+ * @param ws Workspace, or NULL for the heap (same as `full_warp_summary_create`)
+ * @return A warp_summary object containing the warp path, number of points in the warp path, and cost of alignment.
+ */
+warp_summary_t* full_warp_summary_create_ws(const stream_t *a, const stream_t *b, streamgeo_workspace_t* ws);
+
+/**
+ * Returns the optimal alignment of stream `a` to stream `b`, choosing how the warp path is recovered.
+ * PATH_RECOVERY_TABLE behaves exactly like `full_warp_summary_create`.
+ * PATH_RECOVERY_LINEAR_SPACE never materializes the M*N table: it splits the rows in half, finds where the optimal path
+ * crosses the split from a forward and a backward cost sweep, and recurses on the two halves. Use it for exact
+ * alignment of long streams (two 20k point streams need 1.6GB of table). The cost is identical to the table mode; the
+ * path is also optimal, but may differ from the table mode's where several paths tie.
+ * Allocates memory for returned warp_summary object; caller is responsible for cleanup.
+ * @param a First input stream
+ * @param b Second input stream
+ * @param recovery Path recovery strategy
+ * @return A warp_summary object containing the warp path, number of points in the warp path, and cost of alignment.
+ */
+warp_summary_t* full_warp_summary_create_with_recovery(const stream_t *a, const stream_t *b,
+                                                       const path_recovery_t recovery);
+
 /**
  * Returns the (approximately) optimal alignment of stream a to stream b.
  * Allocates memory; caller is responsible for cleanup.
@@ -126,20 +241,225 @@ warp_summary_t* full_warp_summary_create(const stream_t *a, const stream_t *b);
  */
 warp_summary_t* fast_warp_summary_create(const stream_t *a, const stream_t *b, const size_t radius);
 
+/**
+ * Same as `fast_warp_summary_create`, but every allocation, including the result, comes from a workspace
+ * (see workspace.h). The result stays valid until the workspace is reset; do not pass it to `warp_summary_destroy`.
+ * Scratch memory is handed back before returning, so the workspace only grows by the size of the result.
+ * @param a First input stream
+ * @param b Second input stream
+ * @param radius FastDTW radius
+ * @param ws Workspace, or NULL for the heap (same as `fast_warp_summary_create`)
+ * @return A warp_summary object containing the warp path, number of points in the warp path, and cost of alignment.
+ */
+warp_summary_t* fast_warp_summary_create_ws(const stream_t *a, const stream_t *b, const size_t radius,
+                                            streamgeo_workspace_t* ws);
+
+/**
+ * Finds where `segment` occurs inside `activity`: the contiguous run of activity points that `segment` aligns to
+ * most cheaply, with no penalty for the activity points before or after it (open-begin, open-end DTW).
+ * Single O(M*N) pass in TIME, O(M) in space, where M is the segment length and N the activity length.
+ * Costs are on the same scale as `full_dtw_cost`.
+ * @param segment Shorter stream to look for, must have at least one point.
+ * @param activity Longer stream to search, must have at least one point.
+ * @return The best match.
+ */
+subsequence_match_t subsequence_dtw_find(const stream_t* segment, const stream_t* activity);
+
+/**
+ * Finds up to `k` non-overlapping occurrences of `segment` inside `activity` (e.g. repeated laps), cheapest first.
+ * Every activity point is scored as a possible end of a match in one subsequence DTW pass; matches are then picked
+ * greedily by cost, skipping any that share an activity point with one already picked.
+ * O(M*N) in TIME, O(M + N) in space.
+ * @param segment Shorter stream to look for, must have at least one point.
+ * @param activity Longer stream to search, must have at least one point.
+ * @param k Maximum number of matches to return.
+ * @param matches Output buffer with room for `k` matches, sorted by increasing cost.
+ * @return Number of matches written (at most `k`).
+ */
+size_t subsequence_dtw_find_top_k(const stream_t* segment, const stream_t* activity, const size_t k,
+                                  subsequence_match_t* matches);
+
+/**
+ * Creates an incremental DTW aligner against a fixed `reference` (e.g. a segment), for activities that arrive a few
+ * points at a time. The state holds only the latest DP column: each `dtw_stream_push` costs O(M) in TIME, or
+ * O(band) with a band, where M is the reference length.
+ * With `open_begin`, the activity may contain anything before the reference starts (as in `subsequence_dtw_find`);
+ * otherwise the first pushed point is aligned to the first reference point (as in `full_dtw_cost`).
+ * With a nonzero `band`, each new point is only aligned to reference points within `band` indices of the point the
+ * previous one matched (see `dtw_stream_position`). This is a beam that follows the match, so a badly lost match is
+ * not recovered, and with `open_begin` new starts are only considered while the beam covers the start.
+ * Allocates memory; caller must clean up with `dtw_stream_destroy`.
+ * @param reference Reference stream, must have at least one point. Borrowed; must outlive the state.
+ * @param open_begin Nonzero to allow the match to start at any activity point.
+ * @param band Beam half-width in reference points, or 0 for none.
+ * @return A pointer to a new state with no activity points.
+ */
+dtw_stream_state_t* dtw_stream_create(const stream_t* reference, const int open_begin, const size_t band);
+
+/**
+ * Frees the memory allocated by `state` (but not its reference).
+ * @param state
+ */
+void dtw_stream_destroy(dtw_stream_state_t* state);
+
+/**
+ * Appends one activity point and advances the DP by one column.
+ * @param state
+ * @param lat Latitude of the new point
+ * @param lng Longitude of the new point
+ */
+void dtw_stream_push(dtw_stream_state_t* state, const float lat, const float lng);
+
+/**
+ * Cost of aligning the whole reference to the activity so far, ending at the latest point. Without `open_begin` and
+ * band, this equals `full_dtw_cost(reference, activity)`.
+ * @param state
+ * @return The cost, or INFINITY if no such alignment exists yet (or it lies outside the band).
+ */
+float dtw_stream_cost(const dtw_stream_state_t* state);
+
+/**
+ * Index of the reference point the latest activity point is matched to: the cheapest cell of the latest DP column.
+ * @param state
+ */
+size_t dtw_stream_position(const dtw_stream_state_t* state);
+
+/**
+ * Cheapest complete match of the reference seen so far, over every prefix of the activity. Its `cost` is INFINITY
+ * until the reference has been matched once.
+ * @param state
+ */
+subsequence_match_t dtw_stream_best_match(const dtw_stream_state_t* state);
+
 /**
  * Establishes a "common-sense" distance metric on two streams.
  * Larger values for radius lead to slower code, but more accurate DTW alignment.
  * radius=0 and radius=1 are quite inaccurate;
  * radius=8 is O(3%) error on random (correlated) streams of size 1000 or so.
- * Short circuits on common cases.
+ * Short circuits to zero, without aligning, on improper streams, badly mismatched lengths, and start, middle or end
+ * points further apart than 30% of the shorter stream's length (see `similarity_stats_get`).
  * @param a First input stream
  * @param b Second input stream
  * @return Value of similarity metric on the two input streams.
  */
 float similarity(const stream_t *a, const stream_t *b, const size_t radius);
 
+/**
+ * Same as `similarity`, except that a pair also scores zero when any pair of points that a band-constrained
+ * alignment would match is provably further apart than the same 30% tolerance: the bounding box gap, LB_Kim extents
+ * and LB_Keogh against an envelope of `radius` plus 10% of `a`'s length (see lowerbound.h).
+ * This rejects far more pairs without aligning them, but a single stray point (e.g. one GPS glitch) is enough to
+ * zero a pair that `similarity` would score near 1, so only use it where one outlier should disqualify a match.
+ * @param a First input stream
+ * @param b Second input stream
+ * @param radius FastDTW radius
+ * @return Value of similarity metric on the two input streams, or zero.
+ */
+float similarity_strict(const stream_t *a, const stream_t *b, const size_t radius);
+
+/**
+ * Same as `similarity`, but all scratch memory comes from a workspace (see workspace.h) and is handed back before
+ * returning. With one workspace per thread, steady-state calls perform no heap allocations.
+ * @param a First input stream
+ * @param b Second input stream
+ * @param radius FastDTW radius
+ * @param ws Workspace, or NULL for the heap (same as `similarity`)
+ * @return Value of similarity metric on the two input streams.
+ */
+float similarity_ws(const stream_t *a, const stream_t *b, const size_t radius, streamgeo_workspace_t* ws);
+
+/**
+ * Computes `similarity(query, candidates->data[i], radius)` for every candidate, writing the result to `out[i]`.
+ * The query's length, sparsity, positional weights and FastDTW coarsening pyramid are computed once and shared by
+ * every candidate; candidates are scored in parallel, each thread drawing scratch memory from its own workspace.
+ * Results are identical to calling `similarity` on each pair, and count towards `similarity_stats_get`.
+ * @param query Query stream (e.g. a segment)
+ * @param candidates Streams to compare against the query (e.g. efforts)
+ * @param radius FastDTW radius, as for `similarity`
+ * @param out Output buffer with room for `candidates->n` floats
+ * @param nthreads Number of threads to use; 0 uses every online CPU
+ */
+void similarity_batch(const stream_t* query, const stream_collection_t* candidates, const size_t radius, float* out,
+                      const size_t nthreads);
+
+/**
+ * Reads the process-wide counters of the `similarity` rejection cascade.
+ * Before aligning, `similarity` runs a tiered cascade of cheap checks (distance ratio, then start/mid/end points) and
+ * returns zero as soon as one tier rejects a pair; `similarity_strict` adds the bounding box, LB_Kim extent and
+ * LB_Keogh tiers (see lowerbound.h).
+ * The counters record how many pairs each tier rejected. They are updated atomically, so they may be read while
+ * other threads are calling `similarity`.
+ * @param stats Filled with the current counter values.
+ */
+void similarity_stats_get(similarity_stats_t* stats);
+
+/**
+ * Resets all `similarity` cascade counters to zero.
+ */
+void similarity_stats_reset();
+
 void warp_summary_destroy(const warp_summary_t* warp_summary);
 
+/* ---------------- Shape Similarity Metrics ---------------- */
+
+/**
+ * Returns the directed Hausdorff distance from `a` to `b`: the largest distance from a point of `a` to its nearest
+ * point of `b`, in degrees. Not symmetric.
+ * Points of `a` are visited in a fixed pseudo-random order, and each one's search of `b` stops as soon as it finds a
+ * point closer than the running maximum (Taha & Hanbury), since that point can no longer raise the result. `b` is
+ * bucketed into a uniform grid searched outwards from the query point, so near neighbours are found first and the
+ * typical case runs in near-linear time; the worst case is still O(M*N).
+ * @param a Source stream
+ * @param b Target stream
+ * @return The directed Hausdorff distance; 0 if `a` is empty, +INFINITY if only `b` is.
+ */
+float directed_hausdorff_distance(const stream_t* a, const stream_t* b);
+
+/**
+ * Returns the (symmetric) Hausdorff distance between `a` and `b`, the larger of the two directed distances.
+ * Much cheaper than any DTW, and a lower bound on how far apart any alignment must place some pair of points, which
+ * makes it a useful prefilter as well as a shape metric in its own right.
+ * @param a First input stream
+ * @param b Second input stream
+ * @return The Hausdorff distance in degrees.
+ */
+float hausdorff_distance(const stream_t* a, const stream_t* b);
+
+/**
+ * Returns the discrete Frechet distance between `a` and `b` in degrees: over all monotone alignments (the same warp
+ * paths DTW considers), the smallest possible largest distance between aligned points. Where DTW sums, Frechet takes
+ * the worst point, which answers "did this follow the route" rather than "how closely on average".
+ * O(M*N) in TIME, O(min(M, N)) in space.
+ * @param a First input stream
+ * @param b Second input stream
+ * @return The discrete Frechet distance; +INFINITY if either stream is empty.
+ */
+float discrete_frechet_distance(const stream_t* a, const stream_t* b);
+
+/**
+ * Decides whether `discrete_frechet_distance(a, b) <= epsilon` (up to float rounding at the boundary) without
+ * computing it.
+ * Rejects cheaply when the endpoints are too far apart or either bounding box, grown by epsilon, fails to cover the
+ * other. Otherwise sweeps the rows of the free space keeping only the span of cells reachable from the start, which
+ * is usually a narrow band, and gives up as soon as a row has none. Far cheaper than the exact distance in bulk.
+ * @param a First input stream
+ * @param b Second input stream
+ * @param epsilon Distance threshold, in degrees
+ * @return 1 if the streams are within `epsilon` of each other, 0 otherwise.
+ */
+int frechet_within(const stream_t* a, const stream_t* b, const float epsilon);
+
+/**
+ * Same as `frechet_within`, but only alignments whose path stays inside `window` are considered (see stridedmask.h),
+ * e.g. a Sakoe-Chiba band to forbid large time offsets.
+ * @param a First input stream (rows of the window)
+ * @param b Second input stream (columns of the window)
+ * @param window Mask of allowed cells; must have a->n rows and b->n columns
+ * @param epsilon Distance threshold, in degrees
+ * @return 1 if some path inside the window keeps every aligned pair within `epsilon`, 0 otherwise.
+ */
+int frechet_within_windowed(const stream_t* a, const stream_t* b, const strided_mask_t* window, const float epsilon);
+
 /* ---------------- Stream Resampling Routines ---------------- */
 
 
@@ -152,13 +472,40 @@ void warp_summary_destroy(const warp_summary_t* warp_summary);
 void downsample_rdp(stream_t *input, const float epsilon);
 
 /**
- * NOT YET IMPLEMENTED
- * Downsamples a stream quickly with O(n) radial-distance simplification.
- * @paramm input Stream to downsample
+ * Downsamples a stream quickly with O(n) radial-distance simplification: walking the stream, a point is kept when it
+ * lies more than epsilon from the last kept point. The first and last points are always kept.
+ * Much cheaper than RDP, and a good pre-pass for it on densely sampled streams.
+ * Allocates memory for simplified stream object; caller must clean up.
+ * @param input Stream to downsample
  * @param epsilon Threshold for keeping points (points kept if distance exceeds epsilon)
  * @return Downsampled stream
  */
-// stream_t* downsample_radial_distance(const stream_t* input, const float epsilon);
+stream_t* downsample_radial_distance(const stream_t* input, const float epsilon);
+
+/**
+ * Same as `downsample_radial_distance`, but simplifies `input` in place, like `downsample_rdp`.
+ * @param input Stream to downsample
+ * @param epsilon Threshold for keeping points (points kept if distance exceeds epsilon)
+ */
+void downsample_radial_distance_in_place(stream_t* input, const float epsilon);
+
+/**
+ * Applies `downsample_radial_distance_in_place` to every stream of a collection, in parallel.
+ * @param collection Streams to downsample
+ * @param epsilon Threshold for keeping points (points kept if distance exceeds epsilon)
+ * @param nthreads Number of threads to use; 0 uses every online CPU
+ */
+void downsample_radial_distance_collection(stream_collection_t* collection, const float epsilon, const size_t nthreads);
+
+/**
+ * Downsamples a stream in place to at most `k` points with Visvalingam-Whyatt simplification: repeatedly drops the
+ * point whose triangle with its two neighbours has the smallest area. Unlike `downsample_rdp`, the size of the result
+ * is known up front, which bounds the cost of aligning it. The first and last points are always kept, so streams
+ * never shrink below two points. O(n log n).
+ * @param input Stream to downsample
+ * @param k Maximum number of points to keep
+ */
+void downsample_to_count(stream_t* input, const size_t k);
 
 /**
  * NOT YET IMPLEMENTED
@@ -175,21 +522,62 @@ void downsample_rdp(stream_t *input, const float epsilon);
 /* ---------------- Operations on Stream Collections ---------------- */
 
 
+/**
+ * Computes the DTW cost between every pair of streams in a collection, in parallel.
+ * Pairs are spread over `nthreads` threads with work stealing, since pair costs vary wildly with stream lengths.
+ * In ALIGNMENT_FAST mode each stream's coarsening pyramid is built once and shared by all of its pairs.
+ * The result is a heap-allocated, packed upper triangle of n*(n-1)/2 floats: the cost of pair (i, j), i < j, is at
+ * index `pairwise_cost_index(n, i, j)`. Use `pairwise_cost_get` for symmetric lookups (the diagonal is zero).
+ * Allocates memory; caller is responsible for cleanup with free().
+ * @param collection Input streams
+ * @param mode ALIGNMENT_FULL for exact costs, ALIGNMENT_FAST for FastDTW costs
+ * @param radius FastDTW radius; ignored in ALIGNMENT_FULL mode
+ * @param nthreads Number of threads to use; 0 uses every online CPU
+ * @return Packed upper triangle of pairwise costs.
+ */
+float* pairwise_cost_matrix(const stream_collection_t* collection, const alignment_mode_t mode, const size_t radius,
+                            const size_t nthreads);
+
+/**
+ * Index of the cost of pair (i, j), i != j, in a packed matrix from `pairwise_cost_matrix` over n streams.
+ * @param n Number of streams in the collection
+ * @param i Index of one stream
+ * @param j Index of the other stream
+ * @return Offset into the packed upper triangle.
+ */
+size_t pairwise_cost_index(const size_t n, const size_t i, const size_t j);
+
+/**
+ * Symmetric lookup into a packed matrix from `pairwise_cost_matrix`; returns 0 when i == j.
+ * @param costs Packed upper triangle
+ * @param n Number of streams in the collection
+ * @param i Index of one stream
+ * @param j Index of the other stream
+ * @return The cost of aligning streams i and j.
+ */
+float pairwise_cost_get(const float* costs, const size_t n, const size_t i, const size_t j);
+
 /**
  * Computes the index of the "most median" element of a stream collection.
  * @param input Pointer to a stream collection
  * @param approximate Flag to use fast_dtw instead of full_dtw.
  *        If "approx" flag is set to 1, computes alignment with radius set to ceil(max(stream_length)^(0.25))
  *        Otherwise                   , computes full alignment.
+ *        Costs are computed in parallel on all online CPUs with `pairwise_cost_matrix`.
  * @return An index into the stream_collection_t that selects the (previously existing) "most representative" element from the stream collection.
  */
 size_t medoid_consensus(const stream_collection_t* input, const int approximate);
 
 /**
- * Allocates space for, constructs, and returns a pointer to a synthetic "optimal element" for a
+ * Allocates space for, constructs, and returns a pointer to a synthetic "optimal element" for a collection, using
+ * DTW Barycenter Averaging (DBA). Starting from a copy of the first stream, each iteration aligns every member to
+ * the consensus (in parallel on all online CPUs) and moves each consensus point to the mean of the member points
+ * aligned to it. The consensus has as many points as the first stream.
+ * Allocates memory for the consensus; caller must clean up.
  * @param input Pointer to a stream collection
  * @param approxmiate Flag to use fast_dtw instead of full_dtw.
  *        If "approx" flag is set, computes alignment with radius set to ceil(max(stream_length)^(0.25))
+ * @param iterations Number of DBA refinement iterations.
  * @return A stream_t object that represents a (newly synthesized) "most representative" element from the stream collection.
  */
 stream_t* dba_consensus(const stream_collection_t* input, const int approximate, const size_t iterations);
@@ -0,0 +1,97 @@
+#ifndef GEOHASH_H
+#define GEOHASH_H
+
+#include <stdint.h>
+#include <cstreamgeo/cstreamgeo.h>
+
+/**
+ * Geohashes: a cell of a recursively bisected lat/lng grid, named by interleaving longitude and latitude bits
+ * (longitude first) and writing them five at a time in base 32. A length-K geohash has 5K bits; K = 7 is about a
+ * 150m square, K = 5 about 5km.
+ *
+ * Hashes are passed around as integers holding the 5K bits right-aligned, which sort in the same order as their
+ * strings and make "same cell" an integer comparison. Convert with `geohash_to_string` / `geohash_from_string`.
+ */
+
+#define GEOHASH_MAX_PRECISION 12
+
+typedef struct {
+    uint64_t* cells;     // Sorted, distinct geohashes of the cells a stream passes through.
+    size_t n;            // Number of cells.
+    size_t precision;    // Geohash length K of every cell.
+} geohash_cells_t;
+
+/**
+ * Geohash of a single point.
+ * @param lat Latitude in [-90, 90]
+ * @param lng Longitude in [-180, 180]
+ * @param precision Geohash length K, in [1, GEOHASH_MAX_PRECISION]
+ */
+uint64_t geohash_encode(const float lat, const float lng, const size_t precision);
+
+/**
+ * Geohash of every point of `stream`. Uses BMI2 bit deposit where the CPU supports it.
+ * @param stream Input stream
+ * @param precision Geohash length K, in [1, GEOHASH_MAX_PRECISION]
+ * @param out Output buffer with room for `stream->n` hashes
+ */
+void geohash_encode_stream(const stream_t* stream, const size_t precision, uint64_t* out);
+
+/**
+ * Center of a geohash cell.
+ * @param hash
+ * @param precision Geohash length K the hash was encoded with
+ * @param lat Receives the latitude of the cell center
+ * @param lng Receives the longitude of the cell center
+ */
+void geohash_decode(const uint64_t hash, const size_t precision, float* lat, float* lng);
+
+/**
+ * Writes the base 32 string of a geohash.
+ * @param hash
+ * @param precision Geohash length K
+ * @param out Output buffer with room for `precision + 1` characters; NUL-terminated.
+ */
+void geohash_to_string(const uint64_t hash, const size_t precision, char* out);
+
+/**
+ * Parses a base 32 geohash string; its length is the precision.
+ * @param text Geohash characters (lower case)
+ * @param length Number of characters, in [1, GEOHASH_MAX_PRECISION]
+ * @param hash Receives the geohash
+ * @return 1 on success, 0 if `text` is not a geohash.
+ */
+int geohash_from_string(const char* text, const size_t length, uint64_t* hash);
+
+/**
+ * Summarizes a stream as the set of geohash cells its points fall in. Two streams whose cell sets (at a precision
+ * coarser than the distances of interest) are disjoint are unlikely to align well, which makes this a cheap key for
+ * sharding collections and for prefiltering candidate pairs before any DTW.
+ * Allocates memory; caller must clean up with `geohash_cells_destroy`.
+ * @param stream Input stream
+ * @param precision Geohash length K, in [1, GEOHASH_MAX_PRECISION]
+ * @return A pointer to a geohash_cells_t object.
+ */
+geohash_cells_t* geohash_cells_create(const stream_t* stream, const size_t precision);
+
+/**
+ * Frees the memory allocated by `cells`.
+ * @param cells
+ */
+void geohash_cells_destroy(const geohash_cells_t* cells);
+
+/**
+ * Number of cells two summaries of the same precision have in common. O(a->n + b->n).
+ * @param a
+ * @param b
+ */
+size_t geohash_cells_intersection_size(const geohash_cells_t* a, const geohash_cells_t* b);
+
+/**
+ * Whether two summaries of the same precision share any cell; stops at the first one found.
+ * @param a
+ * @param b
+ */
+int geohash_cells_overlap(const geohash_cells_t* a, const geohash_cells_t* b);
+
+#endif
@@ -22,15 +22,46 @@ void stream_collection_destroy(const stream_collection_t* streams);
  */
 void stream_collection_printf(const stream_collection_t* streams);
 
+/**
+ * Where and why JSON parsing failed. Lines and columns are 1-based.
+ */
+typedef struct {
+    size_t line;
+    size_t column;
+    const char* message;  // Static string; do not free.
+} json_error_t;
+
+/**
+ * Parses a single stream, a JSON list of [lat, lng] lists such as "[[37.1,-122.4],[37.2,-122.5]]".
+ * Whitespace is allowed anywhere between tokens. Decimals of up to 15 significant digits are parsed without strtof,
+ * and give the same float strtof would in the "C" locale.
+ * Allocates memory; caller must clean up with `stream_destroy`.
+ * @param text Input characters; need not be NUL-terminated
+ * @param length Number of characters in `text`
+ * @param error If not NULL, receives the position of the first problem when parsing fails
+ * @return A pointer to a stream_t object, or NULL if `text` is not exactly one well-formed stream.
+ */
+stream_t* parse_stream_from_json(const char* text, const size_t length, json_error_t* error);
+
 /**
  * Load a collection of streams from the file specified by `filename`.
  * Each line of the file is assumed to represent one stream.
  * Each line (stream) should be a list of lat/long points, represented as a list with two elements
+ * Blank lines are skipped. Malformed input is reported as "filename:line:column: message" on stdout.
  * @param filename Path to a file to load from
- * @return A pointer to a constant stream collection, containing one stream for each line in the file.
+ * @return A pointer to a constant stream collection, containing one stream for each line in the file, or NULL.
  */
 const stream_collection_t* read_streams_from_json(const char* filename);
 
+/**
+ * Same as `read_streams_from_json`, but maps the file and parses newline-aligned chunks of it on `nthreads` threads.
+ * Streams come back in line order, and errors are reported against the same line and column.
+ * @param filename Path to a file to load from
+ * @param nthreads Number of threads to use; 0 uses every online CPU
+ * @return A pointer to a constant stream collection, containing one stream for each line in the file, or NULL.
+ */
+const stream_collection_t* read_streams_from_json_parallel(const char* filename, const size_t nthreads);
+
 /**
  * NOT YET IMPLEMENTED
  * Write a collection of streams into the file at `filename`.
@@ -40,19 +71,46 @@ const stream_collection_t* read_streams_from_json(const char* filename);
  */
 void write_streams_to_json(const char* filename, const stream_collection_t* streams);
 
+/**
+ * Binary collection format, version 1. All integers are fixed width in the writer's byte order.
+ *   bytes [0, 64)    header: magic "SGEOBIN\0", uint32 version, uint32 byte order mark 0x01020304,
+ *                    uint64 stream count, uint64 index offset, uint64 data offset, zero padding.
+ *   index            one {uint64 offset, uint64 n_points} entry per stream; offsets are absolute.
+ *   data             each stream's [lat, lng] floats, starting on a 64 byte boundary.
+ * Files written before the format was versioned (a bare size_t count, then size_t length and floats per stream)
+ * are still accepted by `read_streams_from_binary`.
+ */
+
 /**
  * Read a collection of streams from the given file.
- * File format is custom binary.
+ * Accepts both the versioned binary format and the legacy unversioned one.
  * @param filename Path to a file to load from
- * @return A pointer to a constant stream collection, containing one stream for each line in the file.
+ * @return A pointer to a constant stream collection, or NULL if the file cannot be read.
  */
 const stream_collection_t* read_streams_from_binary(const char* filename);
 
 /**
- * Write a collection of streams to the given file.
+ * Write a collection of streams to the given file, in the versioned binary format.
  * @param filename Path to a file to write out.
  * @param streams A stream collection object.
  */
 void write_streams_to_binary(const char* filename, const stream_collection_t* streams);
 
+/**
+ * Maps a file written by `write_streams_to_binary` into memory without copying it.
+ * The returned streams point directly into the mapping, so pages are only read when a stream is first touched, and
+ * `collection->data[i]` gives random access to any stream. Opening costs one allocation regardless of file size.
+ * The streams are read-only and must not be passed to `stream_destroy`.
+ * Caller must clean up with `stream_collection_munmap` (NOT `stream_collection_destroy`).
+ * @param filename Path to a file to map
+ * @return A pointer to a constant stream collection, or NULL if the file is missing, legacy or malformed.
+ */
+const stream_collection_t* stream_collection_mmap(const char* filename);
+
+/**
+ * Unmaps a collection returned by `stream_collection_mmap`.
+ * @param streams
+ */
+void stream_collection_munmap(const stream_collection_t* streams);
+
 #endif
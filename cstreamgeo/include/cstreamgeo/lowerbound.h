@@ -0,0 +1,103 @@
+#ifndef LOWERBOUND_H
+#define LOWERBOUND_H
+
+#include <cstreamgeo/cstreamgeo.h>
+
+/**
+ * Cheap lower bounds on the distance between aligned points of two streams.
+ *
+ * Every function here returns a value L (in degrees) with the guarantee that any warp path aligning the two streams
+ * contains at least one pair of points (i, j) whose distance is >= L. `similarity_strict` rejects a pair outright when
+ * some aligned pair is known to be further apart than its tolerance, so these bounds let it reject without aligning.
+ * They are ordered from cheapest / weakest to most expensive / tightest:
+ *
+ *   1) Bounding box: the gap between the two bounding boxes. Every aligned pair is at least this far apart.
+ *   2) LB_Kim: first-to-first and last-to-last distances (DTW always aligns those), and the differences between the
+ *      per-coordinate extents (the point of `a` with the smallest latitude is aligned to some point of `b` whose
+ *      latitude is at least min_lat(b), and so on).
+ *   3) LB_Keogh: each point of the candidate is compared against an envelope (per-coordinate min/max over a window
+ *      of indices) of the query. This bound only holds for warp paths that stay within `window` indices of the
+ *      (length-normalized) diagonal, so it is tighter but assumes a band-constrained alignment.
+ */
+
+typedef struct {
+    float min_lat;
+    float max_lat;
+    float min_lng;
+    float max_lng;
+} bounding_box_t;
+
+typedef struct {
+    float* lower;        // Per-point lower envelope [lat0, lng0, lat1, lng1, ...]: minimum over indices [i - window, i + window]
+    float* upper;        // Per-point upper envelope, same layout: maximum over indices [i - window, i + window]
+    size_t n;            // Number of *POINTS* in the enveloped stream.
+    size_t window;       // Half-width of the envelope window, in points.
+} stream_envelope_t;
+
+/**
+ * Computes the axis-aligned bounding box of a stream.
+ * @param stream Input stream, must have at least one point.
+ * @return The bounding box.
+ */
+bounding_box_t stream_bounding_box(const stream_t* stream);
+
+/**
+ * Computes the upper/lower envelope of a stream with an O(n) sliding-window min/max.
+ * Allocates memory; caller must clean up with `stream_envelope_destroy`.
+ * @param stream Input stream, must have at least one point.
+ * @param window Half-width of the window, in points.
+ * @return The envelope.
+ */
+stream_envelope_t* stream_envelope_create(const stream_t* stream, const size_t window);
+
+/**
+ * Frees the memory allocated by `envelope`.
+ * @param envelope
+ */
+void stream_envelope_destroy(const stream_envelope_t* envelope);
+
+/**
+ * Same as `stream_envelope_create`, but allocates from a workspace (see workspace.h).
+ * @param stream Input stream, must have at least one point.
+ * @param window Half-width of the window, in points.
+ * @param ws Workspace, or NULL for the heap
+ * @return The envelope.
+ */
+stream_envelope_t* stream_envelope_create_ws(const stream_t* stream, const size_t window, streamgeo_workspace_t* ws);
+
+/**
+ * Destroys an envelope created with `stream_envelope_create_ws` on the same workspace.
+ * @param envelope
+ * @param ws Workspace the envelope came from, or NULL for the heap
+ */
+void stream_envelope_destroy_ws(const stream_envelope_t* envelope, streamgeo_workspace_t* ws);
+
+/**
+ * Lower bound from bounding boxes: the gap between the two boxes (zero if they overlap).
+ * @param a Bounding box of the first stream
+ * @param b Bounding box of the second stream
+ * @return Lower bound on the distance of every aligned pair of points.
+ */
+float lb_bounding_box(const bounding_box_t* a, const bounding_box_t* b);
+
+/**
+ * LB_Kim lower bound on the largest distance between aligned points, from the first/last points and the min/max extents.
+ * @param a First input stream
+ * @param a_box Bounding box of `a` (see `stream_bounding_box`)
+ * @param b Second input stream
+ * @param b_box Bounding box of `b`
+ * @return Lower bound on the largest distance between aligned points.
+ */
+float lb_kim(const stream_t* a, const bounding_box_t* a_box, const stream_t* b, const bounding_box_t* b_box);
+
+/**
+ * LB_Keogh lower bound on the largest distance between aligned points, for warp paths that stay within
+ * `envelope->window` indices of the diagonal. Candidate point j is compared to the query envelope at index
+ * round(j * (n_query - 1) / (n_candidate - 1)), so streams of different lengths are supported.
+ * @param envelope Envelope of the query stream (see `stream_envelope_create`)
+ * @param candidate Candidate stream, must have at least two points.
+ * @return Lower bound on the largest distance between aligned points.
+ */
+float lb_keogh(const stream_envelope_t* envelope, const stream_t* candidate);
+
+#endif
@@ -0,0 +1,46 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <stddef.h>
+
+/**
+ * A minimal fork-join helper for running independent tasks over an index range on a pool of threads.
+ *
+ * The range [0, n) is split into one contiguous block per thread. Each thread claims indices from the front of its
+ * own block with an atomic cursor; once its block is exhausted, it steals remaining indices from other threads'
+ * blocks using the same cursors. Tasks with wildly different costs (e.g. aligning pairs of very different lengths)
+ * are therefore balanced automatically, while threads mostly touch neighbouring indices.
+ */
+
+/**
+ * A task to run for one index.
+ * @param context Caller-provided context, shared by all tasks.
+ * @param index Index in [0, n) of this task.
+ * @param thread_id Index in [0, nthreads) of the thread running the task; handy for per-thread scratch buffers.
+ */
+typedef void (*parallel_task_t)(void* context, const size_t index, const size_t thread_id);
+
+/**
+ * Number of threads used when a caller asks for "as many as are useful" (nthreads == 0): the number of online CPUs.
+ */
+size_t parallel_default_threads();
+
+/**
+ * Runs `task` once for every index in [0, n), on `nthreads` threads (the calling thread is one of them), and
+ * returns once all tasks have finished.
+ * @param n Number of tasks
+ * @param nthreads Number of threads; 0 selects `parallel_default_threads()`. Never more than `n` threads are used.
+ * @param task Function to run for each index
+ * @param context Passed through to `task`
+ * @return The number of threads actually used, i.e. an upper bound on the `thread_id` passed to tasks, plus one.
+ */
+size_t parallel_for(const size_t n, const size_t nthreads, parallel_task_t task, void* context);
+
+/**
+ * Number of threads `parallel_for(n, nthreads, ...)` will use. Lets callers size per-thread buffers up front.
+ * @param n Number of tasks
+ * @param nthreads Requested number of threads; 0 selects `parallel_default_threads()`.
+ */
+size_t parallel_thread_count(const size_t n, const size_t nthreads);
+
+#endif
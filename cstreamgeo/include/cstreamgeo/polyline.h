@@ -0,0 +1,54 @@
+#ifndef POLYLINE_H
+#define POLYLINE_H
+
+#include <cstreamgeo/cstreamgeo.h>
+
+/**
+ * Google Encoded Polyline Algorithm Format, as produced by the Google Maps APIs.
+ * Coordinates are rounded to POLYLINE_PRECISION (1e-5 degrees, about a metre), so a stream that already has five
+ * decimal digits survives a round trip; anything finer is rounded.
+ */
+
+#define POLYLINE_PRECISION 1e5
+
+/**
+ * Decodes an encoded polyline into a stream. A fast pre-scan validates the input and counts its points, so the
+ * stream is allocated once at its final size.
+ * Allocates memory; caller must clean up with `stream_destroy`.
+ * @param polyline Encoded characters; need not be NUL-terminated
+ * @param length Number of characters in `polyline`
+ * @return A pointer to a stream_t object, or NULL if `polyline` is malformed.
+ */
+stream_t* stream_from_polyline(const char* polyline, const size_t length);
+
+/**
+ * Encodes a stream as a polyline.
+ * Allocates memory; caller must clean up with `free`.
+ * @param stream
+ * @return A NUL-terminated encoded polyline, or NULL if a coordinate is NaN, infinite, or larger in magnitude than
+ *         21474.83647 degrees (a polyline decoder's 32 bit limit).
+ */
+char* stream_to_polyline(const stream_t* stream);
+
+/**
+ * Decodes `n` NUL-terminated polylines in parallel.
+ * Allocates memory; caller must clean up with `stream_collection_destroy`.
+ * @param polylines Array of `n` encoded polylines
+ * @param n Number of polylines
+ * @param nthreads Number of threads to use; 0 uses every online CPU
+ * @return A collection with one stream per polyline, in order, or NULL if any of them is malformed.
+ */
+stream_collection_t* stream_collection_from_polylines(const char* const* polylines, const size_t n,
+                                                      const size_t nthreads);
+
+/**
+ * Encodes every stream of a collection in parallel.
+ * Allocates memory; caller must `free` each polyline and then the array.
+ * @param streams
+ * @param nthreads Number of threads to use; 0 uses every online CPU
+ * @return An array of `streams->n` NUL-terminated encoded polylines; an entry is NULL where `stream_to_polyline`
+ *         would return NULL.
+ */
+char** stream_collection_to_polylines(const stream_collection_t* streams, const size_t nthreads);
+
+#endif
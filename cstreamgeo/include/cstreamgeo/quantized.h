@@ -0,0 +1,120 @@
+#ifndef QUANTIZED_H
+#define QUANTIZED_H
+
+#include <stdint.h>
+#include <cstreamgeo/cstreamgeo.h>
+
+/**
+ * Fixed-point stream encodings for memory-dense collections.
+ *
+ * A `stream_quantized_t` stores coordinates as int32 microdegrees (round(degrees * 1e6)), which is exactly the
+ * precision of our source data. A float only has a 24 bit mantissa, so above 16 degrees of latitude or longitude it
+ * cannot represent every microdegree; microdegree integers are exact everywhere, and differences between them are
+ * exact too. Conversion rounds to nearest in both directions, so:
+ *   - stream_t -> quantized -> stream_t returns the original floats wherever float spacing is at least 2 microdegrees
+ *     (|coordinate| >= 16 degrees), since the float nearest to the rounded integer is the original float;
+ *   - quantized -> stream_t -> quantized returns the original integers wherever float spacing is at most
+ *     1 microdegree (|coordinate| < 8 degrees).
+ * In between, and for data with more than 6 decimal digits, each conversion moves a point by at most one float ulp or
+ * half a microdegree.
+ *
+ * A `stream_delta_t` packs a quantized stream further: points are grouped in blocks of up to STREAM_DELTA_BLOCK points,
+ * each holding its first point as an int32 anchor and every other point as an int16 delta from its predecessor.
+ * A delta that does not fit in int16 (a jump of more than ~3.6km) simply starts a new block, so encoding is always
+ * lossless. Typical GPS tracks take a little over 4 bytes per point, half of `stream_t`. Delta streams are a storage
+ * format: decode them to `stream_quantized_t` to align them.
+ *
+ * The kernels below work directly on quantized streams. Coordinate differences are taken in exact integer arithmetic
+ * (SIMD where available), then scaled to degrees as floats, so costs are on the same scale as `full_dtw_cost` but are
+ * not bit-identical to it.
+ */
+
+#define STREAM_DELTA_BLOCK 64
+
+typedef struct {
+    int32_t* data;       // Stream buffer in microdegrees [lat0, lng0, lat1, lng1, ..., latN-1, lngN-1]
+    size_t n;            // Number of *POINTS* in the stream.
+} stream_quantized_t;
+
+typedef struct {
+    size_t n;            // Number of *POINTS* in the stream.
+    size_t n_blocks;     // Number of blocks.
+    size_t* starts;      // Index of the first point of each block, plus a final entry equal to n.
+    int32_t* anchors;    // First point of each block, in microdegrees [lat, lng] per block.
+    int16_t* deltas;     // Per point [lat, lng] difference from the previous point, in microdegrees; 0 for anchors.
+} stream_delta_t;
+
+/**
+ * Creates a new quantized stream with n points.
+ * Allocates memory; caller must clean up with `stream_quantized_destroy`.
+ * @param n Number of points in the stream
+ * @return A pointer to a stream_quantized_t object.
+ */
+stream_quantized_t* stream_quantized_create(const size_t n);
+
+/**
+ * Frees the memory allocated by `stream`.
+ * @param stream
+ */
+void stream_quantized_destroy(const stream_quantized_t* stream);
+
+/**
+ * Rounds every coordinate of `stream` to the nearest microdegree.
+ * Allocates memory; caller must clean up with `stream_quantized_destroy`.
+ * @param stream
+ * @return A pointer to a stream_quantized_t object.
+ */
+stream_quantized_t* stream_quantize(const stream_t* stream);
+
+/**
+ * Converts a quantized stream back to (the nearest) floats.
+ * Allocates memory; caller must clean up with `stream_destroy`.
+ * @param stream
+ * @return A pointer to a stream_t object.
+ */
+stream_t* stream_dequantize(const stream_quantized_t* stream);
+
+/**
+ * Delta-encodes a quantized stream. Lossless.
+ * Allocates memory; caller must clean up with `stream_delta_destroy`.
+ * @param stream
+ * @return A pointer to a stream_delta_t object.
+ */
+stream_delta_t* stream_delta_encode(const stream_quantized_t* stream);
+
+/**
+ * Decodes a delta-encoded stream.
+ * Allocates memory; caller must clean up with `stream_quantized_destroy`.
+ * @param stream
+ * @return A pointer to a stream_quantized_t object.
+ */
+stream_quantized_t* stream_delta_decode(const stream_delta_t* stream);
+
+/**
+ * Number of bytes `stream` occupies, including its struct.
+ * @param stream
+ */
+size_t stream_delta_size(const stream_delta_t* stream);
+
+/**
+ * Frees the memory allocated by `stream`.
+ * @param stream
+ */
+void stream_delta_destroy(const stream_delta_t* stream);
+
+/**
+ * Quantized equivalent of `stream_distance`: the length of the stream in degrees, from exact integer differences.
+ * @param stream Input stream, must have at least two points.
+ */
+float stream_quantized_distance(const stream_quantized_t* stream);
+
+/**
+ * Quantized equivalent of `full_dtw_cost`: the cost of the optimal alignment of `a` to `b`, in squared degrees.
+ * O(M*N) in TIME, O(N) in space.
+ * @param a First input stream
+ * @param b Second input stream
+ * @return The cost of aligning the two streams
+ */
+float quantized_dtw_cost(const stream_quantized_t* a, const stream_quantized_t* b);
+
+#endif
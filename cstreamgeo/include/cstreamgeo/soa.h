@@ -0,0 +1,88 @@
+#ifndef SOA_H
+#define SOA_H
+
+#include <cstreamgeo/cstreamgeo.h>
+
+/**
+ * Structure-of-arrays stream layout and SIMD kernels over it.
+ *
+ * `stream_t` interleaves [lat0, lng0, lat1, lng1, ...], so vector code has to shuffle lanes apart before doing any
+ * arithmetic. A `stream_soa_t` stores latitudes and longitudes in two separate arrays, each aligned to 64 bytes and
+ * padded to a whole number of 64-byte lines, so kernels load full vectors of either coordinate directly.
+ *
+ * Converting between the two layouts is a copy: interleaved and planar data cannot alias the same memory, so true
+ * zero-copy conversion is not possible. The copy is O(n), done once, and cheap next to any O(n*m) alignment.
+ *
+ * Kernels pick the widest instruction set the running CPU supports (SSE4.1, AVX2, AVX-512) at runtime, like the DTW
+ * cost kernels, so a portable build still benefits.
+ */
+
+typedef struct {
+    float* lat;          // Latitudes, 64-byte aligned, padded with zeros to a multiple of 16 floats
+    float* lng;          // Longitudes, same layout
+    size_t n;            // Number of *POINTS* in the stream.
+} stream_soa_t;
+
+/**
+ * Creates a new SoA stream with n points, all zero.
+ * Allocates memory; caller must clean up with `stream_soa_destroy`.
+ * @param n Number of points in the stream
+ * @return A pointer to a stream_soa_t object.
+ */
+stream_soa_t* stream_soa_create(const size_t n);
+
+/**
+ * Copies an interleaved stream into SoA layout.
+ * Allocates memory; caller must clean up with `stream_soa_destroy`.
+ * @param stream
+ * @return A pointer to a stream_soa_t object.
+ */
+stream_soa_t* stream_soa_from_stream(const stream_t* stream);
+
+/**
+ * Copies an SoA stream back into interleaved layout.
+ * Allocates memory; caller must clean up with `stream_destroy`.
+ * @param soa
+ * @return A pointer to a stream_t object.
+ */
+stream_t* stream_soa_to_stream(const stream_soa_t* soa);
+
+/**
+ * Frees the memory allocated by `soa`.
+ * @param soa
+ */
+void stream_soa_destroy(const stream_soa_t* soa);
+
+/**
+ * SIMD equivalent of `stream_distance`. Segment lengths are summed in vector lanes, so the result differs slightly
+ * from `stream_distance`; on long streams it is usually the more accurate of the two, as each lane accumulates
+ * fewer rounding errors than one long sequential float sum.
+ * @param soa Input stream, must have at least two points.
+ * @return The length of the stream in degrees.
+ */
+float stream_soa_distance(const stream_soa_t* soa);
+
+/**
+ * SIMD equivalent of `stream_sparsity_create` (see its documentation). Per-point neighbour distances are computed
+ * exactly as in `stream_sparsity_create`; the normalizing stream length comes from `stream_soa_distance`, so values
+ * differ slightly.
+ * Allocates memory for sparsity array; caller is responsible for cleanup.
+ * @param soa Input stream, must have at least two points.
+ * @return Sparsity value of each point.
+ */
+float* stream_soa_sparsity_create(const stream_soa_t* soa);
+
+/**
+ * Computes one row of DTW local costs: out[k] = squared distance from (lat, lng) to point `start + k` of `soa`,
+ * for k in [0, count). Uses the same operations as the DTW recurrences, so results are bit-identical to them.
+ * @param soa Stream whose points form the columns of the cost matrix
+ * @param lat Latitude of the row's point
+ * @param lng Longitude of the row's point
+ * @param start First column
+ * @param count Number of columns; start + count must not exceed soa->n
+ * @param out Output buffer with room for `count` floats
+ */
+void dtw_local_cost_row(const stream_soa_t* soa, const float lat, const float lng, const size_t start,
+                        const size_t count, float* out);
+
+#endif
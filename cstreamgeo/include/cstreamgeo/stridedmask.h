@@ -3,6 +3,7 @@
 
 #include <stdlib.h>
 #include <stdarg.h>
+#include <cstreamgeo/workspace.h>
 
 /**
  * A strided mask is a sparse binary matrix with specific structural constraints on allowed element configurations.
@@ -107,6 +108,16 @@ typedef struct strided_mask_s {
  */
 strided_mask_t* strided_mask_create(const size_t n_rows, const size_t n_cols);
 
+/**
+ * Same as `strided_mask_create`, but allocates from a workspace (see workspace.h); with a NULL workspace this is
+ * `strided_mask_create`.
+ * @param n_rows
+ * @param n_cols
+ * @param ws Workspace, or NULL for the heap
+ * @return An unpopulated strided mask object.
+ */
+strided_mask_t* strided_mask_create_ws(const size_t n_rows, const size_t n_cols, streamgeo_workspace_t* ws);
+
 /**
  * Creates a strided mask object from a list of start, end column indices
  * Allocates memory, caller must handle cleanup.
@@ -123,6 +134,13 @@ strided_mask_t* strided_mask_create_from_list(const size_t n_rows, const size_t
  */
 void strided_mask_destroy(const strided_mask_t* mask);
 
+/**
+ * Destroys a mask created with a `_ws` function on the same workspace. Does nothing for a workspace-backed mask.
+ * @param mask
+ * @param ws Workspace the mask came from, or NULL for the heap
+ */
+void strided_mask_destroy_ws(const strided_mask_t* mask, streamgeo_workspace_t* ws);
+
 /**
  * Prints the input mask object.
  * @param mask
@@ -205,4 +223,57 @@ size_t* strided_mask_to_index_pairs(const strided_mask_t* mask, size_t* path_len
  * @return A new, expanded mask.
  */
 strided_mask_t* strided_mask_expand(const strided_mask_t* mask, const int row_parity, const int col_parity, const size_t radius);
+
+/**
+ * Same as `strided_mask_expand`, but allocates the new mask from a workspace (see workspace.h).
+ * @param mask
+ * @param radius
+ * @param ws Workspace, or NULL for the heap
+ * @return A new, expanded mask.
+ */
+strided_mask_t* strided_mask_expand_ws(const strided_mask_t* mask, const int row_parity, const int col_parity,
+                                       const size_t radius, streamgeo_workspace_t* ws);
+
+/**
+ * Creates a Sakoe-Chiba band: every row allows the columns within `band` of the diagonal from (0, 0) to
+ * (n_rows - 1, n_cols - 1). For unequal lengths the diagonal is scaled, so the band follows the stretched alignment.
+ * Runs are widened where needed so that a warp path always fits, even with band = 0 on a steep diagonal.
+ * Suitable as the window of `windowed_dtw_cost` and friends.
+ * Allocates memory, caller must handle cleanup.
+ * Example, n_rows = 5, n_cols = 9, band = 1:
+ *
+ *   0 1 2 3 4 5 6 7 8
+ * 0 * * . . . . . . .
+ * 1 . * * * . . . . .
+ * 2 . . . * * * . . .
+ * 3 . . . . . * * * .
+ * 4 . . . . . . . * *
+ *
+ * @param n_rows
+ * @param n_cols
+ * @param band Half-width of the band, in columns.
+ * @return A populated strided mask object.
+ */
+strided_mask_t* strided_mask_create_sakoe_chiba(const size_t n_rows, const size_t n_cols, const size_t band);
+
+/**
+ * Creates a Sakoe-Chiba band whose half-width is `fraction` of the longer dimension (rounded up).
+ * Allocates memory, caller must handle cleanup.
+ * @param n_rows
+ * @param n_cols
+ * @param fraction Half-width of the band, as a fraction of MAX(n_rows, n_cols); 0.1 is a common choice.
+ * @return A populated strided mask object.
+ */
+strided_mask_t* strided_mask_create_sakoe_chiba_fraction(const size_t n_rows, const size_t n_cols, const float fraction);
+
+/**
+ * Creates an Itakura parallelogram: the cells a warp path can reach if its local slope (in length-normalized
+ * coordinates) stays between 1/slope and slope. The window is narrow near both corners and widest in the middle.
+ * Allocates memory, caller must handle cleanup.
+ * @param n_rows
+ * @param n_cols
+ * @param slope Maximum slope, at least 1 (smaller values are treated as 1, i.e. the diagonal); 2 is the usual choice.
+ * @return A populated strided mask object.
+ */
+strided_mask_t* strided_mask_create_itakura(const size_t n_rows, const size_t n_cols, const float slope);
 #endif
@@ -0,0 +1,89 @@
+#ifndef WORKSPACE_H
+#define WORKSPACE_H
+
+#include <stddef.h>
+
+/**
+ * A scratch arena for the alignment pipeline.
+ *
+ * A single FastDTW alignment performs dozens of small heap allocations (pyramid levels, search windows, path masks,
+ * DP tables), and many threads calling `similarity` at once contend on the allocator. A workspace replaces all of
+ * them with bump allocation from memory the workspace already owns. Create one workspace per thread, pass it to the
+ * `_ws` variants of the alignment functions, and reset it between calls: once the workspace has grown to fit the
+ * largest problem it sees, steady-state calls perform no heap allocations at all.
+ *
+ * Memory handed out by a workspace is never freed individually. It is reclaimed all at once by
+ * `streamgeo_workspace_reset`, or back to a checkpoint by `streamgeo_workspace_release`.
+ * When a request does not fit, the workspace chains on a new block (at least double the size of the last);
+ * `streamgeo_workspace_reset` then coalesces the chain into a single block big enough for the whole high-water mark.
+ *
+ * A workspace is not thread safe: use one per thread.
+ */
+
+typedef struct streamgeo_workspace streamgeo_workspace_t;
+
+typedef struct {
+    void* block;         // Block that was current when the mark was taken
+    size_t used;         // Bytes of that block in use when the mark was taken
+} streamgeo_workspace_mark_t;
+
+/**
+ * Creates a workspace.
+ * Allocates memory; caller must clean up with `streamgeo_workspace_destroy`.
+ * @param initial_bytes Size of the first block; 0 picks a small default. The workspace grows as needed either way.
+ * @return A pointer to a new workspace.
+ */
+streamgeo_workspace_t* streamgeo_workspace_create(const size_t initial_bytes);
+
+/**
+ * Frees a workspace and all memory handed out by it.
+ * @param ws
+ */
+void streamgeo_workspace_destroy(streamgeo_workspace_t* ws);
+
+/**
+ * Reclaims all memory handed out by the workspace, coalescing its blocks into one. Everything previously allocated
+ * from the workspace (including results returned by `_ws` functions) becomes invalid.
+ * @param ws
+ */
+void streamgeo_workspace_reset(streamgeo_workspace_t* ws);
+
+/**
+ * Total number of bytes the workspace has reserved from the heap.
+ * @param ws
+ */
+size_t streamgeo_workspace_capacity(const streamgeo_workspace_t* ws);
+
+/**
+ * Allocates `bytes` bytes, aligned to 64 bytes.
+ * If `ws` is NULL, the memory comes from malloc and must be released with `streamgeo_workspace_free(NULL, ptr)`;
+ * this lets one code path serve both heap and workspace callers.
+ * @param ws Workspace, or NULL for the heap
+ * @param bytes Number of bytes
+ */
+void* streamgeo_workspace_alloc(streamgeo_workspace_t* ws, const size_t bytes);
+
+/**
+ * Releases memory from `streamgeo_workspace_alloc`. Frees it if `ws` is NULL; otherwise does nothing, since
+ * workspace memory is only reclaimed by `streamgeo_workspace_reset` or `streamgeo_workspace_release`.
+ * @param ws Workspace the memory came from, or NULL for the heap
+ * @param ptr
+ */
+void streamgeo_workspace_free(streamgeo_workspace_t* ws, void* ptr);
+
+/**
+ * Records the current allocation position, so that scratch memory used afterwards can be handed back with
+ * `streamgeo_workspace_release` without invalidating anything allocated before the mark.
+ * With a NULL workspace (plain heap allocation), marks and releases do nothing.
+ * @param ws Workspace, or NULL
+ */
+streamgeo_workspace_mark_t streamgeo_workspace_mark(const streamgeo_workspace_t* ws);
+
+/**
+ * Reclaims everything allocated since `mark` was taken. Blocks chained on since then are kept for reuse.
+ * @param ws Workspace, or NULL
+ * @param mark A mark taken on this workspace since its last reset
+ */
+void streamgeo_workspace_release(streamgeo_workspace_t* ws, const streamgeo_workspace_mark_t mark);
+
+#endif
@@ -2,6 +2,7 @@
 #include <cstreamgeo/stridedmask.h>
 #include <cstreamgeo/utilc.h>
 #include <limits.h>
+#include <stdint.h>
 #include <float.h>
 #include <math.h>
 #include <stdio.h>
@@ -9,37 +10,262 @@
 #include <stdbool.h>
 #include <string.h>
 #include <cstreamgeo/io.h>
+#include <cstreamgeo/lowerbound.h>
+#include <cstreamgeo/parallel.h>
+#include <stdatomic.h>
 
 #define PI 3.1415926535f
 
+// Below this many points on the shorter stream, the scalar row sweep beats the wavefront setup cost.
+#define WAVEFRONT_MIN_POINTS 32
+
+// The LB_Keogh tier of `similarity_strict` assumes the alignment stays within this fraction of the query length
+// (plus the FastDTW radius) of the diagonal.
+#define LB_KEOGH_WINDOW_FRACTION 0.1f
+
 typedef struct {
     float warp_cost;
     strided_mask_t* path_mask;
 } warp_info_t;
 
-void warp_info_destroy(const warp_info_t* warp) {
-    strided_mask_destroy(warp->path_mask);
-    free((void *) warp);
+// Frees a warp_info allocated from `ws` (NULL for the heap).
+void warp_info_destroy(const warp_info_t* warp, streamgeo_workspace_t* ws) {
+    strided_mask_destroy_ws(warp->path_mask, ws);
+    streamgeo_workspace_free(ws, (void *) warp);
 }
 
 
-// A method that only returns the *COST* of the alignment (full) -- saves on space if we don't need the path.
+/* ---------- Anti-diagonal (wavefront) DTW cost kernels ----------- */
+
+// Cells on the same anti-diagonal (row + col == k) do not depend on each other, so a whole diagonal can be computed
+// with independent SIMD lanes. Each diagonal is stored in a buffer indexed by (row + 1); slot 0 is a FLT_MAX sentinel.
+// For cell (i, k - i): diag = D[k-2][i-1], up = D[k-1][i-1], left = D[k-1][i].
+// Every kernel computes, for t in [0, count):
+//     out[t] = ((b_lng[t] - a_lng[t])^2 + (b_lat[t] - a_lat[t])^2) + min(diag[t], up[t], left[t])
+// with the same operation order as the scalar loop, so all kernels are bit-identical to it.
+typedef void (*_wavefront_kernel_t)(const size_t count, const float* a_lat, const float* a_lng,
+                                    const float* b_lat, const float* b_lng,
+                                    const float* diag, const float* up, const float* left, float* out);
+
+void _wavefront_kernel_scalar(const size_t count, const float* restrict a_lat, const float* restrict a_lng,
+                              const float* restrict b_lat, const float* restrict b_lng,
+                              const float* restrict diag, const float* restrict up, const float* restrict left,
+                              float* restrict out) {
+    float lat_diff, lng_diff, dt, best;
+    for (size_t t = 0; t < count; t++) {
+        lat_diff = b_lat[t] - a_lat[t];
+        lng_diff = b_lng[t] - a_lng[t];
+        dt = (lng_diff * lng_diff) + (lat_diff * lat_diff);
+        best = MIN(diag[t], MIN(up[t], left[t]));
+        out[t] = dt + best;
+    }
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+
+__attribute__((target("sse4.1")))
+void _wavefront_kernel_sse4(const size_t count, const float* restrict a_lat, const float* restrict a_lng,
+                            const float* restrict b_lat, const float* restrict b_lng,
+                            const float* restrict diag, const float* restrict up, const float* restrict left,
+                            float* restrict out) {
+    size_t t = 0;
+    for (; t + 4 <= count; t += 4) {
+        const __m128 lat_diff = _mm_sub_ps(_mm_loadu_ps(b_lat + t), _mm_loadu_ps(a_lat + t));
+        const __m128 lng_diff = _mm_sub_ps(_mm_loadu_ps(b_lng + t), _mm_loadu_ps(a_lng + t));
+        const __m128 dt = _mm_add_ps(_mm_mul_ps(lng_diff, lng_diff), _mm_mul_ps(lat_diff, lat_diff));
+        const __m128 best = _mm_min_ps(_mm_loadu_ps(diag + t), _mm_min_ps(_mm_loadu_ps(up + t), _mm_loadu_ps(left + t)));
+        _mm_storeu_ps(out + t, _mm_add_ps(dt, best));
+    }
+    _wavefront_kernel_scalar(count - t, a_lat + t, a_lng + t, b_lat + t, b_lng + t, diag + t, up + t, left + t, out + t);
+}
+
+__attribute__((target("avx2")))
+void _wavefront_kernel_avx2(const size_t count, const float* restrict a_lat, const float* restrict a_lng,
+                            const float* restrict b_lat, const float* restrict b_lng,
+                            const float* restrict diag, const float* restrict up, const float* restrict left,
+                            float* restrict out) {
+    size_t t = 0;
+    for (; t + 8 <= count; t += 8) {
+        const __m256 lat_diff = _mm256_sub_ps(_mm256_loadu_ps(b_lat + t), _mm256_loadu_ps(a_lat + t));
+        const __m256 lng_diff = _mm256_sub_ps(_mm256_loadu_ps(b_lng + t), _mm256_loadu_ps(a_lng + t));
+        const __m256 dt = _mm256_add_ps(_mm256_mul_ps(lng_diff, lng_diff), _mm256_mul_ps(lat_diff, lat_diff));
+        const __m256 best = _mm256_min_ps(_mm256_loadu_ps(diag + t),
+                                          _mm256_min_ps(_mm256_loadu_ps(up + t), _mm256_loadu_ps(left + t)));
+        _mm256_storeu_ps(out + t, _mm256_add_ps(dt, best));
+    }
+    _wavefront_kernel_sse4(count - t, a_lat + t, a_lng + t, b_lat + t, b_lng + t, diag + t, up + t, left + t, out + t);
+}
+
+__attribute__((target("avx512f")))
+void _wavefront_kernel_avx512(const size_t count, const float* restrict a_lat, const float* restrict a_lng,
+                              const float* restrict b_lat, const float* restrict b_lng,
+                              const float* restrict diag, const float* restrict up, const float* restrict left,
+                              float* restrict out) {
+    size_t t = 0;
+    for (; t + 16 <= count; t += 16) {
+        const __m512 lat_diff = _mm512_sub_ps(_mm512_loadu_ps(b_lat + t), _mm512_loadu_ps(a_lat + t));
+        const __m512 lng_diff = _mm512_sub_ps(_mm512_loadu_ps(b_lng + t), _mm512_loadu_ps(a_lng + t));
+        const __m512 dt = _mm512_add_ps(_mm512_mul_ps(lng_diff, lng_diff), _mm512_mul_ps(lat_diff, lat_diff));
+        const __m512 best = _mm512_min_ps(_mm512_loadu_ps(diag + t),
+                                          _mm512_min_ps(_mm512_loadu_ps(up + t), _mm512_loadu_ps(left + t)));
+        _mm512_storeu_ps(out + t, _mm512_add_ps(dt, best));
+    }
+    if (t < count) {
+        // Masked tail: one partial vector instead of falling through to narrower kernels.
+        const __mmask16 m = (__mmask16) ((1u << (count - t)) - 1u);
+        const __m512 lat_diff = _mm512_sub_ps(_mm512_maskz_loadu_ps(m, b_lat + t), _mm512_maskz_loadu_ps(m, a_lat + t));
+        const __m512 lng_diff = _mm512_sub_ps(_mm512_maskz_loadu_ps(m, b_lng + t), _mm512_maskz_loadu_ps(m, a_lng + t));
+        const __m512 dt = _mm512_add_ps(_mm512_mul_ps(lng_diff, lng_diff), _mm512_mul_ps(lat_diff, lat_diff));
+        const __m512 best = _mm512_min_ps(_mm512_maskz_loadu_ps(m, diag + t),
+                                          _mm512_min_ps(_mm512_maskz_loadu_ps(m, up + t), _mm512_maskz_loadu_ps(m, left + t)));
+        _mm512_mask_storeu_ps(out + t, m, _mm512_add_ps(dt, best));
+    }
+}
+
+#endif
+
+// Picks the widest kernel the running CPU supports. This is resolved at runtime rather than at compile time so
+// that a library built without -march=native (see BUILD_PORTABLE) still uses AVX2/AVX-512 where available.
+_wavefront_kernel_t _select_wavefront_kernel() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) return _wavefront_kernel_avx512;
+    if (__builtin_cpu_supports("avx2")) return _wavefront_kernel_avx2;
+    if (__builtin_cpu_supports("sse4.1")) return _wavefront_kernel_sse4;
+#endif
+    return _wavefront_kernel_scalar;
+}
+
+// Computes the DTW cost by sweeping anti-diagonals. Requires a_n <= b_n (the caller swaps; DTW cost is symmetric),
+// so the diagonal buffers are sized by the shorter stream.
+// Allocates O(a_n + b_n) scratch on the heap.
+float _full_dtw_cost_wavefront(const stream_t* restrict a, const stream_t* restrict b, const _wavefront_kernel_t kernel) {
+    const float* a_data = a->data;
+    const float* b_data = b->data;
+    const size_t a_n = a->n;
+    const size_t b_n = b->n;
+    // Layout: a_lat | a_lng | b_lat (reversed) | b_lng (reversed) | three diagonal buffers of a_n+1 cells each.
+    float* scratch = malloc((2 * a_n + 2 * b_n + 3 * (a_n + 1)) * sizeof(float));
+    float* a_lat = scratch;
+    float* a_lng = a_lat + a_n;
+    float* b_lat = a_lng + a_n;
+    float* b_lng = b_lat + b_n;
+    float* prev2 = b_lng + b_n;
+    float* prev1 = prev2 + (a_n + 1);
+    float* curr = prev1 + (a_n + 1);
+    float* tmp;
+    for (size_t i = 0; i < a_n; i++) {
+        a_lat[i] = a_data[2*i + 0];
+        a_lng[i] = a_data[2*i + 1];
+    }
+    // Reversing b makes b[k - i] contiguous in i along each diagonal k.
+    for (size_t j = 0; j < b_n; j++) {
+        b_lat[b_n - 1 - j] = b_data[2*j + 0];
+        b_lng[b_n - 1 - j] = b_data[2*j + 1];
+    }
+    for (size_t p = 0; p < 3 * (a_n + 1); p++) {
+        prev2[p] = FLT_MAX;
+    }
+    // Diagonal k = 0 is the single cell (0, 0), which has no predecessor.
+    float lat_diff = b_data[0] - a_data[0];
+    float lng_diff = b_data[1] - a_data[1];
+    prev1[1] = (lng_diff * lng_diff) + (lat_diff * lat_diff);
+
+    size_t lo, hi;
+    for (size_t k = 1; k < a_n + b_n - 1; k++) {
+        lo = (k + 1 > b_n) ? k + 1 - b_n : 0;
+        hi = MIN(k, a_n - 1);
+        // Cells of previous diagonals that fall outside the matrix were never written and still hold FLT_MAX.
+        kernel(hi - lo + 1,
+               a_lat + lo, a_lng + lo,
+               b_lat + (b_n - 1 - k + lo), b_lng + (b_n - 1 - k + lo),
+               prev2 + lo, prev1 + lo, prev1 + lo + 1,
+               curr + lo + 1);
+        tmp = prev2;
+        prev2 = prev1;
+        prev1 = curr;
+        curr = tmp;
+    }
+    const float cost = prev1[a_n];
+    free(scratch);
+    return cost;
+}
+
+// Row-by-row scalar version; used when no SIMD kernel is available, and for tiny inputs where setup dominates.
 // NOTE: allocates space for costs on the stack, assumption is that this will succeed.
+float _full_dtw_cost_rows(const stream_t* restrict a, const stream_t* restrict b) {
+    const float* a_data = a->data;
+    const float* b_data = b->data;
+    const size_t a_n = a->n;
+    const size_t b_n = b->n;
+    float prev_buffer[b_n+1];
+    float curr_buffer[b_n+1];
+    float* prev_costs = prev_buffer;
+    float* curr_costs = curr_buffer;
+    float* tmp;
+    for (size_t col = 0; col <= b_n; col++) {
+        prev_costs[col] = FLT_MAX;
+    }
+    prev_costs[0] = 0;
+    float lat_diff, lng_diff, dt;
+    float diag_cost, up_cost, left_cost;
+    for (size_t row = 0; row < a_n; row++) {
+        curr_costs[0] = FLT_MAX;
+        for (size_t col = 0; col < b_n; col++) {
+            lat_diff = b_data[2*col + 0] - a_data[2*row + 0];
+            lng_diff = b_data[2*col + 1] - a_data[2*row + 1];
+            dt =  (lng_diff * lng_diff) + (lat_diff * lat_diff);
+            diag_cost = prev_costs[col];
+            up_cost   = prev_costs[col+1];
+            left_cost = curr_costs[col];
+            if (diag_cost <= up_cost && diag_cost <= left_cost) {
+                curr_costs[col+1] = dt + diag_cost;
+            } else if (up_cost <= left_cost) {
+                curr_costs[col+1] = dt + up_cost;
+            } else {
+                curr_costs[col+1] = dt + left_cost;
+            }
+        }
+        tmp = prev_costs;
+        prev_costs = curr_costs;
+        curr_costs = tmp;
+    }
+    return prev_costs[b_n];
+}
+
+// A method that only returns the *COST* of the alignment (full) -- saves on space if we don't need the path.
+// Dispatches to the widest anti-diagonal SIMD kernel the CPU supports; falls back to the scalar row sweep.
 float full_dtw_cost(const stream_t* restrict a, const stream_t* restrict b) {
+    const _wavefront_kernel_t kernel = _select_wavefront_kernel();
+    if (kernel == _wavefront_kernel_scalar || MIN(a->n, b->n) < WAVEFRONT_MIN_POINTS) {
+        return _full_dtw_cost_rows(a, b);
+    }
+    return (a->n <= b->n) ? _full_dtw_cost_wavefront(a, b, kernel) : _full_dtw_cost_wavefront(b, a, kernel);
+}
+
+// Same row sweep as _full_dtw_cost_rows, but tracks the cheapest cell of each row: every warp path crosses every row,
+// so once a whole row exceeds `cutoff` no path can finish below it and we stop early.
+// NOTE: allocates space for costs on the stack, assumption is that this will succeed.
+float full_dtw_cost_bounded(const stream_t* restrict a, const stream_t* restrict b, const float cutoff) {
     const float* a_data = a->data;
     const float* b_data = b->data;
     const size_t a_n = a->n;
     const size_t b_n = b->n;
-    float prev_costs[b_n+1];
-    float curr_costs[b_n+1];
+    float prev_buffer[b_n+1];
+    float curr_buffer[b_n+1];
+    float* prev_costs = prev_buffer;
+    float* curr_costs = curr_buffer;
+    float* tmp;
     for (size_t col = 0; col <= b_n; col++) {
         prev_costs[col] = FLT_MAX;
     }
     prev_costs[0] = 0;
     float lat_diff, lng_diff, dt;
     float diag_cost, up_cost, left_cost;
+    float row_min;
     for (size_t row = 0; row < a_n; row++) {
         curr_costs[0] = FLT_MAX;
+        row_min = FLT_MAX;
         for (size_t col = 0; col < b_n; col++) {
             lat_diff = b_data[2*col + 0] - a_data[2*row + 0];
             lng_diff = b_data[2*col + 1] - a_data[2*row + 1];
@@ -54,19 +280,25 @@ float full_dtw_cost(const stream_t* restrict a, const stream_t* restrict b) {
             } else {
                 curr_costs[col+1] = dt + left_cost;
             }
+            row_min = MIN(row_min, curr_costs[col+1]);
         }
-        memcpy(&prev_costs, &curr_costs, (b_n+1)*sizeof(float));
+        if (row_min > cutoff) {
+            return INFINITY;
+        }
+        tmp = prev_costs;
+        prev_costs = curr_costs;
+        curr_costs = tmp;
     }
-    return curr_costs[b_n];
+    return (prev_costs[b_n] > cutoff) ? INFINITY : prev_costs[b_n];
 }
 
 // Idea for optimization: can we hand-unroll this into SSE registers with layout [cell_cost, diag_cost, up_cost, left_cost]
-warp_info_t* _full_dtw(const stream_t* restrict a, const stream_t* restrict b) {
+warp_info_t* _full_dtw(const stream_t* restrict a, const stream_t* restrict b, streamgeo_workspace_t* ws) {
     const float* a_data = a->data;
     const float* b_data = b->data;
     const size_t a_n = a->n;
     const size_t b_n = b->n;
-    float* dp_table = malloc( a_n * b_n * sizeof(float));
+    float* dp_table = streamgeo_workspace_alloc(ws, a_n * b_n * sizeof(float));
     float diag_cost, up_cost, left_cost;
     float lat_diff, lng_diff, dt;
     size_t idx;
@@ -95,7 +327,7 @@ warp_info_t* _full_dtw(const stream_t* restrict a, const stream_t* restrict b) {
     }
     size_t u = a_n - 1;
     size_t v = b_n - 1;
-    strided_mask_t* mask = strided_mask_create(a_n, b_n);
+    strided_mask_t* mask = strided_mask_create_ws(a_n, b_n, ws);
     size_t* start_cols = mask->start_cols;
     size_t* end_cols = mask->end_cols;
     start_cols[0] = 0;
@@ -118,67 +350,305 @@ warp_info_t* _full_dtw(const stream_t* restrict a, const stream_t* restrict b) {
             v -= 1;
         }
     }
-    warp_info_t* warp_info = malloc(sizeof(warp_info_t));
+    warp_info_t* warp_info = streamgeo_workspace_alloc(ws, sizeof(warp_info_t));
     warp_info->path_mask = mask;
     float final_cost = dp_table[a_n*b_n - 1];
     warp_info->warp_cost=final_cost;
-    free(dp_table);
+    streamgeo_workspace_free(ws, dp_table);
     return warp_info;
 }
 
-warp_info_t* _windowed_dtw(const stream_t* restrict a, const stream_t* restrict b, const strided_mask_t* restrict window) {
+/* ---------- Linear-space (Hirschberg) exact path recovery ----------- */
+
+// Subproblems with at most this many cells are solved with a small DP table and an ordinary traceback.
+#define HIRSCHBERG_BASE_CELLS 4096
+
+// Scratch shared by every subproblem of one _hirschberg_dtw call. Nothing here grows with a_n*b_n.
+typedef struct {
+    const float* a_data;
+    const float* b_data;
+    size_t* path_start_cols;  // Path mask being filled in, one cell at a time, in path order.
+    size_t* path_end_cols;
+    size_t last_row;          // Row of the most recently emitted cell; SIZE_MAX before the first.
+    float* forward;           // Forward costs of the split row (b_n floats).
+    float* backward;          // Backward costs of the row below the split row (b_n floats).
+    float* table;             // Base case DP table (HIRSCHBERG_BASE_CELLS floats).
+    size_t* trace;            // Base case traceback, in reverse path order.
+} _hirschberg_t;
+
+static inline float _hirschberg_dt(const _hirschberg_t* h, const size_t row, const size_t col) {
+    const float lat_diff = h->b_data[2*col + 0] - h->a_data[2*row + 0];
+    const float lng_diff = h->b_data[2*col + 1] - h->a_data[2*row + 1];
+    return (lng_diff * lng_diff) + (lat_diff * lat_diff);
+}
+
+// Cells must be emitted in path order: the first cell seen in a row starts its run, the last one ends it.
+static inline void _hirschberg_emit(_hirschberg_t* h, const size_t row, const size_t col) {
+    if (row != h->last_row) {
+        h->path_start_cols[row] = col;
+        h->last_row = row;
+    }
+    h->path_end_cols[row] = col;
+}
+
+// Fills costs[k] with the cheapest path from (r0, c0) to (r1, c0 + k), staying inside columns [c0, c1].
+void _hirschberg_forward(const _hirschberg_t* h, const size_t r0, const size_t r1, const size_t c0, const size_t c1,
+                         float* restrict costs) {
+    const size_t width = c1 - c0 + 1;
+    float diag_cost, up_cost, left_cost, dt;
+    costs[0] = _hirschberg_dt(h, r0, c0);
+    for (size_t k = 1; k < width; k++) {
+        costs[k] = costs[k-1] + _hirschberg_dt(h, r0, c0 + k);
+    }
+    for (size_t row = r0 + 1; row <= r1; row++) {
+        diag_cost = FLT_MAX;
+        for (size_t k = 0; k < width; k++) {
+            dt = _hirschberg_dt(h, row, c0 + k);
+            up_cost = costs[k];
+            left_cost = (k == 0) ? FLT_MAX : costs[k-1];
+            if (diag_cost <= up_cost && diag_cost <= left_cost) {
+                costs[k] = diag_cost + dt;
+            } else if (up_cost <= left_cost) {
+                costs[k] = up_cost + dt;
+            } else {
+                costs[k] = left_cost + dt;
+            }
+            diag_cost = up_cost;
+        }
+    }
+}
+
+// Mirror image of _hirschberg_forward: fills costs[k] with the cheapest path from (r0, c0 + k) to (r1, c1).
+void _hirschberg_backward(const _hirschberg_t* h, const size_t r0, const size_t r1, const size_t c0, const size_t c1,
+                          float* restrict costs) {
+    const size_t width = c1 - c0 + 1;
+    float diag_cost, down_cost, right_cost, dt;
+    costs[width-1] = _hirschberg_dt(h, r1, c1);
+    for (size_t k = width-1; k-- > 0;) {
+        costs[k] = costs[k+1] + _hirschberg_dt(h, r1, c0 + k);
+    }
+    for (size_t row = r1; row-- > r0;) {
+        diag_cost = FLT_MAX;
+        for (size_t k = width; k-- > 0;) {
+            dt = _hirschberg_dt(h, row, c0 + k);
+            down_cost = costs[k];
+            right_cost = (k == width-1) ? FLT_MAX : costs[k+1];
+            if (diag_cost <= down_cost && diag_cost <= right_cost) {
+                costs[k] = diag_cost + dt;
+            } else if (down_cost <= right_cost) {
+                costs[k] = down_cost + dt;
+            } else {
+                costs[k] = right_cost + dt;
+            }
+            diag_cost = down_cost;
+        }
+    }
+}
+
+// Solves a small subproblem exactly like _full_dtw, on a table whose origin is (r0, c0).
+void _hirschberg_base(_hirschberg_t* h, const size_t r0, const size_t r1, const size_t c0, const size_t c1) {
+    const size_t n_rows = r1 - r0 + 1;
+    const size_t n_cols = c1 - c0 + 1;
+    float* dp_table = h->table;
+    float diag_cost, up_cost, left_cost, dt;
+    size_t idx;
+    for (size_t row = 0; row < n_rows; row++) {
+        for (size_t col = 0; col < n_cols; col++) {
+            dt = _hirschberg_dt(h, r0 + row, c0 + col);
+            diag_cost = ( row == 0 || col == 0) ? FLT_MAX : dp_table[(row-1)*n_cols + (col-1)];
+            up_cost =   ( row == 0            ) ? FLT_MAX : dp_table[(row-1)*n_cols + (col-0)];
+            left_cost = (             col == 0) ? FLT_MAX : dp_table[(row-0)*n_cols + (col-1)];
+            idx = row*n_cols + col;
+            if (idx == 0) {
+                dp_table[idx] = dt;
+            }
+            else if (diag_cost <= up_cost && diag_cost <= left_cost) {
+                dp_table[idx] = diag_cost + dt;
+            }
+            else if (up_cost <= left_cost) {
+                dp_table[idx] = up_cost + dt;
+            }
+            else {
+                dp_table[idx] = left_cost + dt;
+            }
+        }
+    }
+    size_t u = n_rows - 1;
+    size_t v = n_cols - 1;
+    size_t length = 0;
+    h->trace[2*length + 0] = u;
+    h->trace[2*length + 1] = v;
+    length++;
+    while (u > 0 || v > 0) {
+        diag_cost = ( u == 0 || v == 0) ? FLT_MAX : dp_table[(u-1)*n_cols + (v-1)];
+        up_cost   = ( u == 0          ) ? FLT_MAX : dp_table[(u-1)*n_cols + (v-0)];
+        left_cost = (           v == 0) ? FLT_MAX : dp_table[(u-0)*n_cols + (v-1)];
+        if (diag_cost <= up_cost && diag_cost <= left_cost) {
+            u -= 1;
+            v -= 1;
+        } else if (up_cost <= left_cost) {
+            u -= 1;
+        } else {
+            v -= 1;
+        }
+        h->trace[2*length + 0] = u;
+        h->trace[2*length + 1] = v;
+        length++;
+    }
+    while (length-- > 0) {
+        _hirschberg_emit(h, r0 + h->trace[2*length + 0], c0 + h->trace[2*length + 1]);
+    }
+}
+
+// Emits an optimal path from (r0, c0) to (r1, c1). Splits the rows in half, finds the cheapest pair of cells
+// (mid, j) -> (mid + 1, j') through which a path can cross between the halves, and recurses on both sides.
+void _hirschberg_solve(_hirschberg_t* h, const size_t r0, const size_t r1, const size_t c0, const size_t c1) {
+    const size_t n_rows = r1 - r0 + 1;
+    const size_t n_cols = c1 - c0 + 1;
+    if (n_rows == 1) {
+        for (size_t col = c0; col <= c1; col++) {
+            _hirschberg_emit(h, r0, col);
+        }
+        return;
+    }
+    if (n_cols == 1) {
+        for (size_t row = r0; row <= r1; row++) {
+            _hirschberg_emit(h, row, c0);
+        }
+        return;
+    }
+    if (n_rows * n_cols <= HIRSCHBERG_BASE_CELLS) {
+        _hirschberg_base(h, r0, r1, c0, c1);
+        return;
+    }
+    const size_t mid = r0 + (n_rows - 1) / 2;
+    _hirschberg_forward(h, r0, mid, c0, c1, h->forward);
+    _hirschberg_backward(h, mid + 1, r1, c0, c1, h->backward);
+    // From (mid, c0 + k) a path steps down to (mid + 1, c0 + k) or diagonally to (mid + 1, c0 + k + 1).
+    size_t split = 0;
+    size_t next = 0;
+    float best = FLT_MAX;
+    float total;
+    for (size_t k = 0; k < n_cols; k++) {
+        const bool diagonal = (k + 1 < n_cols) && h->backward[k+1] <= h->backward[k];
+        total = h->forward[k] + (diagonal ? h->backward[k+1] : h->backward[k]);
+        if (total < best) {
+            best = total;
+            split = k;
+            next = diagonal ? k + 1 : k;
+        }
+    }
+    _hirschberg_solve(h, r0, mid, c0, c0 + split);
+    _hirschberg_solve(h, mid + 1, r1, c0 + next, c1);
+}
+
+// Exact DTW path in O(a_n + b_n) memory and roughly twice the time of _full_dtw.
+// The path is optimal, but where several paths tie it may pick a different one than _full_dtw's traceback.
+// The reported cost comes from full_dtw_cost, so it is identical to _full_dtw's.
+warp_info_t* _hirschberg_dtw(const stream_t* restrict a, const stream_t* restrict b) {
+    const size_t a_n = a->n;
+    const size_t b_n = b->n;
+    strided_mask_t* mask = strided_mask_create(a_n, b_n);
+    float* rows = malloc(2 * b_n * sizeof(float));
+    _hirschberg_t h = {
+            .a_data = a->data,
+            .b_data = b->data,
+            .path_start_cols = mask->start_cols,
+            .path_end_cols = mask->end_cols,
+            .last_row = SIZE_MAX,
+            .forward = rows,
+            .backward = rows + b_n,
+            .table = malloc(HIRSCHBERG_BASE_CELLS * sizeof(float)),
+            .trace = malloc(2 * (HIRSCHBERG_BASE_CELLS + 1) * sizeof(size_t))
+    };
+    _hirschberg_solve(&h, 0, a_n - 1, 0, b_n - 1);
+    free(rows);
+    free(h.table);
+    free(h.trace);
+    warp_info_t* warp_info = malloc(sizeof(warp_info_t));
+    warp_info->path_mask = mask;
+    warp_info->warp_cost = full_dtw_cost(a, b);
+    return warp_info;
+}
+
+// Computes prefix-summed offsets of each row of `window` into a compact banded DP table.
+// Row `r` occupies entries [offsets[r], offsets[r+1]) of the table, so cell (r, c) lives at offsets[r] + c - start_cols[r].
+// Allocates memory for the offsets from `ws`; caller is responsible for cleanup. Sets `area` to the number of cells in the window.
+size_t* _window_row_offsets(const strided_mask_t* restrict window, size_t* area, streamgeo_workspace_t* ws) {
+    const size_t n_rows = window->n_rows;
+    const size_t* start_cols = window->start_cols;
+    const size_t* end_cols = window->end_cols;
+    size_t* offsets = streamgeo_workspace_alloc(ws, (n_rows + 1) * sizeof(size_t));
+    offsets[0] = 0;
+    for (size_t row = 0; row < n_rows; row++) {
+        offsets[row + 1] = offsets[row] + (end_cols[row] - start_cols[row] + 1);
+    }
+    *area = offsets[n_rows];
+    return offsets;
+}
+
+// Same recurrence as _full_dtw, but only cells inside `window` are stored: the DP table is a compact band of
+// per-row runs addressed through prefix-summed row offsets, so memory scales with the window area rather than a_n*b_n.
+warp_info_t* _windowed_dtw(const stream_t* restrict a, const stream_t* restrict b, const strided_mask_t* restrict window,
+                           streamgeo_workspace_t* ws) {
     const float* a_data = a->data;
     const float* b_data = b->data;
     const size_t a_n = a->n;
     const size_t b_n = b->n;
     const size_t* window_start_cols = window->start_cols;
     const size_t* window_end_cols = window->end_cols;
-    float* dp_table = malloc(a_n * b_n * sizeof(float));
+    size_t area;
+    size_t* row_offsets = _window_row_offsets(window, &area, ws);
+    float* dp_table = streamgeo_workspace_alloc(ws, area * sizeof(float));
+    size_t curr_base, prev_base = 0;
     float diag_cost, up_cost, left_cost;
     float lat_diff, lng_diff, dt;
-    int prev_start_col = -1;
-    int prev_end_col = INT_MAX;
-    int start_col;
-    int end_col;
-    size_t idx;
-    for (int row = 0; row < (int) a_n; row++) {
-        start_col = (int) window_start_cols[row];
-        end_col = (int) window_end_cols[row];
-        for (int col = start_col; col <= end_col; col++) {
+    size_t prev_start_col = 0;
+    size_t prev_end_col = 0;
+    size_t start_col, end_col;
+    for (size_t row = 0; row < a_n; row++) {
+        start_col = window_start_cols[row];
+        end_col = window_end_cols[row];
+        // Cell (row, col) is stored at dp_table[curr_base + col]; unsigned wraparound keeps this exact.
+        curr_base = row_offsets[row] - start_col;
+        for (size_t col = start_col; col <= end_col; col++) {
             lat_diff = b_data[2*col + 0] - a_data[2*row + 0];
             lng_diff = b_data[2*col + 1] - a_data[2*row + 1];
             dt = (lng_diff * lng_diff) + (lat_diff * lat_diff);
-            diag_cost = ( row == 0 || col == 0 || col-1 < prev_start_col || prev_end_col < col-1) ? FLT_MAX : dp_table[(row-1)*b_n + (col-1)];
-            up_cost   = ( row == 0             || col   < prev_start_col || prev_end_col < col  ) ? FLT_MAX : dp_table[(row-1)*b_n + (col  )];
-            left_cost = (             col == 0 || col-1 < start_col      || end_col      < col-1) ? FLT_MAX : dp_table[(row  )*b_n + (col-1)];
-            idx = row*b_n + col;
-            if (idx == 0) {
-                dp_table[idx] = dt;
+            diag_cost = ( row == 0 || col == 0 || col-1 < prev_start_col || prev_end_col < col-1) ? FLT_MAX : dp_table[prev_base + col-1];
+            up_cost   = ( row == 0             || col   < prev_start_col || prev_end_col < col  ) ? FLT_MAX : dp_table[prev_base + col  ];
+            left_cost = (             col == 0 || col-1 < start_col                             ) ? FLT_MAX : dp_table[curr_base + col-1];
+            if (row == 0 && col == 0) {
+                dp_table[curr_base + col] = dt;
             }
             else if (diag_cost <= up_cost && diag_cost <= left_cost) {
-                dp_table[idx] = diag_cost + dt;
+                dp_table[curr_base + col] = diag_cost + dt;
             }
             else if (up_cost <= left_cost) {
-                dp_table[idx] = up_cost + dt;
+                dp_table[curr_base + col] = up_cost + dt;
             }
             else {
-                dp_table[idx] = left_cost + dt;
+                dp_table[curr_base + col] = left_cost + dt;
             }
         }
+        prev_base = curr_base;
         prev_start_col = start_col;
         prev_end_col = end_col;
     }
     size_t u = a_n-1;
     size_t v = b_n-1;
-    strided_mask_t* mask = strided_mask_create(a_n, b_n);
+    strided_mask_t* mask = strided_mask_create_ws(a_n, b_n, ws);
     size_t* path_start_cols = mask->start_cols;
     size_t* path_end_cols = mask->end_cols;
     path_start_cols[0] = 0;
     path_end_cols[u] = v;
+    size_t u_base, u_prev_base;
     while(u > 0 || v > 0) {
-        diag_cost = ( u == 0 || v == 0 || v-1 < window_start_cols[u-1] || window_end_cols[u-1] < v-1) ? FLT_MAX : dp_table[(u-1)*b_n + (v-1)];
-        up_cost   = ( u == 0           || v   < window_start_cols[u-1] || window_end_cols[u-1] < v  ) ? FLT_MAX : dp_table[(u-1)*b_n + (v  )];
-        left_cost = (           v == 0 || v-1 < window_start_cols[u  ] || window_end_cols[u  ] < v-1) ? FLT_MAX : dp_table[(u  )*b_n + (v-1)];
+        u_base = row_offsets[u] - window_start_cols[u];
+        u_prev_base = (u == 0) ? 0 : row_offsets[u-1] - window_start_cols[u-1];
+        diag_cost = ( u == 0 || v == 0 || v-1 < window_start_cols[u-1] || window_end_cols[u-1] < v-1) ? FLT_MAX : dp_table[u_prev_base + v-1];
+        up_cost   = ( u == 0           || v   < window_start_cols[u-1] || window_end_cols[u-1] < v  ) ? FLT_MAX : dp_table[u_prev_base + v  ];
+        left_cost = (           v == 0 || v-1 < window_start_cols[u  ] || window_end_cols[u  ] < v-1) ? FLT_MAX : dp_table[u_base + v-1];
         if (diag_cost <= up_cost && diag_cost <= left_cost) {
             path_start_cols[u] = v;
             path_end_cols[u-1] = v-1;
@@ -192,19 +662,91 @@ warp_info_t* _windowed_dtw(const stream_t* restrict a, const stream_t* restrict
             v -= 1;
         }
     }
-    warp_info_t* warp_info = malloc(sizeof(warp_info_t));
+    warp_info_t* warp_info = streamgeo_workspace_alloc(ws, sizeof(warp_info_t));
     warp_info->path_mask = mask;
-    float final_cost = dp_table[a_n * b_n - 1];
+    float final_cost = dp_table[area - 1];
     warp_info->warp_cost=final_cost;
-    free(dp_table);
+    streamgeo_workspace_free(ws, dp_table);
+    streamgeo_workspace_free(ws, row_offsets);
     return warp_info;
 }
 
-stream_t* _reduce_by_half(const stream_t* input) {
+// Cost-only windowed DTW with early abandoning. Keeps two rows of costs indexed by absolute column (O(b_n) space);
+// only the cells inside `window` are ever read or written, so stale values outside it are masked by bounds checks.
+float windowed_dtw_cost_bounded(const stream_t* restrict a, const stream_t* restrict b,
+                                const strided_mask_t* restrict window, const float cutoff) {
+    const float* a_data = a->data;
+    const float* b_data = b->data;
+    const size_t a_n = a->n;
+    const size_t b_n = b->n;
+    const size_t* window_start_cols = window->start_cols;
+    const size_t* window_end_cols = window->end_cols;
+    float* buffer = malloc(2 * b_n * sizeof(float));
+    float* prev_costs = buffer;
+    float* curr_costs = buffer + b_n;
+    float* tmp;
+    float diag_cost, up_cost, left_cost;
+    float lat_diff, lng_diff, dt;
+    float row_min;
+    size_t prev_start_col = 0;
+    size_t prev_end_col = 0;
+    size_t start_col, end_col;
+    for (size_t row = 0; row < a_n; row++) {
+        start_col = window_start_cols[row];
+        end_col = window_end_cols[row];
+        row_min = FLT_MAX;
+        for (size_t col = start_col; col <= end_col; col++) {
+            lat_diff = b_data[2*col + 0] - a_data[2*row + 0];
+            lng_diff = b_data[2*col + 1] - a_data[2*row + 1];
+            dt = (lng_diff * lng_diff) + (lat_diff * lat_diff);
+            diag_cost = ( row == 0 || col == 0 || col-1 < prev_start_col || prev_end_col < col-1) ? FLT_MAX : prev_costs[col-1];
+            up_cost   = ( row == 0             || col   < prev_start_col || prev_end_col < col  ) ? FLT_MAX : prev_costs[col  ];
+            left_cost = (             col == 0 || col-1 < start_col                             ) ? FLT_MAX : curr_costs[col-1];
+            if (row == 0 && col == 0) {
+                curr_costs[col] = dt;
+            }
+            else if (diag_cost <= up_cost && diag_cost <= left_cost) {
+                curr_costs[col] = diag_cost + dt;
+            }
+            else if (up_cost <= left_cost) {
+                curr_costs[col] = up_cost + dt;
+            }
+            else {
+                curr_costs[col] = left_cost + dt;
+            }
+            row_min = MIN(row_min, curr_costs[col]);
+        }
+        if (row_min > cutoff) {
+            free(buffer);
+            return INFINITY;
+        }
+        tmp = prev_costs;
+        prev_costs = curr_costs;
+        curr_costs = tmp;
+        prev_start_col = start_col;
+        prev_end_col = end_col;
+    }
+    const float cost = prev_costs[b_n - 1];
+    free(buffer);
+    return (cost > cutoff) ? INFINITY : cost;
+}
+
+// A stream whose struct and data come from `ws`; with a NULL workspace this is stream_create.
+stream_t* _stream_create_ws(const size_t n, streamgeo_workspace_t* ws) {
+    if (ws == NULL) {
+        return stream_create(n);
+    }
+    stream_t* stream = streamgeo_workspace_alloc(ws, sizeof(stream_t));
+    stream->n = n;
+    stream->data = streamgeo_workspace_alloc(ws, 2 * n * sizeof(float));
+    return stream;
+}
+
+stream_t* _reduce_by_half(const stream_t* input, streamgeo_workspace_t* ws) {
     const size_t input_n = input->n;
     const float* input_data = input->data;
 
-    stream_t* shrunk_stream = stream_create(input_n / 2);
+    stream_t* shrunk_stream = _stream_create_ws(input_n / 2, ws);
     float* shrunk_data = shrunk_stream->data;
 
     for (size_t i = 0; i < 2*(input_n / 2); i+=2) {
@@ -214,24 +756,58 @@ stream_t* _reduce_by_half(const stream_t* input) {
     return shrunk_stream;
 }
 
-warp_info_t* _fast_dtw(const stream_t* a, const stream_t* b, const size_t radius) {
+// Number of pyramid levels _fast_dtw needs for a stream of n points with this radius: the stream itself, then one
+// level per halving until a level is too short to recurse on. A pair of streams needs the smaller of their depths.
+size_t _pyramid_depth(size_t n, const size_t radius) {
+    size_t levels = 1;
+    for (; n >= radius + 4; n /= 2) {
+        levels++;
+    }
+    return levels;
+}
+
+// Builds the FastDTW coarsening pyramid of `stream`: levels[0] is the stream itself and each further level halves the
+// previous one. A pyramid of full depth (see _pyramid_depth) can be built once and reused against any partner.
+// Allocates memory from `ws`; caller must clean up with _pyramid_destroy.
+const stream_t** _pyramid_create(const stream_t* stream, const size_t n_levels, streamgeo_workspace_t* ws) {
+    const stream_t** pyramid = streamgeo_workspace_alloc(ws, n_levels * sizeof(stream_t*));
+    pyramid[0] = stream;
+    for (size_t level = 1; level < n_levels; level++) {
+        pyramid[level] = _reduce_by_half(pyramid[level - 1], ws);
+    }
+    return pyramid;
+}
+
+// Frees every level but the first, which belongs to the caller. Workspace-backed pyramids need no cleanup.
+void _pyramid_destroy(const stream_t** pyramid, const size_t n_levels, streamgeo_workspace_t* ws) {
+    if (ws != NULL) {
+        return;
+    }
+    for (size_t level = 1; level < n_levels; level++) {
+        stream_destroy(pyramid[level]);
+    }
+    free((void*) pyramid);
+}
+
+// FastDTW over precomputed pyramids, starting at `level`. Both pyramids must have been built with the same radius.
+// Every intermediate (windows, coarse paths, DP tables) and the result are allocated from `ws` (NULL for the heap).
+warp_info_t* _fast_dtw(const stream_t** a_pyramid, const stream_t** b_pyramid, const size_t level, const size_t radius,
+                       streamgeo_workspace_t* ws) {
+    const stream_t* a = a_pyramid[level];
+    const stream_t* b = b_pyramid[level];
     const size_t a_n = a->n;
     const size_t b_n = b->n;
     warp_info_t* final_warp_info;
 
     if (a_n < radius + 4 || b_n < radius + 4) {
-        final_warp_info = _full_dtw(a, b);
+        final_warp_info = _full_dtw(a, b, ws);
     } else {
-        const stream_t* shrunk_a = _reduce_by_half(a); // Allocates memory
-        const stream_t* shrunk_b = _reduce_by_half(b); // Allocates memory
-        const warp_info_t* shrunk_warp_info = _fast_dtw(shrunk_a, shrunk_b, radius); // Allocates memory
-        strided_mask_t* new_window = strided_mask_expand(shrunk_warp_info->path_mask, (const int) (a_n % 2),
-                                                         (const int) (b_n % 2), radius); // Allocates memory
-        stream_destroy(shrunk_a);
-        stream_destroy(shrunk_b);
-        warp_info_destroy(shrunk_warp_info);
-        final_warp_info = _windowed_dtw(a, b, new_window); // Allocates memory
-        strided_mask_destroy(new_window);
+        const warp_info_t* shrunk_warp_info = _fast_dtw(a_pyramid, b_pyramid, level + 1, radius, ws); // Allocates memory
+        strided_mask_t* new_window = strided_mask_expand_ws(shrunk_warp_info->path_mask, (const int) (a_n % 2),
+                                                            (const int) (b_n % 2), radius, ws); // Allocates memory
+        warp_info_destroy(shrunk_warp_info, ws);
+        final_warp_info = _windowed_dtw(a, b, new_window, ws); // Allocates memory
+        strided_mask_destroy_ws(new_window, ws);
     }
     return final_warp_info;
 }
@@ -245,180 +821,757 @@ void warp_summary_destroy(const warp_summary_t* ws) {
     free((void*) ws);
 }
 
+// Allocates a summary with room for the longest possible path through an (n_rows x n_cols) cost matrix.
+// Reserving it before aligning lets workspace callers release every intermediate underneath it afterwards.
+warp_summary_t* _warp_summary_reserve(const size_t n_rows, const size_t n_cols, streamgeo_workspace_t* ws) {
+    warp_summary_t* summary = streamgeo_workspace_alloc(ws, sizeof(warp_summary_t));
+    summary->index_pairs = streamgeo_workspace_alloc(ws, 2 * (n_rows + n_cols - 1) * sizeof(size_t));
+    return summary;
+}
+
+// Writes the path and cost of `warp_info` into a reserved summary. Heap summaries are trimmed to fit.
+void _warp_summary_fill(warp_summary_t* summary, const warp_info_t* warp_info, streamgeo_workspace_t* ws) {
+    const strided_mask_t* path = warp_info->path_mask;
+    size_t* index_pairs = summary->index_pairs;
+    size_t index = 0;
+    for (size_t row = 0; row < path->n_rows; row++) {
+        for (size_t col = path->start_cols[row]; col <= path->end_cols[row]; col++) {
+            index_pairs[index++] = row;
+            index_pairs[index++] = col;
+        }
+    }
+    if (ws == NULL) {
+        summary->index_pairs = realloc(index_pairs, index * sizeof(size_t));
+    }
+    summary->path_length = index / 2;
+    summary->cost = warp_info->warp_cost;
+}
+
 warp_summary_t* full_warp_summary_create(const stream_t *a, const stream_t *b) {
-    const warp_info_t* warp_info = _full_dtw(a, b);
-    warp_summary_t* final_warp = malloc(sizeof(warp_summary_t));
-    final_warp->cost = warp_info->warp_cost;
-    size_t* length = malloc(sizeof(size_t));
-    final_warp->index_pairs = strided_mask_to_index_pairs(warp_info->path_mask, length);
-    final_warp->path_length = *length;
-    free(length);
-    warp_info_destroy(warp_info);
+    return full_warp_summary_create_with_recovery(a, b, PATH_RECOVERY_TABLE);
+}
+
+warp_summary_t* full_warp_summary_create_with_recovery(const stream_t *a, const stream_t *b,
+                                                       const path_recovery_t recovery) {
+    if (recovery != PATH_RECOVERY_LINEAR_SPACE) {
+        return full_warp_summary_create_ws(a, b, NULL);
+    }
+    warp_summary_t* final_warp = _warp_summary_reserve(a->n, b->n, NULL);
+    const warp_info_t* warp_info = _hirschberg_dtw(a, b);
+    _warp_summary_fill(final_warp, warp_info, NULL);
+    warp_info_destroy(warp_info, NULL);
+    return final_warp;
+}
+
+warp_summary_t* full_warp_summary_create_ws(const stream_t *a, const stream_t *b, streamgeo_workspace_t* ws) {
+    warp_summary_t* final_warp = _warp_summary_reserve(a->n, b->n, ws);
+    const streamgeo_workspace_mark_t mark = streamgeo_workspace_mark(ws);
+    const warp_info_t* warp_info = _full_dtw(a, b, ws);
+    _warp_summary_fill(final_warp, warp_info, ws);
+    warp_info_destroy(warp_info, ws);
+    streamgeo_workspace_release(ws, mark);
+    return final_warp;
+}
+
+warp_summary_t* windowed_warp_summary_create(const stream_t *a, const stream_t *b, const strided_mask_t* window) {
+    warp_summary_t* final_warp = _warp_summary_reserve(a->n, b->n, NULL);
+    const warp_info_t* warp_info = _windowed_dtw(a, b, window, NULL);
+    _warp_summary_fill(final_warp, warp_info, NULL);
+    warp_info_destroy(warp_info, NULL);
     return final_warp;
 }
 
+float windowed_dtw_cost(const stream_t* a, const stream_t* b, const strided_mask_t* window) {
+    return windowed_dtw_cost_bounded(a, b, window, INFINITY);
+}
+
 warp_summary_t* fast_warp_summary_create(const stream_t *a, const stream_t *b, const size_t radius) {
-    warp_info_t* warp_info = _fast_dtw(a, b, radius);
-    warp_summary_t* final_warp = malloc(sizeof(warp_summary_t));
-    final_warp->cost = warp_info->warp_cost;
-    size_t* length = malloc(sizeof(size_t));
-    final_warp->index_pairs = strided_mask_to_index_pairs(warp_info->path_mask, length);
-    final_warp->path_length = *length;
-    free(length);
-    warp_info_destroy(warp_info);
+    return fast_warp_summary_create_ws(a, b, radius, NULL);
+}
+
+warp_summary_t* fast_warp_summary_create_ws(const stream_t *a, const stream_t *b, const size_t radius,
+                                            streamgeo_workspace_t* ws) {
+    warp_summary_t* final_warp = _warp_summary_reserve(a->n, b->n, ws);
+    const streamgeo_workspace_mark_t mark = streamgeo_workspace_mark(ws);
+    const size_t levels = MIN(_pyramid_depth(a->n, radius), _pyramid_depth(b->n, radius));
+    const stream_t** a_pyramid = _pyramid_create(a, levels, ws);
+    const stream_t** b_pyramid = _pyramid_create(b, levels, ws);
+    warp_info_t* warp_info = _fast_dtw(a_pyramid, b_pyramid, 0, radius, ws);
+    _pyramid_destroy(a_pyramid, levels, ws);
+    _pyramid_destroy(b_pyramid, levels, ws);
+    _warp_summary_fill(final_warp, warp_info, ws);
+    warp_info_destroy(warp_info, ws);
+    streamgeo_workspace_release(ws, mark);
     return final_warp;
 }
 
-float similarity(const stream_t *a, const stream_t *b, const size_t radius) {
+// Advances a DP column of `costs` against reference `a_data` to activity column `col`, whose point is (lat, lng).
+// Only rows [lo, hi] of the new column are computed; the previous column (col - 1) is valid on rows [prev_lo, prev_hi]
+// and everything outside either range counts as unreachable. Alongside each cost we carry the activity index its path
+// started at. With `open_begin`, a path may start at any column for free, so row 0 is just the local cost; otherwise
+// paths start at column 0 and row 0 accumulates like any other row.
+void _dtw_column_update(const float* restrict a_data, const float lat, const float lng, const size_t col,
+                        const bool open_begin, const size_t prev_lo, const size_t prev_hi,
+                        const size_t lo, const size_t hi, float* restrict costs, size_t* restrict starts) {
+    const bool has_prev = col > 0;
+    float diag_cost = FLT_MAX;
+    size_t diag_start = col;
+    float up_cost, left_cost, old_cost;
+    float lat_diff, lng_diff, dt;
+    size_t old_start;
+    bool in_prev;
+    if (lo > 0 && has_prev && prev_lo <= lo-1 && lo-1 <= prev_hi) {
+        diag_cost = costs[lo-1];
+        diag_start = starts[lo-1];
+    }
+    for (size_t row = lo; row <= hi; row++) {
+        lat_diff = lat - a_data[2*row + 0];
+        lng_diff = lng - a_data[2*row + 1];
+        dt = (lng_diff * lng_diff) + (lat_diff * lat_diff);
+        in_prev = has_prev && prev_lo <= row && row <= prev_hi;
+        old_cost = in_prev ? costs[row] : FLT_MAX;
+        old_start = in_prev ? starts[row] : col;
+        if (row == 0) {
+            if (open_begin || !has_prev) {
+                costs[row] = dt;
+                starts[row] = col;
+            } else {
+                costs[row] = old_cost + dt;
+                starts[row] = old_start;
+            }
+        } else {
+            up_cost = (row > lo) ? costs[row-1] : FLT_MAX;
+            left_cost = old_cost;
+            if (diag_cost <= up_cost && diag_cost <= left_cost) {
+                costs[row] = diag_cost + dt;
+                starts[row] = diag_start;
+            } else if (up_cost <= left_cost) {
+                costs[row] = up_cost + dt;
+                starts[row] = starts[row-1];
+            } else {
+                costs[row] = left_cost + dt;
+                starts[row] = old_start;
+            }
+        }
+        diag_cost = old_cost;
+        diag_start = old_start;
+    }
+}
+
+// Open-begin, open-end DTW of `segment` (rows) against `activity` (columns), swept one activity column at a time so
+// only a column of M costs is kept. For every activity index j, ends[j] (if non-NULL) receives the cheapest match
+// ending at j. Returns the cheapest match overall (earliest end on ties).
+subsequence_match_t _subsequence_dtw(const stream_t* restrict segment, const stream_t* restrict activity,
+                                     subsequence_match_t* ends) {
+    const float* a_data = segment->data;
+    const float* b_data = activity->data;
+    const size_t a_n = segment->n;
+    const size_t b_n = activity->n;
+    float* costs = malloc(a_n * sizeof(float));
+    size_t* starts = malloc(a_n * sizeof(size_t));
+    subsequence_match_t best = {0, 0, INFINITY};
+    for (size_t col = 0; col < b_n; col++) {
+        _dtw_column_update(a_data, b_data[2*col + 0], b_data[2*col + 1], col, true, 0, a_n-1, 0, a_n-1, costs, starts);
+        const subsequence_match_t match = {starts[a_n-1], col, costs[a_n-1]};
+        if (ends) {
+            ends[col] = match;
+        }
+        if (match.cost < best.cost) {
+            best = match;
+        }
+    }
+    free(costs);
+    free(starts);
+    return best;
+}
+
+subsequence_match_t subsequence_dtw_find(const stream_t* segment, const stream_t* activity) {
+    return _subsequence_dtw(segment, activity, NULL);
+}
+
+int _subsequence_match_compare(const void* a, const void* b) {
+    const subsequence_match_t* x = a;
+    const subsequence_match_t* y = b;
+    if (x->cost != y->cost) return (x->cost < y->cost) ? -1 : 1;
+    return (x->end > y->end) - (x->end < y->end);
+}
+
+size_t subsequence_dtw_find_top_k(const stream_t* segment, const stream_t* activity, const size_t k,
+                                  subsequence_match_t* matches) {
+    const size_t b_n = activity->n;
+    subsequence_match_t* ends = malloc(b_n * sizeof(subsequence_match_t));
+    _subsequence_dtw(segment, activity, ends);
+    qsort(ends, b_n, sizeof(subsequence_match_t), _subsequence_match_compare);
+    size_t found = 0;
+    for (size_t c = 0; c < b_n && found < k; c++) {
+        bool overlaps = false;
+        for (size_t m = 0; m < found && !overlaps; m++) {
+            overlaps = ends[c].start <= matches[m].end && matches[m].start <= ends[c].end;
+        }
+        if (!overlaps) {
+            matches[found++] = ends[c];
+        }
+    }
+    free(ends);
+    return found;
+}
+
+struct dtw_stream_state {
+    const stream_t* reference;  // Borrowed
+    bool open_begin;
+    size_t band;                // 0 for no band
+    float* costs;               // Latest DP column, valid on rows [lo, hi]
+    size_t* starts;             // Activity index each cell's path started at
+    size_t lo;
+    size_t hi;
+    size_t n_points;            // Number of points pushed so far
+    size_t position;            // Reference index the latest point is matched to
+    subsequence_match_t best;   // Cheapest complete match seen so far
+};
+
+dtw_stream_state_t* dtw_stream_create(const stream_t* reference, const int open_begin, const size_t band) {
+    dtw_stream_state_t* state = malloc(sizeof(dtw_stream_state_t));
+    state->reference = reference;
+    state->open_begin = open_begin != 0;
+    state->band = band;
+    state->costs = malloc(reference->n * sizeof(float));
+    state->starts = malloc(reference->n * sizeof(size_t));
+    state->lo = 0;
+    state->hi = 0;
+    state->n_points = 0;
+    state->position = 0;
+    state->best.start = 0;
+    state->best.end = 0;
+    state->best.cost = INFINITY;
+    return state;
+}
+
+void dtw_stream_destroy(dtw_stream_state_t* state) {
+    free(state->costs);
+    free(state->starts);
+    free(state);
+}
+
+void dtw_stream_push(dtw_stream_state_t* state, const float lat, const float lng) {
+    const size_t ref_n = state->reference->n;
+    const size_t col = state->n_points;
+    size_t lo = 0;
+    size_t hi = ref_n - 1;
+    if (state->band > 0) {
+        // Paths only move forward along the reference, so the band may extend `band` rows either side of the match.
+        lo = (state->position > state->band) ? state->position - state->band : 0;
+        hi = MIN(hi, state->position + state->band);
+    }
+    _dtw_column_update(state->reference->data, lat, lng, col, state->open_begin, state->lo, state->hi, lo, hi,
+                       state->costs, state->starts);
+    state->lo = lo;
+    state->hi = hi;
+    state->n_points++;
+    size_t position = lo;
+    for (size_t row = lo + 1; row <= hi; row++) {
+        if (state->costs[row] < state->costs[position]) position = row;
+    }
+    state->position = position;
+    const float cost = dtw_stream_cost(state);
+    if (cost < state->best.cost) {
+        state->best.start = state->starts[ref_n - 1];
+        state->best.end = col;
+        state->best.cost = cost;
+    }
+}
+
+float dtw_stream_cost(const dtw_stream_state_t* state) {
+    const size_t last = state->reference->n - 1;
+    if (state->n_points == 0 || state->hi != last || state->costs[last] >= FLT_MAX) {
+        return INFINITY;
+    }
+    return state->costs[last];
+}
+
+size_t dtw_stream_position(const dtw_stream_state_t* state) {
+    return state->position;
+}
+
+subsequence_match_t dtw_stream_best_match(const dtw_stream_state_t* state) {
+    return state->best;
+}
+
+enum {
+    COUNTER_EVALUATED,
+    COUNTER_REJECTED_IMPROPER,
+    COUNTER_REJECTED_DISTANCE_RATIO,
+    COUNTER_REJECTED_BOUNDING_BOX,
+    COUNTER_REJECTED_LB_KIM,
+    COUNTER_REJECTED_LB_KEOGH,
+    COUNTER_ALIGNED,
+    SIMILARITY_COUNTER_COUNT
+};
+
+// Counters for the rejection cascade in `similarity`. Relaxed atomics: these are statistics, not synchronization.
+static atomic_size_t similarity_counters[SIMILARITY_COUNTER_COUNT];
+
+void _similarity_count(const int counter) {
+    atomic_fetch_add_explicit(&similarity_counters[counter], 1, memory_order_relaxed);
+}
+
+void similarity_stats_get(similarity_stats_t* stats) {
+    stats->evaluated = atomic_load_explicit(&similarity_counters[COUNTER_EVALUATED], memory_order_relaxed);
+    stats->rejected_improper = atomic_load_explicit(&similarity_counters[COUNTER_REJECTED_IMPROPER], memory_order_relaxed);
+    stats->rejected_distance_ratio = atomic_load_explicit(&similarity_counters[COUNTER_REJECTED_DISTANCE_RATIO], memory_order_relaxed);
+    stats->rejected_bounding_box = atomic_load_explicit(&similarity_counters[COUNTER_REJECTED_BOUNDING_BOX], memory_order_relaxed);
+    stats->rejected_lb_kim = atomic_load_explicit(&similarity_counters[COUNTER_REJECTED_LB_KIM], memory_order_relaxed);
+    stats->rejected_lb_keogh = atomic_load_explicit(&similarity_counters[COUNTER_REJECTED_LB_KEOGH], memory_order_relaxed);
+    stats->aligned = atomic_load_explicit(&similarity_counters[COUNTER_ALIGNED], memory_order_relaxed);
+}
+
+void similarity_stats_reset() {
+    for (size_t i = 0; i < SIMILARITY_COUNTER_COUNT; i++) {
+        atomic_store_explicit(&similarity_counters[i], 0, memory_order_relaxed);
+    }
+}
+
+// Everything `similarity` needs to know about one side of a pair. Cheap fields are filled by _similarity_profile_init;
+// the expensive ones (NULL until then) by _similarity_profile_complete, which is only worth doing once a pair has
+// survived the rejection cascade -- or up front, for a query that will be compared against many candidates.
+typedef struct {
+    const stream_t* stream;
+    float distance;              // stream_distance; only valid for streams with at least two points
+    float* sparsity;             // stream_sparsity_create
+    double* positional;          // Positional weight of each point: 0.1 + 0.9 * sin(pi * i / n)
+    const stream_t** pyramid;    // FastDTW coarsening pyramid of full depth
+    size_t n_levels;
+} _similarity_profile_t;
+
+void _similarity_profile_init(_similarity_profile_t* profile, const stream_t* stream) {
+    profile->stream = stream;
+    if (stream->n >= 2) {
+        profile->distance = stream_distance(stream);
+    }
+    profile->sparsity = NULL;
+    profile->positional = NULL;
+    profile->pyramid = NULL;
+    profile->n_levels = 0;
+}
+
+void _similarity_profile_complete(_similarity_profile_t* profile, const size_t radius, streamgeo_workspace_t* ws) {
+    const stream_t* stream = profile->stream;
+    const size_t n = stream->n;
+    profile->sparsity = stream_sparsity_create_ws(stream, ws);
+    profile->positional = streamgeo_workspace_alloc(ws, n * sizeof(double));
+    for (size_t i = 0; i < n; i++) {
+        profile->positional[i] = 0.1 + 0.9 * sin(PI * i / n);
+    }
+    profile->n_levels = _pyramid_depth(n, radius);
+    profile->pyramid = _pyramid_create(stream, profile->n_levels, ws);
+}
+
+// Frees whatever the profile owns (the stream itself is borrowed).
+void _similarity_profile_release(_similarity_profile_t* profile, streamgeo_workspace_t* ws) {
+    if (profile->pyramid) _pyramid_destroy(profile->pyramid, profile->n_levels, ws);
+    if (profile->sparsity) streamgeo_workspace_free(ws, profile->sparsity);
+    if (profile->positional) streamgeo_workspace_free(ws, profile->positional);
+}
+
+// Whether the start, middle or end points of `a` and `b` are further apart than `tolerance`.
+int _similarity_landmarks_apart(const stream_t* a, const stream_t* b, const float tolerance) {
+    const float* a_data = a->data;
+    const float* b_data = b->data;
+    const size_t a_i[3] = {0, a->n / 2, a->n - 1};
+    const size_t b_i[3] = {0, b->n / 2, b->n - 1};
+    float lat_diff, lng_diff;
+    for (size_t k = 0; k < 3; k++) {
+        lat_diff = b_data[2 * b_i[k] + 0] - a_data[2 * a_i[k] + 0];
+        lng_diff = b_data[2 * b_i[k] + 1] - a_data[2 * a_i[k] + 1];
+        if (sqrtf((lng_diff * lng_diff) + (lat_diff * lat_diff)) > tolerance) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// The extra tiers of `similarity_strict`: whether some aligned pair is provably further apart than `tolerance`.
+// Cheapest bounds first, with the start/mid/end check in between as in `similarity`; see lowerbound.h.
+// Counts the tier that rejected, if any.
+int _similarity_strict_reject(const stream_t* a, const stream_t* b, const size_t radius, const float tolerance,
+                              streamgeo_workspace_t* ws) {
+    const bounding_box_t a_box = stream_bounding_box(a);
+    const bounding_box_t b_box = stream_bounding_box(b);
+    if (lb_bounding_box(&a_box, &b_box) > tolerance) {
+        _similarity_count(COUNTER_REJECTED_BOUNDING_BOX);
+        return 1;
+    }
+    if (_similarity_landmarks_apart(a, b, tolerance) || lb_kim(a, &a_box, b, &b_box) > tolerance) {
+        _similarity_count(COUNTER_REJECTED_LB_KIM);
+        return 1;
+    }
+    stream_envelope_t* envelope =
+            stream_envelope_create_ws(a, radius + (size_t) (LB_KEOGH_WINDOW_FRACTION * a->n), ws);
+    const float keogh = lb_keogh(envelope, b);
+    stream_envelope_destroy_ws(envelope, ws);
+    if (keogh > tolerance) {
+        _similarity_count(COUNTER_REJECTED_LB_KEOGH);
+        return 1;
+    }
+    return 0;
+}
+
+// Scores `b` against a query profile. Query fields that have not been precomputed are computed here, and only for
+// pairs that need them. Counts towards the cascade statistics. Scratch memory comes from `ws` (NULL for the heap).
+// `strict` enables the extra rejection tiers of `similarity_strict`.
+float _similarity_against(const _similarity_profile_t* query, const stream_t* b, const size_t radius, const int strict,
+                          streamgeo_workspace_t* ws) {
+    const stream_t* a = query->stream;
     const size_t a_n = a->n;
     const float* a_data = a->data;
     const size_t b_n = b->n;
     const float* b_data = b->data;
 
+    _similarity_count(COUNTER_EVALUATED);
     // Stream is improper
     if (a_n < 2 || b_n < 2) {
+        _similarity_count(COUNTER_REJECTED_IMPROPER);
         return 0.0;
     }
+    _similarity_profile_t b_profile;
+    _similarity_profile_init(&b_profile, b);
     // Horribly mismatched distance ratio
-    const float a_stream_distance = stream_distance(a);
-    const float b_stream_distance = stream_distance(b);
-    const float ratio = a_stream_distance / b_stream_distance;
+    const float ratio = query->distance / b_profile.distance;
     if (ratio < 0.4 || ratio > 2.5) {
+        _similarity_count(COUNTER_REJECTED_DISTANCE_RATIO);
         return 0.0;
     }
     // If start/mid/endpoints are further apart than 30% of min distance, return zero
-    const float min_distance = 0.3f * MIN(a_stream_distance, b_stream_distance);
-    // Start point
-    float lat_diff = b_data[2 * (0) + 0] - a_data[2 * (0) + 0];
-    float lng_diff = b_data[2 * (0) + 1] - a_data[2 * (0) + 1];
-    if (sqrtf((lng_diff * lng_diff) + (lat_diff * lat_diff)) > min_distance) return 0.0;
-    // Midpoint
-    lat_diff = b_data[2 * (b_n / 2) + 0] - a_data[2 * (a_n / 2) + 0];
-    lng_diff = b_data[2 * (b_n / 2) + 1] - a_data[2 * (a_n / 2) + 1];
-    if (sqrtf((lng_diff * lng_diff) + (lat_diff * lat_diff)) > min_distance) return 0.0;
-    // Endpoint
-    lat_diff = b_data[2 * (b_n - 1) + 0] - a_data[2 * (a_n - 1) + 0];
-    lng_diff = b_data[2 * (b_n - 1) + 1] - a_data[2 * (a_n - 1) + 1];
-    if (sqrtf((lng_diff * lng_diff) + (lat_diff * lat_diff)) > min_distance) return 0.0;
-
-    float* a_sparsity = stream_sparsity_create(a);
-    float* b_sparsity = stream_sparsity_create(b);
-
-    const warp_summary_t* warp_summary = fast_warp_summary_create(a, b, radius);
-    size_t path_length = warp_summary->path_length;
-    size_t* warp_path = warp_summary->index_pairs;
+    const float min_distance = 0.3f * MIN(query->distance, b_profile.distance);
+    if (strict) {
+        if (_similarity_strict_reject(a, b, radius, min_distance, ws)) {
+            return 0.0;
+        }
+    } else if (_similarity_landmarks_apart(a, b, min_distance)) {
+        _similarity_count(COUNTER_REJECTED_LB_KIM);
+        return 0.0;
+    }
+    _similarity_count(COUNTER_ALIGNED);
+
+    // The query's pyramid may be deeper than this pair needs; _fast_dtw stops at the right level on its own.
+    _similarity_profile_t a_profile = *query;
+    const bool complete_query = (query->pyramid == NULL);
+    if (complete_query) {
+        _similarity_profile_complete(&a_profile, radius, ws);
+    }
+    _similarity_profile_complete(&b_profile, radius, ws);
+    const float* a_sparsity = a_profile.sparsity;
+    const float* b_sparsity = b_profile.sparsity;
+    const double* a_positional = a_profile.positional;
+    const double* b_positional = b_profile.positional;
+
+    const warp_info_t* warp_info = _fast_dtw(a_profile.pyramid, b_profile.pyramid, 0, radius, ws);
+    const strided_mask_t* path = warp_info->path_mask;
 
     float total_weight = 0.0f;
     float total_weight_error = 0.0f;
-    float unitless_cost, weight, error;
-    size_t i, j;
+    float lat_diff, lng_diff, unitless_cost, weight, error;
 
-    for (size_t n = 0; n < path_length; n++) {
-        i = warp_path[2 * n];
-        j = warp_path[2 * n + 1];
+    // Walk the path mask directly, row by row; this visits (i, j) in the same order as its index pairs.
+    for (size_t i = 0; i < a_n; i++) {
+        for (size_t j = path->start_cols[i]; j <= path->end_cols[i]; j++) {
+            lat_diff = b_data[2 * j + 0] - a_data[2 * i + 0];
+            lng_diff = b_data[2 * j + 1] - a_data[2 * i + 1];
+            unitless_cost = sqrtf((lng_diff * lng_diff) + (lat_diff * lat_diff)) / min_distance;
+            error = (float) (1.0 - exp(-unitless_cost * unitless_cost));
 
-        lat_diff = b_data[2 * j + 0] - a_data[2 * i + 0];
-        lng_diff = b_data[2 * j + 1] - a_data[2 * i + 1];
-        unitless_cost = sqrtf((lng_diff * lng_diff) + (lat_diff * lat_diff)) / min_distance;
-        error = (float) (1.0 - exp(-unitless_cost * unitless_cost));
-
-        // Weight start/end less than the middle, weight sparse points less than dense.
-        // This is a product of positional_weight_a * positional_weight_b * sparsity_weight_a * sparsity_weight_b
-        weight = (float) (a_sparsity[i] * b_sparsity[j] * (0.1 + 0.9 * sin(PI * i / a_n)) * (0.1 + 0.9 * sin(PI * j / b_n)));
-        total_weight += weight;
-        total_weight_error += (error * weight);
+            // Weight start/end less than the middle, weight sparse points less than dense.
+            // This is a product of positional_weight_a * positional_weight_b * sparsity_weight_a * sparsity_weight_b
+            weight = (float) (a_sparsity[i] * b_sparsity[j] * a_positional[i] * b_positional[j]);
+            total_weight += weight;
+            total_weight_error += (error * weight);
+        }
+    }
+    warp_info_destroy(warp_info, ws);
+    if (complete_query) {
+        _similarity_profile_release(&a_profile, ws);
     }
-    warp_summary_destroy(warp_summary);
-    free(a_sparsity);
-    free(b_sparsity);
+    _similarity_profile_release(&b_profile, ws);
 
     return (float) (1.0 - total_weight_error / total_weight);
 }
 
-size_t medoid_consensus(const stream_collection_t* input, const int approximate) {
-    float cost_matrix[input->n][input->n];
+float similarity(const stream_t *a, const stream_t *b, const size_t radius) {
+    return similarity_ws(a, b, radius, NULL);
+}
 
-    // Populate cost matrix
-    stream_t* first;
-    stream_t* second;
-    size_t radius = 0;
-    if (approximate) {
-        for (size_t i = 0; i < input->n; i++) {
-            radius = MAX(radius, (size_t) ceilf(powf(input->data[i]->n, 0.25)));
+float _similarity_pair(const stream_t *a, const stream_t *b, const size_t radius, const int strict,
+                       streamgeo_workspace_t* ws) {
+    const streamgeo_workspace_mark_t mark = streamgeo_workspace_mark(ws);
+    _similarity_profile_t query;
+    _similarity_profile_init(&query, a);
+    const float result = _similarity_against(&query, b, radius, strict, ws);
+    streamgeo_workspace_release(ws, mark);
+    return result;
+}
+
+float similarity_ws(const stream_t *a, const stream_t *b, const size_t radius, streamgeo_workspace_t* ws) {
+    return _similarity_pair(a, b, radius, 0, ws);
+}
+
+float similarity_strict(const stream_t *a, const stream_t *b, const size_t radius) {
+    return _similarity_pair(a, b, radius, 1, NULL);
+}
+
+// One workspace per thread of a parallel_for, so that concurrent tasks never go through the allocator.
+streamgeo_workspace_t** _workspaces_create(const size_t nthreads) {
+    streamgeo_workspace_t** workspaces = malloc(nthreads * sizeof(streamgeo_workspace_t*));
+    for (size_t t = 0; t < nthreads; t++) {
+        workspaces[t] = streamgeo_workspace_create(0);
+    }
+    return workspaces;
+}
+
+void _workspaces_destroy(streamgeo_workspace_t** workspaces, const size_t nthreads) {
+    for (size_t t = 0; t < nthreads; t++) {
+        streamgeo_workspace_destroy(workspaces[t]);
+    }
+    free(workspaces);
+}
+
+typedef struct {
+    const _similarity_profile_t* query;
+    const stream_collection_t* candidates;
+    size_t radius;
+    streamgeo_workspace_t** workspaces;  // One per thread
+    float* out;
+} _similarity_batch_t;
+
+void _similarity_batch_task(void* context, const size_t index, const size_t thread_id) {
+    const _similarity_batch_t* batch = context;
+    streamgeo_workspace_t* ws = batch->workspaces[thread_id];
+    batch->out[index] = _similarity_against(batch->query, batch->candidates->data[index], batch->radius, 0, ws);
+    streamgeo_workspace_reset(ws);
+}
+
+void similarity_batch(const stream_t* query, const stream_collection_t* candidates, const size_t radius, float* out,
+                      const size_t nthreads) {
+    _similarity_profile_t profile;
+    _similarity_profile_init(&profile, query);
+    if (query->n >= 2) {
+        _similarity_profile_complete(&profile, radius, NULL);
+    }
+    const size_t n_threads = parallel_thread_count(candidates->n, nthreads);
+    _similarity_batch_t batch = {&profile, candidates, radius, _workspaces_create(n_threads), out};
+    parallel_for(candidates->n, n_threads, _similarity_batch_task, &batch);
+    _workspaces_destroy(batch.workspaces, n_threads);
+    _similarity_profile_release(&profile, NULL);
+}
+
+// Maps a packed pair index k to the pair (i, j), i < j, it stores (see `pairwise_cost_index`).
+void _pairwise_pair(const size_t n, const size_t k, size_t* i, size_t* j) {
+    // Row i starts at k = i * (2n - i - 1) / 2. Invert that with a square root, then fix up any rounding error.
+    const double m = (double) n - 0.5;
+    size_t row = (size_t) MAX(0.0, floor(m - sqrt(m * m - 2.0 * (double) k)));
+    while (row > 0 && row * (2*n - row - 1) / 2 > k) row--;
+    while ((row + 1) * (2*n - row - 2) / 2 <= k) row++;
+    *i = row;
+    *j = k - row * (2*n - row - 1) / 2 + row + 1;
+}
+
+typedef struct {
+    const stream_collection_t* collection;
+    alignment_mode_t mode;
+    size_t radius;
+    const stream_t*** pyramids;  // Per-stream FastDTW pyramids (fast mode only)
+    streamgeo_workspace_t** workspaces;  // One per thread (fast mode only)
+    float* costs;
+} _pairwise_t;
+
+void _pairwise_task(void* context, const size_t k, const size_t thread_id) {
+    const _pairwise_t* pairwise = context;
+    const size_t n = pairwise->collection->n;
+    size_t i, j;
+    _pairwise_pair(n, k, &i, &j);
+    if (pairwise->mode == ALIGNMENT_FULL) {
+        pairwise->costs[k] = full_dtw_cost(pairwise->collection->data[i], pairwise->collection->data[j]);
+    } else {
+        streamgeo_workspace_t* ws = pairwise->workspaces[thread_id];
+        const warp_info_t* warp_info = _fast_dtw(pairwise->pyramids[i], pairwise->pyramids[j], 0, pairwise->radius, ws);
+        pairwise->costs[k] = warp_info->warp_cost;
+        streamgeo_workspace_reset(ws);
+    }
+}
+
+size_t pairwise_cost_index(const size_t n, const size_t i, const size_t j) {
+    const size_t lo = MIN(i, j);
+    const size_t hi = MAX(i, j);
+    return lo * (2*n - lo - 1) / 2 + (hi - lo - 1);
+}
+
+float pairwise_cost_get(const float* costs, const size_t n, const size_t i, const size_t j) {
+    return (i == j) ? 0.0f : costs[pairwise_cost_index(n, i, j)];
+}
+
+float* pairwise_cost_matrix(const stream_collection_t* collection, const alignment_mode_t mode, const size_t radius,
+                            const size_t nthreads) {
+    const size_t n = collection->n;
+    const size_t n_pairs = n * (n - 1) / 2;
+    float* costs = malloc(MAX(n_pairs, 1) * sizeof(float));
+    _pairwise_t pairwise = {collection, mode, radius, NULL, NULL, costs};
+    const size_t n_threads = parallel_thread_count(n_pairs, nthreads);
+    // In fast mode every stream takes part in n-1 alignments, so build each coarsening pyramid once up front.
+    size_t* n_levels = NULL;
+    if (mode == ALIGNMENT_FAST) {
+        pairwise.pyramids = malloc(n * sizeof(stream_t**));
+        n_levels = malloc(n * sizeof(size_t));
+        for (size_t i = 0; i < n; i++) {
+            n_levels[i] = _pyramid_depth(collection->data[i]->n, radius);
+            pairwise.pyramids[i] = _pyramid_create(collection->data[i], n_levels[i], NULL);
+        }
+        pairwise.workspaces = _workspaces_create(n_threads);
+    }
+    parallel_for(n_pairs, n_threads, _pairwise_task, &pairwise);
+    if (mode == ALIGNMENT_FAST) {
+        _workspaces_destroy(pairwise.workspaces, n_threads);
+        for (size_t i = 0; i < n; i++) {
+            _pyramid_destroy(pairwise.pyramids[i], n_levels[i], NULL);
         }
+        free(pairwise.pyramids);
+        free(n_levels);
     }
+    return costs;
+}
 
-    for (size_t i = 0; i < input->n; i++) {
-        first = input->data[i];
-        for (size_t j = 0; j <= i; j++) {
-            second = input->data[j];
-            if (i == j) {
-                cost_matrix[i][j] = 0.0;
-            } else {
-                warp_summary_t* warp_summary = approximate ? fast_warp_summary_create(first, second, radius) : full_warp_summary_create(first, second);
-                cost_matrix[i][j] = warp_summary->cost;
-                cost_matrix[j][i] = warp_summary->cost;
-                warp_summary_destroy(warp_summary);
-            }
+size_t medoid_consensus(const stream_collection_t* input, const int approximate) {
+    const size_t n = input->n;
+    size_t radius = 0;
+    if (approximate) {
+        for (size_t i = 0; i < n; i++) {
+            radius = MAX(radius, (size_t) ceilf(powf(input->data[i]->n, 0.25)));
         }
     }
+    float* costs = pairwise_cost_matrix(input, approximate ? ALIGNMENT_FAST : ALIGNMENT_FULL, radius, 0);
 
     // Compute the optimal index.
     size_t best_index = 0;
     float best_cost = FLT_MAX;
-    for (size_t i = 0; i < input->n; i++) {
+    for (size_t i = 0; i < n; i++) {
         float accum = 0;
-        for (size_t j = 0; j < input->n; j++) {
-            accum += cost_matrix[i][j];
+        for (size_t j = 0; j < n; j++) {
+            accum += pairwise_cost_get(costs, n, i, j);
         }
         if (accum < best_cost) {
             best_cost = accum;
             best_index = i;
         }
     }
+    free(costs);
     return best_index;
 }
 
-// Mutates/modifies the stream passed as consensus_stream by doing a DBA update.
-// If radius != -1, then we're doing an approximate warp summary.
-// For each element in the input collection,
-void _dba_update(const stream_collection_t* input_collection, stream_t* consensus_stream, const ssize_t radius) {
+// State shared by the members' alignment tasks during one DBA iteration.
+// `sums` and `counts` hold one slice per thread (carved out of a single allocation), so tasks never contend:
+// thread t accumulates into sums[t * 2L ...] and counts[t * L ...], where L is the consensus length.
+typedef struct {
+    const stream_collection_t* input;
+    const stream_t* consensus;
+    const stream_t** consensus_pyramid;  // Shared FastDTW pyramid of the consensus; NULL for exact alignment
+    size_t radius;
+    streamgeo_workspace_t** workspaces;  // One per thread
+    double* sums;
+    size_t* counts;
+} _dba_iteration_t;
 
+void _dba_align_task(void* context, const size_t index, const size_t thread_id) {
+    const _dba_iteration_t* iteration = context;
+    const stream_t* member = iteration->input->data[index];
+    const float* member_data = member->data;
+    const size_t consensus_n = iteration->consensus->n;
+    double* sums = iteration->sums + thread_id * 2 * consensus_n;
+    size_t* counts = iteration->counts + thread_id * consensus_n;
+    streamgeo_workspace_t* ws = iteration->workspaces[thread_id];
 
-    return;
+    warp_info_t* warp_info;
+    if (iteration->consensus_pyramid) {
+        const size_t levels = _pyramid_depth(member->n, iteration->radius);
+        const stream_t** member_pyramid = _pyramid_create(member, levels, ws);
+        warp_info = _fast_dtw(iteration->consensus_pyramid, member_pyramid, 0, iteration->radius, ws);
+    } else {
+        warp_info = _full_dtw(iteration->consensus, member, ws);
+    }
+    // Every member point aligned to consensus point i contributes to the new position of point i.
+    const strided_mask_t* path = warp_info->path_mask;
+    for (size_t i = 0; i < consensus_n; i++) {
+        for (size_t j = path->start_cols[i]; j <= path->end_cols[i]; j++) {
+            sums[2*i + 0] += member_data[2*j + 0];
+            sums[2*i + 1] += member_data[2*j + 1];
+            counts[i]++;
+        }
+    }
+    streamgeo_workspace_reset(ws);
+}
+
+// Mutates/modifies the stream passed as consensus_stream by doing a DBA update:
+// aligns every member of the input collection to the consensus (in parallel), then moves each consensus point to the
+// barycenter of all member points aligned to it. If `approximate` is set, alignments use FastDTW with `radius`.
+void _dba_update(const stream_collection_t* input_collection, stream_t* consensus_stream, const int approximate,
+                 const size_t radius) {
+    const size_t consensus_n = consensus_stream->n;
+    const size_t nthreads = parallel_thread_count(input_collection->n, 0);
+    _dba_iteration_t iteration;
+    iteration.input = input_collection;
+    iteration.consensus = consensus_stream;
+    iteration.radius = radius;
+    iteration.workspaces = _workspaces_create(nthreads);
+    iteration.sums = calloc(nthreads * 2 * consensus_n, sizeof(double));
+    iteration.counts = calloc(nthreads * consensus_n, sizeof(size_t));
+    size_t levels = 0;
+    iteration.consensus_pyramid = NULL;
+    if (approximate) {
+        levels = _pyramid_depth(consensus_n, radius);
+        iteration.consensus_pyramid = _pyramid_create(consensus_stream, levels, NULL);
+    }
+
+    parallel_for(input_collection->n, nthreads, _dba_align_task, &iteration);
+
+    // Reduce the per-thread slices into the first one, then take barycenters.
+    double* sums = iteration.sums;
+    size_t* counts = iteration.counts;
+    for (size_t t = 1; t < nthreads; t++) {
+        for (size_t i = 0; i < consensus_n; i++) {
+            sums[2*i + 0] += sums[t * 2 * consensus_n + 2*i + 0];
+            sums[2*i + 1] += sums[t * 2 * consensus_n + 2*i + 1];
+            counts[i] += counts[t * consensus_n + i];
+        }
+    }
+    float* consensus_data = consensus_stream->data;
+    for (size_t i = 0; i < consensus_n; i++) {
+        // Every row of a warp path holds at least one cell, so each count is positive whenever the input is non-empty.
+        if (counts[i] > 0) {
+            consensus_data[2*i + 0] = (float) (sums[2*i + 0] / counts[i]);
+            consensus_data[2*i + 1] = (float) (sums[2*i + 1] / counts[i]);
+        }
+    }
+
+    if (iteration.consensus_pyramid) {
+        _pyramid_destroy(iteration.consensus_pyramid, levels, NULL);
+    }
+    _workspaces_destroy(iteration.workspaces, nthreads);
+    free(iteration.sums);
+    free(iteration.counts);
 }
 
 // Allocates memory for the consensus stream that is returned.
 stream_t* dba_consensus(const stream_collection_t* input, const int approximate, const size_t iterations) {
-    // Choose a random element of the set to be the initial consensus sequence.
-    // Copy the contents from the
+    // Use the first element of the set as the initial consensus sequence.
     const size_t consensus_length = input->data[0]->n;
     stream_t* consensus = stream_create(consensus_length);
+    memcpy(consensus->data, input->data[0]->data, 2 * consensus_length * sizeof(float));
 
-    memcpy(consensus->data, input->data[0]->data, 2*consensus_length);
-
-    ssize_t radius = -1;
+    size_t radius = 0;
     if (approximate) {
         for (size_t i = 0; i < input->n; i++) {
             radius = MAX(radius, (size_t) ceilf(powf(input->data[i]->n, 0.25)));
         }
     }
 
-    const size_t input_collection_size = input->n;
-    // tuple_association[i] contains an array of points that are dynamic-timewarp-mapped to point [i] in the consensus stream
-    // our standard way of representing a collection of points is ... drum roll ... a stream. Although we don't care about the
-    // ordering here, it seemed cleaner than creating a separate type for a collection of unordered points, this is technically
-    // an abuse of the stream_collection object.
-    stream_collection_t* tuple_association = stream_collection_create(consensus_length);
-    for (size_t i = 0; i < consensus_length; i++) {
-        tuple_association->data[i] = stream_create(input_collection_size);
-    }
-
     for (size_t i = 0; i < iterations; i++) {
-        _dba_update(input, consensus, radius);
+        _dba_update(input, consensus, approximate, radius);
     }
-
-    stream_collection_destroy(tuple_association);
-
     return consensus;
 }
@@ -0,0 +1,195 @@
+#include <cstreamgeo/geohash.h>
+#include <immintrin.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Geohash encoding, decoding and per-stream cell sets. See geohash.h.
+ */
+
+static const char _geohash_alphabet[33] = "0123456789bcdefghjkmnpqrstuvwxyz";
+
+// Spreads the bits of latitude and longitude cell indices into a geohash.
+typedef uint64_t (*_geohash_interleave_t)(const uint32_t lat_index, const uint32_t lng_index, const size_t bits);
+
+// Moves bit k of x to bit 2k.
+uint64_t _geohash_spread(uint32_t x) {
+    uint64_t v = x;
+    v = (v | (v << 16)) & 0x0000FFFF0000FFFFull;
+    v = (v | (v << 8)) & 0x00FF00FF00FF00FFull;
+    v = (v | (v << 4)) & 0x0F0F0F0F0F0F0F0Full;
+    v = (v | (v << 2)) & 0x3333333333333333ull;
+    v = (v | (v << 1)) & 0x5555555555555555ull;
+    return v;
+}
+
+// Inverse of _geohash_spread: moves bit 2k of v to bit k.
+uint32_t _geohash_squash(uint64_t v) {
+    v &= 0x5555555555555555ull;
+    v = (v | (v >> 1)) & 0x3333333333333333ull;
+    v = (v | (v >> 2)) & 0x0F0F0F0F0F0F0F0Full;
+    v = (v | (v >> 4)) & 0x00FF00FF00FF00FFull;
+    v = (v | (v >> 8)) & 0x0000FFFF0000FFFFull;
+    v = (v | (v >> 16)) & 0x00000000FFFFFFFFull;
+    return (uint32_t) v;
+}
+
+// Longitude takes the most significant bit, so with an odd number of bits it also takes the extra one.
+uint64_t _geohash_interleave_scalar(const uint32_t lat_index, const uint32_t lng_index, const size_t bits) {
+    return (bits % 2 == 0) ? (_geohash_spread(lng_index) << 1) | _geohash_spread(lat_index)
+                           : _geohash_spread(lng_index) | (_geohash_spread(lat_index) << 1);
+}
+
+#if defined(__x86_64__)
+
+__attribute__((target("bmi2")))
+uint64_t _geohash_interleave_bmi2(const uint32_t lat_index, const uint32_t lng_index, const size_t bits) {
+    const uint64_t even = 0x5555555555555555ull;
+    return (bits % 2 == 0) ? _pdep_u64(lng_index, even << 1) | _pdep_u64(lat_index, even)
+                           : _pdep_u64(lng_index, even) | _pdep_u64(lat_index, even << 1);
+}
+
+#endif
+
+_geohash_interleave_t _select_geohash_interleave() {
+#if defined(__x86_64__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("bmi2")) {
+        return _geohash_interleave_bmi2;
+    }
+#endif
+    return _geohash_interleave_scalar;
+}
+
+// Index of the cell of [-range/2, range/2] divided into 2^bits cells that contains `x`, as bisecting the interval
+// bit by bit would find it.
+// The arithmetic estimate can be one cell off when x + range/2 rounds onto a cell boundary (e.g. for a tiny negative
+// x, -1e-30 + 90 is exactly 90), so it is checked against the cell's edges. Those are exact in double, and so is any
+// float x, so the comparisons are exact, as they are in the bisection.
+uint32_t _geohash_cell_index(const float x, const double range, const size_t bits) {
+    const double cells = (double) (UINT64_C(1) << bits);
+    const double scaled = floor(((double) x + range / 2) * cells / range);
+    const double max_index = cells - 1;
+    double index = fmin(fmax(scaled, 0.0), max_index);
+    if (index > 0 && (double) x < -range / 2 + index * range / cells) {
+        index -= 1;
+    } else if (index < max_index && (double) x >= -range / 2 + (index + 1) * range / cells) {
+        index += 1;
+    }
+    return (uint32_t) index;
+}
+
+uint64_t geohash_encode(const float lat, const float lng, const size_t precision) {
+    const size_t bits = 5 * precision;
+    return _geohash_interleave_scalar(_geohash_cell_index(lat, 180.0, bits / 2),
+                                      _geohash_cell_index(lng, 360.0, bits - bits / 2), bits);
+}
+
+void geohash_encode_stream(const stream_t* stream, const size_t precision, uint64_t* out) {
+    const size_t bits = 5 * precision;
+    const size_t lat_bits = bits / 2;
+    const size_t lng_bits = bits - lat_bits;
+    const _geohash_interleave_t interleave = _select_geohash_interleave();
+    const float* data = stream->data;
+    for (size_t i = 0; i < stream->n; i++) {
+        out[i] = interleave(_geohash_cell_index(data[2*i + 0], 180.0, lat_bits),
+                            _geohash_cell_index(data[2*i + 1], 360.0, lng_bits), bits);
+    }
+}
+
+void geohash_decode(const uint64_t hash, const size_t precision, float* lat, float* lng) {
+    const size_t bits = 5 * precision;
+    const size_t lat_bits = bits / 2;
+    const size_t lng_bits = bits - lat_bits;
+    const uint32_t lat_index = (bits % 2 == 0) ? _geohash_squash(hash) : _geohash_squash(hash >> 1);
+    const uint32_t lng_index = (bits % 2 == 0) ? _geohash_squash(hash >> 1) : _geohash_squash(hash);
+    *lat = (float) (-90.0 + (lat_index + 0.5) * 180.0 / (double) (UINT64_C(1) << lat_bits));
+    *lng = (float) (-180.0 + (lng_index + 0.5) * 360.0 / (double) (UINT64_C(1) << lng_bits));
+}
+
+void geohash_to_string(const uint64_t hash, const size_t precision, char* out) {
+    for (size_t i = 0; i < precision; i++) {
+        out[i] = _geohash_alphabet[(hash >> (5 * (precision - 1 - i))) & 0x1f];
+    }
+    out[precision] = '\0';
+}
+
+int geohash_from_string(const char* text, const size_t length, uint64_t* hash) {
+    if (length == 0 || length > GEOHASH_MAX_PRECISION) {
+        return 0;
+    }
+    uint64_t value = 0;
+    for (size_t i = 0; i < length; i++) {
+        const char* digit = memchr(_geohash_alphabet, text[i], 32);
+        if (!digit) {
+            return 0;
+        }
+        value = (value << 5) | (uint64_t) (digit - _geohash_alphabet);
+    }
+    *hash = value;
+    return 1;
+}
+
+int _geohash_compare(const void* a, const void* b) {
+    const uint64_t x = *(const uint64_t*) a;
+    const uint64_t y = *(const uint64_t*) b;
+    return (x > y) - (x < y);
+}
+
+geohash_cells_t* geohash_cells_create(const stream_t* stream, const size_t precision) {
+    const size_t n = stream->n;
+    uint64_t* hashes = malloc((n ? n : 1) * sizeof(uint64_t));
+    geohash_encode_stream(stream, precision, hashes);
+    // Consecutive points mostly share a cell, so dropping runs first leaves little for the sort.
+    size_t unique = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (unique == 0 || hashes[i] != hashes[unique - 1]) {
+            hashes[unique++] = hashes[i];
+        }
+    }
+    qsort(hashes, unique, sizeof(uint64_t), _geohash_compare);
+    size_t distinct = 0;
+    for (size_t i = 0; i < unique; i++) {
+        if (distinct == 0 || hashes[i] != hashes[distinct - 1]) {
+            hashes[distinct++] = hashes[i];
+        }
+    }
+    geohash_cells_t* cells = malloc(sizeof(geohash_cells_t));
+    cells->cells = realloc(hashes, (distinct ? distinct : 1) * sizeof(uint64_t));
+    cells->n = distinct;
+    cells->precision = precision;
+    return cells;
+}
+
+void geohash_cells_destroy(const geohash_cells_t* cells) {
+    free(cells->cells);
+    free((void*) cells);
+}
+
+size_t geohash_cells_intersection_size(const geohash_cells_t* a, const geohash_cells_t* b) {
+    size_t i = 0, j = 0, common = 0;
+    while (i < a->n && j < b->n) {
+        common += (a->cells[i] == b->cells[j]);
+        const uint64_t x = a->cells[i];
+        const uint64_t y = b->cells[j];
+        i += (x <= y);
+        j += (y <= x);
+    }
+    return common;
+}
+
+int geohash_cells_overlap(const geohash_cells_t* a, const geohash_cells_t* b) {
+    size_t i = 0, j = 0;
+    while (i < a->n && j < b->n) {
+        if (a->cells[i] == b->cells[j]) {
+            return 1;
+        }
+        if (a->cells[i] < b->cells[j]) {
+            i++;
+        } else {
+            j++;
+        }
+    }
+    return 0;
+}
@@ -1,10 +1,378 @@
+#define _POSIX_C_SOURCE 200809L  // mmap
+
 #include <cstreamgeo/cstreamgeo.h>
 #include <cstreamgeo/io.h>
+#include <cstreamgeo/parallel.h>
+#include <cstreamgeo/utilc.h>
+#include <float.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
 #include <stddef.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <sys/types.h>
+#include <pthread.h>
+#ifdef STREAMGEO_HAVE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef STREAMGEO_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+#define BINARY_MAGIC "SGEOBIN"  // Eight bytes, including the terminator.
+#define BINARY_VERSION 1
+#define BINARY_BYTE_ORDER 0x01020304u
+#define BINARY_ALIGNMENT 64
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint64_t n_streams;
+    uint64_t index_offset;
+    uint64_t data_offset;
+    uint8_t reserved[24];
+} _binary_header_t;
+
+typedef struct {
+    uint64_t offset;
+    uint64_t n;
+} _binary_index_entry_t;
+
+_Static_assert(sizeof(_binary_header_t) == BINARY_ALIGNMENT, "binary header must fill one aligned block");
+
+uint64_t _binary_round_up(const uint64_t offset) {
+    return (offset + BINARY_ALIGNMENT - 1) & ~((uint64_t) BINARY_ALIGNMENT - 1);
+}
+
+// The collection handed out by stream_collection_mmap; `collection` must stay first so we can cast back.
+typedef struct {
+    stream_collection_t collection;
+    void* base;
+    size_t length;
+} _mapped_collection_t;
+
+/* ---------------- Compressed input ---------------- */
+
+#define SOURCE_BLOCK_BYTES (1 << 20)
+#define SOURCE_BLOCKS 4  // Decompressed blocks in flight between the decompression thread and the reader.
+
+typedef enum {
+    SOURCE_PLAIN,
+    SOURCE_GZIP,
+    SOURCE_ZSTD
+} _source_format_t;
+
+// A sequential reader over a possibly compressed file. A background thread decompresses fixed-size blocks into a
+// small ring while the caller parses earlier ones, so at most SOURCE_BLOCKS blocks are ever held in memory.
+typedef struct {
+    _source_format_t format;
+    FILE* fp;
+#ifdef STREAMGEO_HAVE_ZLIB
+    gzFile gz;
+#endif
+#ifdef STREAMGEO_HAVE_ZSTD
+    ZSTD_DStream* zstd;
+    ZSTD_inBuffer zstd_in;
+    size_t zstd_pending;  // Hint from the last ZSTD_decompressStream call that made progress; non-zero once fully
+                          // flushed means a truncated frame.
+    int zstd_eof;         // The file has been read to the end; only buffered output remains.
+#endif
+    unsigned char* compressed;  // Input buffer for decoders that do not read the file themselves.
+
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+    unsigned char* blocks[SOURCE_BLOCKS];
+    size_t lengths[SOURCE_BLOCKS];
+    size_t produced;     // Blocks filled by the decompression thread.
+    size_t consumed;     // Blocks fully read by the caller.
+    int finished;        // The decompression thread has stopped.
+    int failed;          // ... because the input was corrupt or truncated.
+    int closing;         // The caller wants the decompression thread to stop early.
+    size_t position;     // Caller's offset into block `consumed`.
+} _source_t;
+
+_source_format_t _source_format_of(const unsigned char* magic, const size_t n) {
+    if (n >= 2 && magic[0] == 0x1f && magic[1] == 0x8b) {
+        return SOURCE_GZIP;
+    }
+    if (n >= 4 && magic[0] == 0x28 && magic[1] == 0xb5 && magic[2] == 0x2f && magic[3] == 0xfd) {
+        return SOURCE_ZSTD;
+    }
+    return SOURCE_PLAIN;
+}
+
+// Decompresses up to `capacity` bytes; returns 0 at the end of input and -1 on error.
+long _source_decompress(_source_t* source, unsigned char* out, const size_t capacity) {
+    switch (source->format) {
+#ifdef STREAMGEO_HAVE_ZLIB
+        case SOURCE_GZIP: {
+            const int n = gzread(source->gz, out, (unsigned) capacity);
+            int error = Z_OK;
+            if (n == 0) {
+                gzerror(source->gz, &error);  // A truncated archive ends with Z_BUF_ERROR rather than a failed read.
+            }
+            return (error == Z_OK) ? n : -1;
+        }
+#endif
+#ifdef STREAMGEO_HAVE_ZSTD
+        case SOURCE_ZSTD: {
+            ZSTD_outBuffer zstd_out = {out, capacity, 0};
+            size_t in_before, out_before, hint;
+            while (zstd_out.pos < zstd_out.size) {
+                if (source->zstd_in.pos == source->zstd_in.size && !source->zstd_eof) {
+                    source->zstd_in.size = fread(source->compressed, 1, ZSTD_DStreamInSize(), source->fp);
+                    source->zstd_in.pos = 0;
+                    source->zstd_eof = (source->zstd_in.size == 0);
+                }
+                // Past the end of the file this runs on empty input, flushing output the decoder still holds
+                // (it may, whenever it last filled the output buffer).
+                in_before = source->zstd_in.pos;
+                out_before = zstd_out.pos;
+                hint = ZSTD_decompressStream(source->zstd, &zstd_out, &source->zstd_in);
+                if (ZSTD_isError(hint)) {
+                    return -1;
+                }
+                if (source->zstd_in.pos != in_before || zstd_out.pos != out_before) {
+                    source->zstd_pending = hint;
+                } else if (source->zstd_eof) {
+                    // Fully flushed. Anything still expected means the last frame was cut short (an idle call
+                    // after a complete frame just asks for the next frame's header, so it is not counted).
+                    if (source->zstd_pending != 0 && zstd_out.pos == 0) {
+                        return -1;
+                    }
+                    break;
+                }
+            }
+            return (long) zstd_out.pos;
+        }
+#endif
+        case SOURCE_PLAIN:
+            return (long) fread(out, 1, capacity, source->fp);
+        default:
+            return -1;
+    }
+}
+
+void* _source_decompress_task(void* context) {
+    _source_t* source = context;
+    while (1) {
+        pthread_mutex_lock(&source->lock);
+        while (source->produced - source->consumed == SOURCE_BLOCKS && !source->closing) {
+            pthread_cond_wait(&source->changed, &source->lock);
+        }
+        const int closing = source->closing;
+        const size_t slot = source->produced % SOURCE_BLOCKS;
+        pthread_mutex_unlock(&source->lock);
+        const long n = closing ? 0 : _source_decompress(source, source->blocks[slot], SOURCE_BLOCK_BYTES);
+
+        pthread_mutex_lock(&source->lock);
+        if (n <= 0) {
+            source->finished = 1;
+            source->failed = (n < 0);
+        } else {
+            source->lengths[slot] = (size_t) n;
+            source->produced++;
+        }
+        pthread_cond_broadcast(&source->changed);
+        pthread_mutex_unlock(&source->lock);
+        if (n <= 0) {
+            return NULL;
+        }
+    }
+}
+
+// Opens `filename` for sequential reading, decompressing it if it starts with gzip or zstd magic bytes.
+// Returns NULL (after saying why) if the file cannot be opened or this build cannot decode it.
+_source_t* _source_open(const char* filename) {
+    FILE* fp = fopen(filename, "rb");
+    if (!fp) {
+        printf("Unable to open file '%s' for reading.\n", filename);
+        return NULL;
+    }
+    unsigned char magic[4];
+    const _source_format_t format = _source_format_of(magic, fread(magic, 1, sizeof(magic), fp));
+    rewind(fp);
+    _source_t* source = calloc(1, sizeof(_source_t));
+    source->format = format;
+    source->fp = fp;
+    if (format == SOURCE_GZIP) {
+#ifdef STREAMGEO_HAVE_ZLIB
+        source->gz = gzdopen(dup(fileno(fp)), "rb");
+        gzbuffer(source->gz, SOURCE_BLOCK_BYTES);
+#else
+        printf("File '%s' is gzip-compressed, but cstreamgeo was built without zlib.\n", filename);
+        fclose(fp);
+        free(source);
+        return NULL;
+#endif
+    } else if (format == SOURCE_ZSTD) {
+#ifdef STREAMGEO_HAVE_ZSTD
+        source->zstd = ZSTD_createDStream();
+        source->zstd_pending = ZSTD_initDStream(source->zstd);
+        source->compressed = malloc(ZSTD_DStreamInSize());
+        source->zstd_in = (ZSTD_inBuffer) {source->compressed, 0, 0};
+#else
+        printf("File '%s' is zstd-compressed, but cstreamgeo was built without zstd.\n", filename);
+        fclose(fp);
+        free(source);
+        return NULL;
+#endif
+    }
+    for (size_t b = 0; b < SOURCE_BLOCKS; b++) {
+        source->blocks[b] = malloc(SOURCE_BLOCK_BYTES);
+    }
+    pthread_mutex_init(&source->lock, NULL);
+    pthread_cond_init(&source->changed, NULL);
+    pthread_create(&source->thread, NULL, _source_decompress_task, source);
+    return source;
+}
+
+// Reads up to `n` bytes into `out` (or skips them if `out` is NULL). Returns fewer than `n` only at end of input.
+size_t _source_read(_source_t* source, void* out, const size_t n) {
+    size_t total = 0;
+    while (total < n) {
+        pthread_mutex_lock(&source->lock);
+        while (source->produced == source->consumed && !source->finished) {
+            pthread_cond_wait(&source->changed, &source->lock);
+        }
+        const int empty = (source->produced == source->consumed);
+        pthread_mutex_unlock(&source->lock);
+        if (empty) {
+            break;
+        }
+        const size_t slot = source->consumed % SOURCE_BLOCKS;
+        const size_t step = MIN(n - total, source->lengths[slot] - source->position);
+        if (out) {
+            memcpy((unsigned char*) out + total, source->blocks[slot] + source->position, step);
+        }
+        total += step;
+        source->position += step;
+        if (source->position == source->lengths[slot]) {
+            source->position = 0;
+            pthread_mutex_lock(&source->lock);
+            source->consumed++;
+            pthread_cond_broadcast(&source->changed);
+            pthread_mutex_unlock(&source->lock);
+        }
+    }
+    return total;
+}
+
+// Whether decompression stopped on corrupt or truncated input. Only meaningful once a read has come up short.
+int _source_failed(_source_t* source) {
+    pthread_mutex_lock(&source->lock);
+    const int failed = source->failed;
+    pthread_mutex_unlock(&source->lock);
+    return failed;
+}
+
+// Closes the source; returns whether everything decompressed so far was valid.
+int _source_close(_source_t* source) {
+    pthread_mutex_lock(&source->lock);
+    source->closing = 1;
+    pthread_cond_broadcast(&source->changed);
+    pthread_mutex_unlock(&source->lock);
+    pthread_join(source->thread, NULL);
+    const int ok = !source->failed;
+#ifdef STREAMGEO_HAVE_ZLIB
+    if (source->format == SOURCE_GZIP) {
+        gzclose(source->gz);
+    }
+#endif
+#ifdef STREAMGEO_HAVE_ZSTD
+    if (source->format == SOURCE_ZSTD) {
+        ZSTD_freeDStream(source->zstd);
+    }
+#endif
+    for (size_t b = 0; b < SOURCE_BLOCKS; b++) {
+        free(source->blocks[b]);
+    }
+    free(source->compressed);
+    pthread_mutex_destroy(&source->lock);
+    pthread_cond_destroy(&source->changed);
+    fclose(source->fp);
+    free(source);
+    return ok;
+}
+
+// Reads `n` streams, each preceded by its size_t length, into `streams`. Returns how many were read in full.
+size_t _binary_read_legacy_source(_source_t* source, stream_collection_t* streams) {
+    size_t length;
+    for (size_t i = 0; i < streams->n; i++) {
+        if (_source_read(source, &length, sizeof(length)) != sizeof(length)) {
+            return i;
+        }
+        streams->data[i] = stream_create(length);
+        if (_source_read(source, streams->data[i]->data, 2 * length * sizeof(float)) != 2 * length * sizeof(float)) {
+            stream_destroy(streams->data[i]);
+            return i;
+        }
+    }
+    return streams->n;
+}
+
+// Reads the streams listed in `index` into `streams`, skipping padding; offsets must only move forward.
+// Returns how many were read in full.
+size_t _binary_read_versioned_source(_source_t* source, const _binary_index_entry_t* index, uint64_t position,
+                                     stream_collection_t* streams) {
+    for (size_t i = 0; i < streams->n; i++) {
+        if (index[i].offset < position ||
+            _source_read(source, NULL, index[i].offset - position) != index[i].offset - position) {
+            return i;
+        }
+        streams->data[i] = stream_create(index[i].n);
+        if (_source_read(source, streams->data[i]->data, 2 * index[i].n * sizeof(float)) !=
+            2 * index[i].n * sizeof(float)) {
+            stream_destroy(streams->data[i]);
+            return i;
+        }
+        position = index[i].offset + 2 * index[i].n * sizeof(float);
+    }
+    return streams->n;
+}
+
+// Reads either binary format sequentially from `source`, then closes it.
+stream_collection_t* _binary_read_source(_source_t* source, const char* filename) {
+    _binary_header_t header;
+    const size_t rest = sizeof(header) - sizeof(header.magic);
+    stream_collection_t* streams = NULL;
+    size_t n_read = 0;
+    if (_source_read(source, header.magic, sizeof(header.magic)) != sizeof(header.magic)) {
+        // Too short to hold even a stream count.
+    } else if (memcmp(header.magic, BINARY_MAGIC, sizeof(header.magic)) != 0) {
+        size_t n;
+        memcpy(&n, header.magic, sizeof(n));
+        streams = stream_collection_create(n);
+        n_read = _binary_read_legacy_source(source, streams);
+    } else if (_source_read(source, (char*) &header + sizeof(header.magic), rest) == rest &&
+               header.byte_order == BINARY_BYTE_ORDER && header.version == BINARY_VERSION &&
+               header.index_offset >= sizeof(header) &&
+               _source_read(source, NULL, header.index_offset - sizeof(header)) == header.index_offset - sizeof(header)) {
+        const size_t index_bytes = header.n_streams * sizeof(_binary_index_entry_t);
+        _binary_index_entry_t* index = malloc(MAX(index_bytes, 1));
+        if (index && _source_read(source, index, index_bytes) == index_bytes) {
+            streams = stream_collection_create(header.n_streams);
+            n_read = _binary_read_versioned_source(source, index, header.index_offset + index_bytes, streams);
+        }
+        free(index);
+    }
+    const int ok = _source_close(source);
+    if (!ok || !streams || n_read != streams->n) {
+        printf("File '%s' is corrupt or truncated.\n", filename);
+        if (streams) {
+            streams->n = n_read;
+            stream_collection_destroy(streams);
+        }
+        return NULL;
+    }
+    return streams;
+}
 
 stream_collection_t* stream_collection_create(const size_t n) {
     stream_collection_t* streams = malloc(sizeof(stream_collection_t));
@@ -32,30 +400,195 @@ void stream_collection_printf(const stream_collection_t* streams) {
     printf("]\n");
 }
 
-stream_t* _load_from_json_line(char* line) {
-    const char* delim = "[],";
-    stream_t* stream = malloc(sizeof(stream_t));
-    size_t capacity = 128;
-    size_t n_tokens = 0;
-    float* data = malloc(capacity * sizeof(float));
-    char *token;
-    for (token = strtok(line, delim); token; token = strtok(NULL, delim)) {
-        float num = strtof(token, NULL);
-        if (n_tokens == capacity) {
-            data = realloc(data, 2 * capacity * sizeof(float));
-            capacity *= 2;
+// Exact powers of ten for Clinger's fast path: m * 10^e is correctly rounded when m < 2^53 and |e| <= 22.
+static const double _json_powers_of_ten[23] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+#define JSON_FAST_DIGITS 15    // 10^15 < 2^53, so the mantissa is exact in a double.
+#define JSON_MAX_NUMBER 64     // Longest number copied to the stack for the strtof fallback; longer ones go on the heap.
+#define JSON_CHUNK_BYTES (1 << 20)     // Smallest slice of a file worth handing to another thread.
+#define JSON_CHUNKS_PER_THREAD 16      // Enough slices per thread for work stealing to even out long lines.
+
+typedef struct {
+    const char* p;           // Next unread character.
+    const char* end;         // One past the last character.
+    const char* line_start;  // First character of the current line, for column numbers.
+    size_t line;             // 1-based line of `p`.
+    json_error_t* error;
+} _json_parser_t;
+
+int _json_fail(_json_parser_t* parser, const char* message) {
+    if (parser->error) {
+        parser->error->line = parser->line;
+        parser->error->column = (size_t) (parser->p - parser->line_start) + 1;
+        parser->error->message = message;
+    }
+    return 0;
+}
+
+void _json_skip_whitespace(_json_parser_t* parser) {
+    while (parser->p < parser->end) {
+        const char c = *parser->p;
+        if (c == '\n') {
+            parser->line++;
+            parser->line_start = parser->p + 1;
+        } else if (c != ' ' && c != '\t' && c != '\r') {
+            return;
         }
-        data[n_tokens] = num;
-        n_tokens++;
+        parser->p++;
     }
-    stream->data = data;
-    stream->n = n_tokens / 2;
-    return stream;
 }
 
-void _write_stream_to_fp(FILE* fp, const stream_t* stream) {
-    fwrite(&(stream->n), sizeof(size_t), 1, fp);
-    fwrite(stream->data, sizeof(float), stream->n * 2, fp);
+int _json_expect(_json_parser_t* parser, const char c, const char* message) {
+    _json_skip_whitespace(parser);
+    if (parser->p == parser->end || *parser->p != c) {
+        return _json_fail(parser, message);
+    }
+    parser->p++;
+    return 1;
+}
+
+// Rounding a correctly rounded double to float is only wrong when the double sits exactly halfway between two floats.
+int _json_is_float_midpoint(const double d) {
+    uint64_t bits;
+    memcpy(&bits, &d, sizeof(bits));
+    return (bits & ((UINT64_C(1) << 29) - 1)) == (UINT64_C(1) << 28);
+}
+
+// Parses one JSON number into the nearest float. Plain decimals of up to 15 significant digits -- all of our data --
+// take an integer fast path; anything else (exponents, long mantissas, halfway cases) falls back to strtof.
+int _json_parse_float(_json_parser_t* parser, float* out) {
+    _json_skip_whitespace(parser);
+    const char* start = parser->p;
+    const char* p = start;
+    const char* end = parser->end;
+    int negative = 0;
+    if (p < end && *p == '-') {
+        negative = 1;
+        p++;
+    }
+    if (p == end || *p < '0' || *p > '9') {
+        return _json_fail(parser, "expected a number");
+    }
+    uint64_t mantissa = 0;
+    int digits = 0;       // Significant digits accumulated into the mantissa.
+    int scale = 0;        // Power of ten to divide the mantissa by.
+    int exact = 1;        // Whether the fast path applies.
+    if (*p == '0') {
+        p++;
+    } else {
+        for (; p < end && *p >= '0' && *p <= '9'; p++) {
+            mantissa = 10 * mantissa + (uint64_t) (*p - '0');
+            digits++;
+        }
+    }
+    if (p < end && *p == '.') {
+        p++;
+        if (p == end || *p < '0' || *p > '9') {
+            parser->p = p;
+            return _json_fail(parser, "expected a digit after the decimal point");
+        }
+        for (; p < end && *p >= '0' && *p <= '9'; p++) {
+            if (digits == 0 && *p == '0') {
+                scale++;  // Leading zeros of a fraction are not significant.
+                continue;
+            }
+            mantissa = 10 * mantissa + (uint64_t) (*p - '0');
+            digits++;
+            scale++;
+        }
+    }
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        exact = 0;
+        p++;
+        if (p < end && (*p == '+' || *p == '-')) {
+            p++;
+        }
+        if (p == end || *p < '0' || *p > '9') {
+            parser->p = p;
+            return _json_fail(parser, "expected a digit in the exponent");
+        }
+        while (p < end && *p >= '0' && *p <= '9') {
+            p++;
+        }
+    }
+    if (digits > JSON_FAST_DIGITS || scale > 22) {
+        exact = 0;
+    }
+    if (exact) {
+        const double d = (double) mantissa / _json_powers_of_ten[scale];
+        if (!_json_is_float_midpoint(d) && (d == 0.0 || (d >= FLT_MIN && d <= FLT_MAX))) {
+            *out = (float) (negative ? -d : d);
+            parser->p = p;
+            return 1;
+        }
+    }
+    // The text is not NUL-terminated, so strtof needs a copy.
+    const size_t length = (size_t) (p - start);
+    char stack_buffer[JSON_MAX_NUMBER];
+    char* buffer = (length < JSON_MAX_NUMBER) ? stack_buffer : malloc(length + 1);
+    memcpy(buffer, start, length);
+    buffer[length] = '\0';
+    *out = strtof(buffer, NULL);
+    if (buffer != stack_buffer) {
+        free(buffer);
+    }
+    parser->p = p;
+    return 1;
+}
+
+// Upper bound on the points in a stream spanning [p, end): "[[a,b],[c,d],...]" has 2n - 1 commas.
+size_t _json_count_points(const char* p, const char* end) {
+    size_t commas = 0;
+    for (; p < end; p++) {
+        commas += (*p == ',');
+    }
+    return (commas + 1) / 2;
+}
+
+stream_t* _json_parse_stream(_json_parser_t* parser) {
+    _json_skip_whitespace(parser);
+    stream_t* stream = stream_create(_json_count_points(parser->p, parser->end));
+    size_t n = 0;
+    size_t capacity = stream->n;
+    if (!_json_expect(parser, '[', "expected '[' to open a stream")) {
+        stream_destroy(stream);
+        return NULL;
+    }
+    _json_skip_whitespace(parser);
+    if (parser->p < parser->end && *parser->p == ']') {
+        parser->p++;
+        stream->n = 0;
+        return stream;
+    }
+    while (1) {
+        if (n == capacity) {  // Cannot happen for well-formed input, since the comma count is an upper bound.
+            capacity = 2 * capacity + 1;
+            stream->data = realloc(stream->data, 2 * capacity * sizeof(float));
+        }
+        if (!_json_expect(parser, '[', "expected '[' to open a point") ||
+            !_json_parse_float(parser, &stream->data[2*n + 0]) ||
+            !_json_expect(parser, ',', "expected ',' between latitude and longitude") ||
+            !_json_parse_float(parser, &stream->data[2*n + 1]) ||
+            !_json_expect(parser, ']', "expected ']' to close a point")) {
+            stream_destroy(stream);
+            return NULL;
+        }
+        n++;
+        _json_skip_whitespace(parser);
+        if (parser->p < parser->end && *parser->p == ',') {
+            parser->p++;
+            continue;
+        }
+        if (!_json_expect(parser, ']', "expected ',' or ']' after a point")) {
+            stream_destroy(stream);
+            return NULL;
+        }
+        break;
+    }
+    stream->n = n;
+    return stream;
 }
 
 stream_t* _read_stream_from_fp(FILE* fp) {
@@ -69,36 +602,236 @@ stream_t* _read_stream_from_fp(FILE* fp) {
 
 /* ---------------- Exposed functions ---------------- */
 
-const stream_collection_t* read_streams_from_json(const char* filename) {
-    FILE* fp = fopen(filename, "r");
-    if (!fp) {
-        printf("Unable to open file '%s' for reading.\n", filename);
+stream_t* parse_stream_from_json(const char* text, const size_t length, json_error_t* error) {
+    _json_parser_t parser = {text, text + length, text, 1, error};
+    stream_t* stream = _json_parse_stream(&parser);
+    if (!stream) {
         return NULL;
     }
-    stream_collection_t* streams = malloc(sizeof(stream_collection_t));
-    size_t capacity = 8;
+    _json_skip_whitespace(&parser);
+    if (parser.p != parser.end) {
+        _json_fail(&parser, "unexpected trailing characters");
+        stream_destroy(stream);
+        return NULL;
+    }
+    return stream;
+}
+
+// Streams parsed from one newline-aligned slice of a file.
+typedef struct {
+    const char* begin;
+    const char* end;
+    stream_t** data;
+    size_t n;
+    size_t lines;        // Newlines in [begin, end), to turn later chunks' local line numbers into global ones.
+    int failed;
+    json_error_t error;  // Line is local to the chunk.
+} _json_chunk_t;
+
+typedef struct {
+    _json_chunk_t* chunks;
+} _json_chunks_t;
+
+// Parses every line of a chunk as one stream, skipping blank lines, and stops at the first malformed line.
+void _json_parse_chunk(_json_chunk_t* chunk) {
+    size_t capacity = 16;
+    chunk->data = malloc(capacity * sizeof(stream_t*));
+    chunk->n = 0;
+    chunk->lines = 0;
+    chunk->failed = 0;
+    const char* line = chunk->begin;
+    while (line < chunk->end) {
+        const char* line_end = memchr(line, '\n', (size_t) (chunk->end - line));
+        if (!line_end) {
+            line_end = chunk->end;
+        }
+        _json_parser_t parser = {line, line_end, line, chunk->lines + 1, &chunk->error};
+        _json_skip_whitespace(&parser);
+        if (parser.p < parser.end) {
+            stream_t* stream = _json_parse_stream(&parser);
+            if (stream) {
+                _json_skip_whitespace(&parser);
+                if (parser.p != parser.end) {
+                    _json_fail(&parser, "expected one stream per line");
+                    stream_destroy(stream);
+                    stream = NULL;
+                }
+            }
+            if (!stream) {
+                chunk->failed = 1;
+                return;
+            }
+            if (chunk->n == capacity) {
+                capacity *= 2;
+                chunk->data = realloc(chunk->data, capacity * sizeof(stream_t*));
+            }
+            chunk->data[chunk->n++] = stream;
+        }
+        if (line_end == chunk->end) {
+            break;
+        }
+        chunk->lines++;
+        line = line_end + 1;
+    }
+}
+
+void _json_parse_chunk_task(void* context, const size_t index, const size_t thread_id) {
+    (void) thread_id;
+    _json_parse_chunk(&((_json_chunks_t*) context)->chunks[index]);
+}
+
+// Splits `text` into chunks at newline boundaries, parses them on `nthreads` threads, and stitches the streams back
+// together in line order. Reports the first malformed line against `filename`.
+stream_collection_t* _json_parse_lines(const char* text, const size_t length, const char* filename,
+                                       const size_t nthreads) {
+    const size_t threads = nthreads ? nthreads : parallel_default_threads();
+    const size_t n_chunks = MAX(1, MIN(length / JSON_CHUNK_BYTES, JSON_CHUNKS_PER_THREAD * threads));
+    _json_chunk_t* chunks = malloc(n_chunks * sizeof(_json_chunk_t));
+    const char* end = text + length;
+    const char* begin = text;
+    for (size_t c = 0; c < n_chunks; c++) {
+        const char* nominal = text + (c + 1) * (length / n_chunks);
+        chunks[c].begin = begin;
+        if (c + 1 == n_chunks) {
+            chunks[c].end = end;
+        } else if (nominal <= begin) {
+            chunks[c].end = begin;  // An earlier chunk's last line already runs past this one.
+        } else {
+            const char* newline = memchr(nominal, '\n', (size_t) (end - nominal));
+            chunks[c].end = newline ? newline + 1 : end;
+        }
+        begin = chunks[c].end;
+    }
+    _json_chunks_t context = {chunks};
+    parallel_for(n_chunks, threads, _json_parse_chunk_task, &context);
+
     size_t n_streams = 0;
-    stream_t** data = malloc(capacity * sizeof(stream_t *));
-    char* line;
-    size_t line_size = 512; // unused, but a hint to the getline fn
-    ssize_t characters; // also unused
-    line = malloc(line_size * sizeof(char));
-    if (line == NULL) {
-        perror("Unable to allocate buffer for getline()");
-    }
-    while ((characters = getline(&line, &line_size , fp)) != -1) {
-        stream_t* stream = _load_from_json_line(line);
-        if (n_streams == capacity) {
-            data = realloc(data, 2 * capacity * sizeof(stream_t*));
+    size_t lines_before = 0;
+    int failed = 0;
+    for (size_t c = 0; c < n_chunks; c++) {
+        if (!failed && chunks[c].failed) {
+            failed = 1;
+            printf("%s:%zu:%zu: %s\n", filename, lines_before + chunks[c].error.line, chunks[c].error.column,
+                   chunks[c].error.message);
+        }
+        lines_before += chunks[c].lines;
+        n_streams += chunks[c].n;
+    }
+    stream_collection_t* streams = failed ? NULL : stream_collection_create(n_streams);
+    n_streams = 0;
+    for (size_t c = 0; c < n_chunks; c++) {
+        for (size_t i = 0; i < chunks[c].n; i++) {
+            if (failed) {
+                stream_destroy(chunks[c].data[i]);
+            } else {
+                streams->data[n_streams++] = chunks[c].data[i];
+            }
+        }
+        free(chunks[c].data);
+    }
+    free(chunks);
+    return streams;
+}
+
+// Parses newline-delimited streams from `source` as it decompresses, holding only the unparsed tail in memory,
+// then closes it.
+stream_collection_t* _json_parse_source(_source_t* source, const char* filename) {
+    size_t capacity = 2 * SOURCE_BLOCK_BYTES;
+    size_t length = 0;
+    char* text = malloc(capacity);
+    size_t stream_capacity = 16;
+    stream_collection_t* streams = stream_collection_create(stream_capacity);
+    streams->n = 0;
+    size_t lines_before = 0;
+    int done = 0;
+    int failed = 0;
+    while (!done && !failed) {
+        if (length == capacity) {  // A single line longer than the buffer.
             capacity *= 2;
+            text = realloc(text, capacity);
+        }
+        const size_t wanted = capacity - length;
+        const size_t got = _source_read(source, text + length, wanted);
+        length += got;
+        done = (got < wanted);
+        if (done && _source_failed(source)) {
+            break;  // Reported below; the tail of a truncated archive is not worth a parse error.
+        }
+        // Parse every complete line, and carry the partial last line over to the next read.
+        const char* cut = text + length;
+        if (!done) {
+            while (cut > text && cut[-1] != '\n') {
+                cut--;
+            }
+        }
+        _json_chunk_t chunk = {text, cut, NULL, 0, 0, 0, {0, 0, NULL}};
+        _json_parse_chunk(&chunk);
+        if (chunk.failed) {
+            printf("%s:%zu:%zu: %s\n", filename, lines_before + chunk.error.line, chunk.error.column,
+                   chunk.error.message);
+            failed = 1;
+        }
+        if (streams->n + chunk.n > stream_capacity) {
+            stream_capacity = MAX(2 * stream_capacity, streams->n + chunk.n);
+            streams->data = realloc(streams->data, stream_capacity * sizeof(stream_t*));
         }
-        data[n_streams] = stream;
-        n_streams++;
+        memcpy(streams->data + streams->n, chunk.data, chunk.n * sizeof(stream_t*));
+        streams->n += chunk.n;
+        free(chunk.data);
+        lines_before += chunk.lines;
+        length -= (size_t) (cut - text);
+        memmove(text, cut, length);
+    }
+    free(text);
+    if (!_source_close(source) && !failed) {  // Also catches corruption found before the parse caught up.
+        printf("File '%s' is corrupt or truncated.\n", filename);
+        failed = 1;
+    }
+    if (failed) {
+        stream_collection_destroy(streams);
+        return NULL;
     }
-    free(line);
-    streams->data = data;
-    streams->n = n_streams;
-    fclose(fp);
+    return streams;
+}
+
+const stream_collection_t* read_streams_from_json(const char* filename) {
+    return read_streams_from_json_parallel(filename, 1);
+}
+
+const stream_collection_t* read_streams_from_json_parallel(const char* filename, const size_t nthreads) {
+    const int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        printf("Unable to open file '%s' for reading.\n", filename);
+        return NULL;
+    }
+    unsigned char magic[4];
+    const ssize_t magic_read = pread(fd, magic, sizeof(magic), 0);
+    if (magic_read > 0 && _source_format_of(magic, (size_t) magic_read) != SOURCE_PLAIN) {
+        // Compressed input cannot be mapped; stream it through a decompression thread instead.
+        close(fd);
+        _source_t* source = _source_open(filename);
+        return source ? _json_parse_source(source, filename) : NULL;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        printf("Unable to read file '%s'.\n", filename);
+        close(fd);
+        return NULL;
+    }
+    const size_t length = (size_t) st.st_size;
+    if (length == 0) {
+        close(fd);
+        return stream_collection_create(0);
+    }
+    void* base = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        printf("Unable to map file '%s'.\n", filename);
+        return NULL;
+    }
+    posix_madvise(base, length, POSIX_MADV_SEQUENTIAL);
+    stream_collection_t* streams = _json_parse_lines(base, length, filename, nthreads);
+    munmap(base, length);
     return streams;
 }
 
@@ -114,6 +847,29 @@ const stream_collection_t* read_streams_from_binary(const char* filename) {
         printf("Unable to open file '%s' for reading.\n", filename);
         return NULL;
     }
+    char magic[sizeof(BINARY_MAGIC)] = {0};
+    const size_t magic_read = fread(magic, 1, sizeof(magic), fp);
+    if (_source_format_of((const unsigned char*) magic, magic_read) != SOURCE_PLAIN) {
+        fclose(fp);
+        _source_t* source = _source_open(filename);
+        return source ? _binary_read_source(source, filename) : NULL;
+    }
+    if (magic_read == sizeof(magic) && memcmp(magic, BINARY_MAGIC, sizeof(magic)) == 0) {
+        fclose(fp);
+        // Versioned format: copy every stream out of a temporary mapping so the result owns its memory.
+        const stream_collection_t* mapped = stream_collection_mmap(filename);
+        if (!mapped) {
+            return NULL;
+        }
+        stream_collection_t* streams = stream_collection_create(mapped->n);
+        for (size_t i = 0; i < mapped->n; i++) {
+            streams->data[i] = stream_create(mapped->data[i]->n);
+            memcpy(streams->data[i]->data, mapped->data[i]->data, 2 * mapped->data[i]->n * sizeof(float));
+        }
+        stream_collection_munmap(mapped);
+        return streams;
+    }
+    rewind(fp);
     stream_collection_t* streams = malloc(sizeof(stream_collection_t));
     fread(&(streams->n), sizeof(size_t), 1, fp);
     streams->data = malloc(streams->n * sizeof(stream_t *));
@@ -130,11 +886,105 @@ void write_streams_to_binary(const char* filename, const stream_collection_t* st
         printf("Unable to open file '%s' for writing.\n", filename);
         return;  // TODO Fail more noisily
     }
-    fwrite(&(streams->n), sizeof(size_t), 1, fp);
-    for (size_t i = 0; i < streams->n; ++i) {
-        _write_stream_to_fp(fp, streams->data[i]);
+    const size_t n = streams->n;
+    const uint64_t index_offset = sizeof(_binary_header_t);
+    const uint64_t data_offset = _binary_round_up(index_offset + n * sizeof(_binary_index_entry_t));
+    _binary_header_t header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, BINARY_MAGIC, sizeof(header.magic));
+    header.version = BINARY_VERSION;
+    header.byte_order = BINARY_BYTE_ORDER;
+    header.n_streams = n;
+    header.index_offset = index_offset;
+    header.data_offset = data_offset;
+    fwrite(&header, sizeof(header), 1, fp);
+
+    _binary_index_entry_t entry;
+    uint64_t offset = data_offset;
+    for (size_t i = 0; i < n; i++) {
+        entry.offset = offset;
+        entry.n = streams->data[i]->n;
+        fwrite(&entry, sizeof(entry), 1, fp);
+        offset = _binary_round_up(offset + 2 * entry.n * sizeof(float));
+    }
+
+    const char padding[BINARY_ALIGNMENT] = {0};
+    uint64_t position = index_offset + n * sizeof(_binary_index_entry_t);
+    for (size_t i = 0; i < n; i++) {
+        fwrite(padding, 1, _binary_round_up(position) - position, fp);
+        position = _binary_round_up(position);
+        fwrite(streams->data[i]->data, sizeof(float), 2 * streams->data[i]->n, fp);
+        position += 2 * streams->data[i]->n * sizeof(float);
     }
     fclose(fp);
 }
 
+const stream_collection_t* stream_collection_mmap(const char* filename) {
+    const int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        printf("Unable to open file '%s' for reading.\n", filename);
+        return NULL;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t) st.st_size < sizeof(_binary_header_t)) {
+        printf("File '%s' is too small to be a stream collection.\n", filename);
+        close(fd);
+        return NULL;
+    }
+    const size_t length = (size_t) st.st_size;
+    void* base = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);  // The mapping keeps its own reference to the file.
+    if (base == MAP_FAILED) {
+        printf("Unable to map file '%s'.\n", filename);
+        return NULL;
+    }
+
+    const _binary_header_t* header = base;
+    const char* problem = NULL;
+    if (memcmp(header->magic, BINARY_MAGIC, sizeof(header->magic)) != 0) {
+        problem = "is not a versioned stream collection";
+    } else if (header->byte_order != BINARY_BYTE_ORDER) {
+        problem = "was written with a different byte order";
+    } else if (header->version != BINARY_VERSION) {
+        problem = "has an unsupported version";
+    } else if (header->index_offset > length ||
+               header->n_streams > (length - header->index_offset) / sizeof(_binary_index_entry_t)) {
+        problem = "has a truncated index";
+    }
+    const _binary_index_entry_t* index = (const _binary_index_entry_t*) ((const char*) base + header->index_offset);
+    for (uint64_t i = 0; !problem && i < header->n_streams; i++) {
+        if (index[i].offset % BINARY_ALIGNMENT != 0 || index[i].offset > length ||
+            index[i].n > (length - index[i].offset) / (2 * sizeof(float))) {
+            problem = "has a stream outside the file";
+        }
+    }
+    if (problem) {
+        printf("File '%s' %s.\n", filename, problem);
+        munmap(base, length);
+        return NULL;
+    }
+
+    // One allocation: the collection, its pointer array, then the stream headers themselves.
+    const size_t n = header->n_streams;
+    _mapped_collection_t* mapped = malloc(sizeof(_mapped_collection_t) + n * (sizeof(stream_t*) + sizeof(stream_t)));
+    stream_t** pointers = (stream_t**) (mapped + 1);
+    stream_t* headers = (stream_t*) (pointers + n);
+    for (size_t i = 0; i < n; i++) {
+        headers[i].data = (float*) ((char*) base + index[i].offset);
+        headers[i].n = index[i].n;
+        pointers[i] = &headers[i];
+    }
+    mapped->collection.data = pointers;
+    mapped->collection.n = n;
+    mapped->base = base;
+    mapped->length = length;
+    return &mapped->collection;
+}
+
+void stream_collection_munmap(const stream_collection_t* streams) {
+    const _mapped_collection_t* mapped = (const _mapped_collection_t*) streams;
+    munmap(mapped->base, mapped->length);
+    free((void*) mapped);
+}
+
 
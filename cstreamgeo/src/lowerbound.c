@@ -0,0 +1,121 @@
+#include <cstreamgeo/lowerbound.h>
+#include <cstreamgeo/utilc.h>
+#include <stdlib.h>
+#include <math.h>
+
+/**
+ * Lower bounds used to reject hopeless pairs before paying for an alignment. See lowerbound.h.
+ */
+
+
+bounding_box_t stream_bounding_box(const stream_t* stream) {
+    const size_t n = stream->n;
+    const float* data = stream->data;
+    bounding_box_t box = {data[0], data[0], data[1], data[1]};
+    for (size_t i = 1; i < n; i++) {
+        box.min_lat = MIN(box.min_lat, data[2*i + 0]);
+        box.max_lat = MAX(box.max_lat, data[2*i + 0]);
+        box.min_lng = MIN(box.min_lng, data[2*i + 1]);
+        box.max_lng = MAX(box.max_lng, data[2*i + 1]);
+    }
+    return box;
+}
+
+// Sliding-window min and max of one coordinate (`offset` 0 = lat, 1 = lng) of an interleaved stream buffer, using
+// monotonic deques of indices (O(n) total). Results are written with the same interleaved layout.
+void _sliding_extrema(const float* data, const size_t n, const size_t offset, const size_t window,
+                      size_t* min_deque, size_t* max_deque, float* lower, float* upper) {
+    size_t min_head = 0, min_tail = 0;
+    size_t max_head = 0, max_tail = 0;
+    for (size_t r = 0; r < n + window; r++) {
+        if (r < n) {
+            const float v = data[2*r + offset];
+            while (min_tail > min_head && data[2*min_deque[min_tail - 1] + offset] >= v) min_tail--;
+            min_deque[min_tail++] = r;
+            while (max_tail > max_head && data[2*max_deque[max_tail - 1] + offset] <= v) max_tail--;
+            max_deque[max_tail++] = r;
+        }
+        if (r < window) continue;
+        // Emit the window centered on i = r - window, which covers [i - window, i + window].
+        const size_t i = r - window;
+        while (min_deque[min_head] + window < i) min_head++;
+        while (max_deque[max_head] + window < i) max_head++;
+        lower[2*i + offset] = data[2*min_deque[min_head] + offset];
+        upper[2*i + offset] = data[2*max_deque[max_head] + offset];
+    }
+}
+
+stream_envelope_t* stream_envelope_create(const stream_t* stream, const size_t window) {
+    return stream_envelope_create_ws(stream, window, NULL);
+}
+
+stream_envelope_t* stream_envelope_create_ws(const stream_t* stream, const size_t window, streamgeo_workspace_t* ws) {
+    const size_t n = stream->n;
+    stream_envelope_t* envelope = streamgeo_workspace_alloc(ws, sizeof(stream_envelope_t));
+    envelope->n = n;
+    envelope->window = window;
+    envelope->lower = streamgeo_workspace_alloc(ws, 2 * n * sizeof(float));
+    envelope->upper = streamgeo_workspace_alloc(ws, 2 * n * sizeof(float));
+    size_t* deques = streamgeo_workspace_alloc(ws, 2 * n * sizeof(size_t));
+    _sliding_extrema(stream->data, n, 0, window, deques, deques + n, envelope->lower, envelope->upper);
+    _sliding_extrema(stream->data, n, 1, window, deques, deques + n, envelope->lower, envelope->upper);
+    streamgeo_workspace_free(ws, deques);
+    return envelope;
+}
+
+void stream_envelope_destroy(const stream_envelope_t* envelope) {
+    stream_envelope_destroy_ws(envelope, NULL);
+}
+
+void stream_envelope_destroy_ws(const stream_envelope_t* envelope, streamgeo_workspace_t* ws) {
+    streamgeo_workspace_free(ws, envelope->lower);
+    streamgeo_workspace_free(ws, envelope->upper);
+    streamgeo_workspace_free(ws, (void*) envelope);
+}
+
+float lb_bounding_box(const bounding_box_t* a, const bounding_box_t* b) {
+    const float lat_gap = MAX(0.0f, MAX(b->min_lat - a->max_lat, a->min_lat - b->max_lat));
+    const float lng_gap = MAX(0.0f, MAX(b->min_lng - a->max_lng, a->min_lng - b->max_lng));
+    return sqrtf((lng_gap * lng_gap) + (lat_gap * lat_gap));
+}
+
+float lb_kim(const stream_t* a, const bounding_box_t* a_box, const stream_t* b, const bounding_box_t* b_box) {
+    const float* a_data = a->data;
+    const float* b_data = b->data;
+    const size_t a_n = a->n;
+    const size_t b_n = b->n;
+    // DTW always aligns first-to-first and last-to-last.
+    float lat_diff = b_data[0] - a_data[0];
+    float lng_diff = b_data[1] - a_data[1];
+    float bound = (lng_diff * lng_diff) + (lat_diff * lat_diff);
+    lat_diff = b_data[2*(b_n - 1) + 0] - a_data[2*(a_n - 1) + 0];
+    lng_diff = b_data[2*(b_n - 1) + 1] - a_data[2*(a_n - 1) + 1];
+    bound = MAX(bound, (lng_diff * lng_diff) + (lat_diff * lat_diff));
+    bound = sqrtf(bound);
+    // Extremal points must be aligned to something no more extreme than the other stream's extent.
+    bound = MAX(bound, fabsf(a_box->min_lat - b_box->min_lat));
+    bound = MAX(bound, fabsf(a_box->max_lat - b_box->max_lat));
+    bound = MAX(bound, fabsf(a_box->min_lng - b_box->min_lng));
+    bound = MAX(bound, fabsf(a_box->max_lng - b_box->max_lng));
+    return bound;
+}
+
+float lb_keogh(const stream_envelope_t* envelope, const stream_t* candidate) {
+    const size_t q_n = envelope->n;
+    const float* lower = envelope->lower;
+    const float* upper = envelope->upper;
+    const size_t c_n = candidate->n;
+    const float* c_data = candidate->data;
+    float bound = 0.0f;
+    float lat, lng, lat_excess, lng_excess;
+    size_t i;
+    for (size_t j = 0; j < c_n; j++) {
+        i = (j * (q_n - 1) + (c_n - 1) / 2) / (c_n - 1);
+        lat = c_data[2*j + 0];
+        lng = c_data[2*j + 1];
+        lat_excess = MAX(0.0f, MAX(lower[2*i + 0] - lat, lat - upper[2*i + 0]));
+        lng_excess = MAX(0.0f, MAX(lower[2*i + 1] - lng, lng - upper[2*i + 1]));
+        bound = MAX(bound, (lng_excess * lng_excess) + (lat_excess * lat_excess));
+    }
+    return sqrtf(bound);
+}
@@ -0,0 +1,334 @@
+#include <cstreamgeo/cstreamgeo.h>
+#include <cstreamgeo/utilc.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+/**
+ * Shape similarity metrics that, unlike DTW, look at the worst-matched point rather than the sum over an alignment.
+ */
+
+#define HAUSDORFF_POINTS_PER_CELL 2
+#define HAUSDORFF_SHUFFLE_SEED 0x9E3779B97F4A7C15ull
+
+// Points of a stream bucketed into a uniform grid of square cells, stored cell by cell (CSR layout).
+typedef struct {
+    float min_lat;
+    float min_lng;
+    float cell;          // Side of a cell, in degrees.
+    size_t n_rows;       // Cells along latitude.
+    size_t n_cols;       // Cells along longitude.
+    size_t* starts;      // Points of cell (row, col) are [starts[row * n_cols + col], starts[row * n_cols + col + 1]).
+    float* points;       // [lat, lng] of every point, grouped by cell.
+} _point_grid_t;
+
+size_t _point_grid_index(const float x, const float min, const float cell, const size_t n) {
+    const float scaled = (x - min) / cell;
+    return (scaled <= 0) ? 0 : MIN((size_t) scaled, n - 1);
+}
+
+_point_grid_t _point_grid_create(const stream_t* stream) {
+    const size_t n = stream->n;
+    const float* data = stream->data;
+    float min_lat = data[0], max_lat = data[0], min_lng = data[1], max_lng = data[1];
+    for (size_t i = 1; i < n; i++) {
+        min_lat = MIN(min_lat, data[2*i + 0]);
+        max_lat = MAX(max_lat, data[2*i + 0]);
+        min_lng = MIN(min_lng, data[2*i + 1]);
+        max_lng = MAX(max_lng, data[2*i + 1]);
+    }
+    // About HAUSDORFF_POINTS_PER_CELL points per cell; never narrower than the long side over the target cell count,
+    // so a thin bounding box cannot blow up the number of cells.
+    const float height = max_lat - min_lat;
+    const float width = max_lng - min_lng;
+    const size_t target_cells = MAX(n / HAUSDORFF_POINTS_PER_CELL, 1);
+    float cell = MAX(sqrtf(width * height / target_cells), MAX(width, height) / target_cells);
+    if (!(cell > 0)) {
+        cell = 1.0f;  // Every point is identical.
+    }
+    _point_grid_t grid;
+    grid.min_lat = min_lat;
+    grid.min_lng = min_lng;
+    grid.cell = cell;
+    grid.n_rows = (size_t) (height / cell) + 1;
+    grid.n_cols = (size_t) (width / cell) + 1;
+    const size_t n_cells = grid.n_rows * grid.n_cols;
+    grid.starts = calloc(n_cells + 1, sizeof(size_t));
+    grid.points = malloc(2 * n * sizeof(float));
+    size_t* cells = malloc(n * sizeof(size_t));
+    for (size_t i = 0; i < n; i++) {
+        cells[i] = _point_grid_index(data[2*i + 0], min_lat, cell, grid.n_rows) * grid.n_cols +
+                   _point_grid_index(data[2*i + 1], min_lng, cell, grid.n_cols);
+        grid.starts[cells[i] + 1]++;
+    }
+    for (size_t c = 0; c < n_cells; c++) {
+        grid.starts[c + 1] += grid.starts[c];
+    }
+    // Counting sort; `cursor` walks each cell's slots as they fill.
+    size_t* cursor = malloc(n_cells * sizeof(size_t));
+    for (size_t c = 0; c < n_cells; c++) {
+        cursor[c] = grid.starts[c];
+    }
+    for (size_t i = 0; i < n; i++) {
+        const size_t slot = cursor[cells[i]]++;
+        grid.points[2*slot + 0] = data[2*i + 0];
+        grid.points[2*slot + 1] = data[2*i + 1];
+    }
+    free(cursor);
+    free(cells);
+    return grid;
+}
+
+void _point_grid_destroy(const _point_grid_t* grid) {
+    free(grid->starts);
+    free(grid->points);
+}
+
+// Lowers `best` to the squared distance from (lat, lng) to the nearest point of one cell. Returns 1 if it found a
+// point closer than `floor`, at which point the caller may stop looking.
+int _point_grid_scan_cell(const _point_grid_t* grid, const size_t row, const size_t col, const float lat,
+                          const float lng, const float floor, float* best) {
+    const size_t cell = row * grid->n_cols + col;
+    float lat_diff, lng_diff, d;
+    for (size_t p = grid->starts[cell]; p < grid->starts[cell + 1]; p++) {
+        lat_diff = grid->points[2*p + 0] - lat;
+        lng_diff = grid->points[2*p + 1] - lng;
+        d = (lng_diff * lng_diff) + (lat_diff * lat_diff);
+        *best = MIN(*best, d);
+        if (d < floor) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Squared distance from (lat, lng) to its nearest grid point, except that the search returns early, with some value
+// below `floor`, as soon as it finds any point closer than that. Cells are visited in square rings around the query's
+// cell (clamped into the grid). Every point of ring r is at least (r - 1) cells from the query's projection onto the
+// grid, and projecting onto a rectangle never increases distances, so the search ends once that bound passes the best
+// distance so far.
+float _point_grid_nearest_squared(const _point_grid_t* grid, const float lat, const float lng, const float floor) {
+    const size_t row = _point_grid_index(lat, grid->min_lat, grid->cell, grid->n_rows);
+    const size_t col = _point_grid_index(lng, grid->min_lng, grid->cell, grid->n_cols);
+    const size_t max_ring = MAX(MAX(row, grid->n_rows - 1 - row), MAX(col, grid->n_cols - 1 - col));
+    float best = INFINITY;
+    for (size_t ring = 0; ring <= max_ring; ring++) {
+        const float bound = (ring > 0) ? (ring - 1) * grid->cell : 0.0f;
+        if (bound * bound >= best) {
+            break;
+        }
+        const size_t row_lo = (row >= ring) ? row - ring : 0;
+        const size_t row_hi = MIN(row + ring, grid->n_rows - 1);
+        const size_t col_lo = (col >= ring) ? col - ring : 0;
+        const size_t col_hi = MIN(col + ring, grid->n_cols - 1);
+        for (size_t r = row_lo; r <= row_hi; r++) {
+            if (r + ring == row || r == row + ring) {
+                // Top and bottom edges of the ring: every column.
+                for (size_t c = col_lo; c <= col_hi; c++) {
+                    if (_point_grid_scan_cell(grid, r, c, lat, lng, floor, &best)) {
+                        return best;
+                    }
+                }
+                continue;
+            }
+            // Rows in between: only the left and right edges.
+            if (col >= ring && _point_grid_scan_cell(grid, r, col - ring, lat, lng, floor, &best)) {
+                return best;
+            }
+            if (ring > 0 && col + ring < grid->n_cols &&
+                _point_grid_scan_cell(grid, r, col + ring, lat, lng, floor, &best)) {
+                return best;
+            }
+        }
+    }
+    return best;
+}
+
+// A fixed-seed permutation of [0, n): breaks up the spatial order of a stream so that the early break kicks in
+// quickly, while keeping runs reproducible.
+size_t* _deterministic_shuffle(const size_t n) {
+    size_t* order = malloc(MAX(n, 1) * sizeof(size_t));
+    uint64_t state = HAUSDORFF_SHUFFLE_SEED;
+    for (size_t i = 0; i < n; i++) {
+        order[i] = i;
+    }
+    for (size_t i = n; i > 1; i--) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        const size_t j = (size_t) (state % i);
+        const size_t tmp = order[i - 1];
+        order[i - 1] = order[j];
+        order[j] = tmp;
+    }
+    return order;
+}
+
+// Squared directed Hausdorff distance, starting from a known lower bound `cmax` on the result.
+float _directed_hausdorff_squared(const stream_t* a, const stream_t* b, float cmax) {
+    if (a->n == 0) {
+        return cmax;
+    }
+    if (b->n == 0) {
+        return INFINITY;
+    }
+    const _point_grid_t grid = _point_grid_create(b);
+    size_t* order = _deterministic_shuffle(a->n);
+    for (size_t k = 0; k < a->n; k++) {
+        const size_t i = order[k];
+        const float cmin = _point_grid_nearest_squared(&grid, a->data[2*i + 0], a->data[2*i + 1], cmax);
+        cmax = MAX(cmax, cmin);
+    }
+    free(order);
+    _point_grid_destroy(&grid);
+    return cmax;
+}
+
+float directed_hausdorff_distance(const stream_t* a, const stream_t* b) {
+    return sqrtf(_directed_hausdorff_squared(a, b, 0.0f));
+}
+
+float hausdorff_distance(const stream_t* a, const stream_t* b) {
+    // The first direction's result is a lower bound for the second, so it starts with early breaks already armed.
+    return sqrtf(_directed_hausdorff_squared(b, a, _directed_hausdorff_squared(a, b, 0.0f)));
+}
+
+// Same row sweep as _full_dtw_cost_rows in alignment.c, with max in place of + and squared distances throughout.
+// Rows run over the longer stream so the buffers are as short as possible; the distance is symmetric.
+float discrete_frechet_distance(const stream_t* a, const stream_t* b) {
+    if (a->n == 0 || b->n == 0) {
+        return INFINITY;
+    }
+    if (b->n > a->n) {
+        const stream_t* tmp_stream = a;
+        a = b;
+        b = tmp_stream;
+    }
+    const float* a_data = a->data;
+    const float* b_data = b->data;
+    const size_t a_n = a->n;
+    const size_t b_n = b->n;
+    float* buffer = malloc(2 * (b_n + 1) * sizeof(float));
+    float* prev_costs = buffer;
+    float* curr_costs = buffer + (b_n + 1);
+    float* tmp;
+    for (size_t col = 0; col <= b_n; col++) {
+        prev_costs[col] = INFINITY;
+    }
+    prev_costs[0] = 0;
+    float lat_diff, lng_diff, dt, best;
+    for (size_t row = 0; row < a_n; row++) {
+        curr_costs[0] = INFINITY;
+        for (size_t col = 0; col < b_n; col++) {
+            lat_diff = b_data[2*col + 0] - a_data[2*row + 0];
+            lng_diff = b_data[2*col + 1] - a_data[2*row + 1];
+            dt = (lng_diff * lng_diff) + (lat_diff * lat_diff);
+            best = MIN(prev_costs[col], MIN(prev_costs[col+1], curr_costs[col]));
+            curr_costs[col+1] = MAX(dt, best);
+        }
+        tmp = prev_costs;
+        prev_costs = curr_costs;
+        curr_costs = tmp;
+        prev_costs[0] = INFINITY;  // Only the very first cell may start a path.
+    }
+    const float cost = prev_costs[b_n];
+    free(buffer);
+    return sqrtf(cost);
+}
+
+// Whether every point of `a` lies within `epsilon` of the bounding box of `b`, a necessary condition for any point of
+// `b` to be within `epsilon` of each of them.
+int _frechet_box_covers(const stream_t* a, const stream_t* b, const float epsilon) {
+    float min_lat = b->data[0], max_lat = b->data[0], min_lng = b->data[1], max_lng = b->data[1];
+    for (size_t j = 1; j < b->n; j++) {
+        min_lat = MIN(min_lat, b->data[2*j + 0]);
+        max_lat = MAX(max_lat, b->data[2*j + 0]);
+        min_lng = MIN(min_lng, b->data[2*j + 1]);
+        max_lng = MAX(max_lng, b->data[2*j + 1]);
+    }
+    for (size_t i = 0; i < a->n; i++) {
+        if (a->data[2*i + 0] < min_lat - epsilon || a->data[2*i + 0] > max_lat + epsilon ||
+            a->data[2*i + 1] < min_lng - epsilon || a->data[2*i + 1] > max_lng + epsilon) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+float _frechet_point_distance_squared(const stream_t* a, const size_t i, const stream_t* b, const size_t j) {
+    const float lat_diff = b->data[2*j + 0] - a->data[2*i + 0];
+    const float lng_diff = b->data[2*j + 1] - a->data[2*i + 1];
+    return (lng_diff * lng_diff) + (lat_diff * lat_diff);
+}
+
+// Reachability sweep over the free space {(i, j) : |a_i - b_j| <= epsilon}. Each row only visits columns from the
+// previous row's first reachable cell up to one past its last, plus however far the row's own run extends to the
+// right; everything else is unreachable. `window`, if given, further limits each row to its strided mask span.
+int _frechet_decide(const stream_t* a, const stream_t* b, const strided_mask_t* window, const float epsilon) {
+    const size_t a_n = a->n;
+    const size_t b_n = b->n;
+    const float threshold = epsilon * epsilon;
+    unsigned char* buffer = malloc(2 * b_n);
+    unsigned char* prev_reach = buffer;
+    unsigned char* curr_reach = buffer + b_n;
+    unsigned char* tmp;
+    size_t prev_lo = 0, prev_hi = 0;  // Reachable cells of the previous row lie in [prev_lo, prev_hi].
+    size_t lo, hi, end_col;
+    int any, from_prev;
+    for (size_t row = 0; row < a_n; row++) {
+        end_col = window ? window->end_cols[row] : b_n - 1;
+        any = 0;
+        lo = hi = 0;
+        for (size_t col = window ? MAX(prev_lo, window->start_cols[row]) : prev_lo; col <= end_col; col++) {
+            if (row == 0) {
+                from_prev = (col == 0);  // Paths start at the corner.
+            } else {
+                from_prev = (col <= prev_hi && prev_reach[col]) ||
+                            (col > prev_lo && col - 1 <= prev_hi && prev_reach[col - 1]);
+            }
+            curr_reach[col] = (from_prev || (any && hi + 1 == col)) &&
+                              _frechet_point_distance_squared(a, row, b, col) <= threshold;
+            if (curr_reach[col]) {
+                lo = any ? lo : col;
+                hi = col;
+                any = 1;
+            } else if (col > prev_hi) {
+                break;  // Nothing further right is reachable from either the previous row or this one.
+            }
+        }
+        if (!any) {
+            free(buffer);
+            return 0;
+        }
+        tmp = prev_reach;
+        prev_reach = curr_reach;
+        curr_reach = tmp;
+        prev_lo = lo;
+        prev_hi = hi;
+    }
+    const int reached = (prev_hi == b_n - 1) && prev_reach[b_n - 1];
+    free(buffer);
+    return reached;
+}
+
+int _frechet_prefilter(const stream_t* a, const stream_t* b, const float epsilon) {
+    if (a->n == 0 || b->n == 0) {
+        return 0;
+    }
+    const float threshold = epsilon * epsilon;
+    return _frechet_point_distance_squared(a, 0, b, 0) <= threshold &&
+           _frechet_point_distance_squared(a, a->n - 1, b, b->n - 1) <= threshold &&
+           _frechet_box_covers(a, b, epsilon) && _frechet_box_covers(b, a, epsilon);
+}
+
+int frechet_within(const stream_t* a, const stream_t* b, const float epsilon) {
+    if (!_frechet_prefilter(a, b, epsilon)) {
+        return 0;
+    }
+    // Columns over the shorter stream keep the buffers small; the decision is symmetric.
+    return (b->n <= a->n) ? _frechet_decide(a, b, NULL, epsilon) : _frechet_decide(b, a, NULL, epsilon);
+}
+
+int frechet_within_windowed(const stream_t* a, const stream_t* b, const strided_mask_t* window, const float epsilon) {
+    return _frechet_prefilter(a, b, epsilon) && _frechet_decide(a, b, window, epsilon);
+}
@@ -0,0 +1,92 @@
+#define _GNU_SOURCE
+
+#include <cstreamgeo/parallel.h>
+#include <cstreamgeo/utilc.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+/**
+ * Work-stealing parallel-for over an index range. See parallel.h.
+ */
+
+
+typedef struct {
+    atomic_size_t next;  // Next unclaimed index in this block
+    size_t end;          // One past the last index in this block
+    char padding[64 - sizeof(atomic_size_t) - sizeof(size_t)];  // Keep cursors on separate cache lines
+} _parallel_block_t;
+
+typedef struct {
+    _parallel_block_t* blocks;
+    size_t nthreads;
+    parallel_task_t task;
+    void* context;
+} _parallel_pool_t;
+
+typedef struct {
+    _parallel_pool_t* pool;
+    size_t thread_id;
+} _parallel_worker_t;
+
+size_t parallel_default_threads() {
+    const long online = sysconf(_SC_NPROCESSORS_ONLN);
+    return (online > 0) ? (size_t) online : 1;
+}
+
+size_t parallel_thread_count(const size_t n, const size_t nthreads) {
+    const size_t requested = (nthreads == 0) ? parallel_default_threads() : nthreads;
+    return MAX(1, MIN(requested, n));
+}
+
+void* _parallel_worker_run(void* arg) {
+    const _parallel_worker_t* worker = arg;
+    _parallel_pool_t* pool = worker->pool;
+    const size_t nthreads = pool->nthreads;
+    size_t index;
+    // Drain our own block first, then walk the other blocks and steal from their fronts.
+    for (size_t k = 0; k < nthreads; k++) {
+        _parallel_block_t* block = &pool->blocks[(worker->thread_id + k) % nthreads];
+        while ((index = atomic_fetch_add_explicit(&block->next, 1, memory_order_relaxed)) < block->end) {
+            pool->task(pool->context, index, worker->thread_id);
+        }
+    }
+    return NULL;
+}
+
+size_t parallel_for(const size_t n, const size_t nthreads, parallel_task_t task, void* context) {
+    const size_t threads = parallel_thread_count(n, nthreads);
+    if (threads == 1) {
+        for (size_t i = 0; i < n; i++) {
+            task(context, i, 0);
+        }
+        return 1;
+    }
+    _parallel_block_t* blocks = malloc(threads * sizeof(_parallel_block_t));
+    for (size_t t = 0; t < threads; t++) {
+        atomic_init(&blocks[t].next, (t * n) / threads);
+        blocks[t].end = ((t + 1) * n) / threads;
+    }
+    _parallel_pool_t pool = {blocks, threads, task, context};
+    _parallel_worker_t* workers = malloc(threads * sizeof(_parallel_worker_t));
+    pthread_t* handles = malloc(threads * sizeof(pthread_t));
+    for (size_t t = 0; t < threads; t++) {
+        workers[t].pool = &pool;
+        workers[t].thread_id = t;
+    }
+    // Thread 0 is the caller. If a thread cannot be spawned, the others simply steal its block.
+    int* spawned = calloc(threads, sizeof(int));
+    for (size_t t = 1; t < threads; t++) {
+        spawned[t] = (pthread_create(&handles[t], NULL, _parallel_worker_run, &workers[t]) == 0);
+    }
+    _parallel_worker_run(&workers[0]);
+    for (size_t t = 1; t < threads; t++) {
+        if (spawned[t]) pthread_join(handles[t], NULL);
+    }
+    free(spawned);
+    free(handles);
+    free(workers);
+    free(blocks);
+    return threads;
+}
@@ -0,0 +1,160 @@
+#include <cstreamgeo/polyline.h>
+#include <cstreamgeo/io.h>
+#include <cstreamgeo/parallel.h>
+#include <cstreamgeo/utilc.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Google Encoded Polyline codec. See polyline.h.
+ *
+ * Each coordinate is stored as the difference from the previous point's, in units of 1e-5 degrees, zigzag-encoded
+ * so small negative numbers stay small, then written five bits per character (plus 63, to stay printable) with
+ * bit 0x20 set on every character except the last of a value.
+ */
+
+#define POLYLINE_MAX_CHARS 7     // A 32 bit zigzag value needs at most seven five-bit chunks.
+#define POLYLINE_BLOCK 64        // Characters decoded between flushes of the integer buffer.
+#define POLYLINE_MAX_SCALED 2147483647.0  // Coordinates must round to 32 bit integers, so deltas fit in seven chunks.
+
+// Validates `polyline` and counts the values in it, without a data-dependent branch per character.
+// Returns 0 if it is malformed: a character outside [63, 126], a value longer than seven characters, a value left
+// unterminated, or an odd number of values.
+int _polyline_count_values(const unsigned char* polyline, const size_t length, size_t* n_values) {
+    size_t count = 0;
+    size_t run = 0;       // Continuation characters since the end of the last value.
+    size_t invalid = 0;
+    uint32_t chunk, more;
+    for (size_t i = 0; i < length; i++) {
+        chunk = (uint32_t) polyline[i] - 63;
+        invalid |= (chunk > 63);
+        more = (chunk >> 5) & 1;
+        count += more ^ 1;
+        run = (run + 1) & (0 - (size_t) more);
+        invalid |= (run >= POLYLINE_MAX_CHARS);
+    }
+    *n_values = count;
+    return !invalid && run == 0 && count % 2 == 0;
+}
+
+stream_t* stream_from_polyline(const char* polyline, const size_t length) {
+    const unsigned char* text = (const unsigned char*) polyline;
+    size_t n_values;
+    if (!_polyline_count_values(text, length, &n_values)) {
+        return NULL;
+    }
+    stream_t* stream = stream_create(n_values / 2);
+    float* data = stream->data;
+    int32_t block[POLYLINE_BLOCK + 1];
+    int64_t sums[2] = {0, 0};  // Running latitude and longitude.
+    uint64_t accumulator = 0;
+    uint32_t shift = 0;
+    size_t k = 0;              // Values completed before this block.
+    for (size_t start = 0; start < length; start += POLYLINE_BLOCK) {
+        const size_t stop = MIN(length, start + POLYLINE_BLOCK);
+        size_t j = 0;          // Values completed in this block.
+        for (size_t i = start; i < stop; i++) {
+            // Every character updates the value in progress; `end` selects whether it is committed.
+            const uint32_t chunk = (uint32_t) text[i] - 63;
+            accumulator |= (uint64_t) (chunk & 0x1f) << shift;
+            const uint64_t end = ((chunk >> 5) & 1) ^ 1;
+            const uint64_t keep = end - 1;  // All ones while the value continues, zero once it ends.
+            const int64_t value = (int64_t) (accumulator >> 1) ^ -(int64_t) (accumulator & 1);
+            const size_t parity = (k + j) & 1;
+            const int64_t sum = sums[parity] + value;
+            block[j] = (int32_t) sum;
+            sums[parity] = (int64_t) (((uint64_t) sums[parity] & keep) | ((uint64_t) sum & ~keep));
+            j += end;
+            accumulator &= keep;
+            shift = (shift + 5) & (uint32_t) keep;
+        }
+        for (size_t v = 0; v < j; v++) {
+            data[k + v] = (float) (block[v] / POLYLINE_PRECISION);
+        }
+        k += j;
+    }
+    return stream;
+}
+
+// Appends the polyline characters of one value to `out`; returns the new end.
+char* _polyline_put_value(char* out, const int64_t value) {
+    uint64_t zigzag = ((uint64_t) value << 1) ^ (uint64_t) (value >> 63);
+    while (zigzag >= 0x20) {
+        *out++ = (char) ((0x20 | (zigzag & 0x1f)) + 63);
+        zigzag >>= 5;
+    }
+    *out++ = (char) (zigzag + 63);
+    return out;
+}
+
+char* stream_to_polyline(const stream_t* stream) {
+    const size_t n = stream->n;
+    const float* data = stream->data;
+    char* polyline = malloc(2 * n * POLYLINE_MAX_CHARS + 1);
+    char* out = polyline;
+    int64_t previous[2] = {0, 0};
+    int64_t current;
+    double scaled;
+    for (size_t i = 0; i < 2 * n; i++) {
+        scaled = (double) data[i] * POLYLINE_PRECISION;
+        if (!(fabs(scaled) <= POLYLINE_MAX_SCALED)) {  // Also catches NaN.
+            free(polyline);
+            return NULL;
+        }
+        current = llround(scaled);
+        out = _polyline_put_value(out, current - previous[i & 1]);
+        previous[i & 1] = current;
+    }
+    *out++ = '\0';
+    return realloc(polyline, (size_t) (out - polyline));
+}
+
+typedef struct {
+    const char* const* polylines;
+    stream_t** streams;
+    char** encoded;
+    const stream_collection_t* collection;
+} _polyline_batch_t;
+
+void _polyline_decode_task(void* context, const size_t index, const size_t thread_id) {
+    (void) thread_id;
+    _polyline_batch_t* batch = context;
+    batch->streams[index] = stream_from_polyline(batch->polylines[index], strlen(batch->polylines[index]));
+}
+
+void _polyline_encode_task(void* context, const size_t index, const size_t thread_id) {
+    (void) thread_id;
+    _polyline_batch_t* batch = context;
+    batch->encoded[index] = stream_to_polyline(batch->collection->data[index]);
+}
+
+stream_collection_t* stream_collection_from_polylines(const char* const* polylines, const size_t n,
+                                                      const size_t nthreads) {
+    stream_collection_t* streams = stream_collection_create(n);
+    _polyline_batch_t batch = {polylines, streams->data, NULL, NULL};
+    parallel_for(n, nthreads, _polyline_decode_task, &batch);
+    int malformed = 0;
+    for (size_t i = 0; i < n; i++) {
+        malformed |= (streams->data[i] == NULL);
+    }
+    if (!malformed) {
+        return streams;
+    }
+    for (size_t i = 0; i < n; i++) {
+        if (streams->data[i]) {
+            stream_destroy(streams->data[i]);
+        }
+    }
+    free(streams->data);
+    free(streams);
+    return NULL;
+}
+
+char** stream_collection_to_polylines(const stream_collection_t* streams, const size_t nthreads) {
+    char** encoded = malloc(MAX(streams->n, 1) * sizeof(char*));
+    _polyline_batch_t batch = {NULL, NULL, encoded, streams};
+    parallel_for(streams->n, nthreads, _polyline_encode_task, &batch);
+    return encoded;
+}
@@ -0,0 +1,232 @@
+#include <cstreamgeo/quantized.h>
+#include <cstreamgeo/utilc.h>
+#include <float.h>
+#include <immintrin.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Fixed-point stream encodings and the kernels that work on them. See quantized.h.
+ */
+
+#define MICRODEGREES 1000000.0
+#define DEGREES_PER_MICRODEGREE 1e-6f
+
+// out[k] = local cost between point (lat, lng) and point k of the interleaved microdegree buffer b, in squared degrees.
+typedef void (*_quantized_local_cost_kernel_t)(const size_t count, const int32_t* b, const int32_t lat, const int32_t lng,
+                                               float* out);
+
+void _quantized_local_cost_scalar(const size_t count, const int32_t* restrict b, const int32_t lat, const int32_t lng,
+                                  float* restrict out) {
+    float lat_diff, lng_diff;
+    for (size_t k = 0; k < count; k++) {
+        lat_diff = (float) (b[2*k + 0] - lat) * DEGREES_PER_MICRODEGREE;
+        lng_diff = (float) (b[2*k + 1] - lng) * DEGREES_PER_MICRODEGREE;
+        out[k] = (lat_diff * lat_diff) + (lng_diff * lng_diff);
+    }
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+
+// Each load covers whole [lat, lng] pairs, so the per-point sum is a horizontal add of adjacent lanes.
+__attribute__((target("sse4.1")))
+void _quantized_local_cost_sse4(const size_t count, const int32_t* restrict b, const int32_t lat, const int32_t lng,
+                                float* restrict out) {
+    const __m128i a = _mm_set_epi32(lng, lat, lng, lat);
+    const __m128 scale = _mm_set1_ps(DEGREES_PER_MICRODEGREE);
+    size_t k = 0;
+    for (; k + 4 <= count; k += 4) {
+        const __m128i lo = _mm_sub_epi32(_mm_loadu_si128((const __m128i*) (b + 2*k)), a);
+        const __m128i hi = _mm_sub_epi32(_mm_loadu_si128((const __m128i*) (b + 2*k + 4)), a);
+        const __m128 lo_diff = _mm_mul_ps(_mm_cvtepi32_ps(lo), scale);
+        const __m128 hi_diff = _mm_mul_ps(_mm_cvtepi32_ps(hi), scale);
+        _mm_storeu_ps(out + k, _mm_hadd_ps(_mm_mul_ps(lo_diff, lo_diff), _mm_mul_ps(hi_diff, hi_diff)));
+    }
+    _quantized_local_cost_scalar(count - k, b + 2*k, lat, lng, out + k);
+}
+
+__attribute__((target("avx2")))
+void _quantized_local_cost_avx2(const size_t count, const int32_t* restrict b, const int32_t lat, const int32_t lng,
+                                float* restrict out) {
+    const __m256i a = _mm256_set_epi32(lng, lat, lng, lat, lng, lat, lng, lat);
+    const __m256 scale = _mm256_set1_ps(DEGREES_PER_MICRODEGREE);
+    size_t k = 0;
+    for (; k + 8 <= count; k += 8) {
+        const __m256i lo = _mm256_sub_epi32(_mm256_loadu_si256((const __m256i*) (b + 2*k)), a);
+        const __m256i hi = _mm256_sub_epi32(_mm256_loadu_si256((const __m256i*) (b + 2*k + 8)), a);
+        const __m256 lo_diff = _mm256_mul_ps(_mm256_cvtepi32_ps(lo), scale);
+        const __m256 hi_diff = _mm256_mul_ps(_mm256_cvtepi32_ps(hi), scale);
+        // hadd works within 128 bit lanes, leaving points in order 0 1 4 5 2 3 6 7.
+        const __m256 sums = _mm256_hadd_ps(_mm256_mul_ps(lo_diff, lo_diff), _mm256_mul_ps(hi_diff, hi_diff));
+        _mm256_storeu_ps(out + k, _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(sums), 0xD8)));
+    }
+    _quantized_local_cost_sse4(count - k, b + 2*k, lat, lng, out + k);
+}
+
+#endif
+
+// Picks the widest kernel the running CPU supports (see _select_soa_kernels in soa.c).
+_quantized_local_cost_kernel_t _select_quantized_kernel() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return _quantized_local_cost_avx2;
+    }
+    if (__builtin_cpu_supports("sse4.1")) {
+        return _quantized_local_cost_sse4;
+    }
+#endif
+    return _quantized_local_cost_scalar;
+}
+
+stream_quantized_t* stream_quantized_create(const size_t n) {
+    stream_quantized_t* stream = malloc(sizeof(stream_quantized_t));
+    stream->data = malloc(2 * n * sizeof(int32_t));
+    stream->n = n;
+    return stream;
+}
+
+void stream_quantized_destroy(const stream_quantized_t* stream) {
+    free(stream->data);
+    free((void*) stream);
+}
+
+stream_quantized_t* stream_quantize(const stream_t* stream) {
+    const size_t n = stream->n;
+    stream_quantized_t* quantized = stream_quantized_create(n);
+    for (size_t i = 0; i < 2 * n; i++) {
+        quantized->data[i] = (int32_t) lround((double) stream->data[i] * MICRODEGREES);
+    }
+    return quantized;
+}
+
+stream_t* stream_dequantize(const stream_quantized_t* stream) {
+    const size_t n = stream->n;
+    stream_t* dequantized = stream_create(n);
+    for (size_t i = 0; i < 2 * n; i++) {
+        // Division by 1e6 in double is correctly rounded, so the cast lands on the float nearest the microdegree.
+        dequantized->data[i] = (float) ((double) stream->data[i] / MICRODEGREES);
+    }
+    return dequantized;
+}
+
+stream_delta_t* stream_delta_encode(const stream_quantized_t* stream) {
+    const size_t n = stream->n;
+    const int32_t* data = stream->data;
+    stream_delta_t* delta = malloc(sizeof(stream_delta_t));
+    // Worst case every point is its own block; trimmed below.
+    size_t* starts = malloc((n + 1) * sizeof(size_t));
+    int32_t* anchors = malloc(MAX(2 * n, 1) * sizeof(int32_t));
+    int16_t* deltas = malloc(MAX(2 * n, 1) * sizeof(int16_t));
+    size_t n_blocks = 0;
+    int64_t lat_delta, lng_delta;
+    for (size_t i = 0; i < n; i++) {
+        if (i > 0 && i - starts[n_blocks - 1] < STREAM_DELTA_BLOCK) {
+            lat_delta = (int64_t) data[2*i + 0] - data[2*i - 2];
+            lng_delta = (int64_t) data[2*i + 1] - data[2*i - 1];
+            if (lat_delta >= INT16_MIN && lat_delta <= INT16_MAX && lng_delta >= INT16_MIN && lng_delta <= INT16_MAX) {
+                deltas[2*i + 0] = (int16_t) lat_delta;
+                deltas[2*i + 1] = (int16_t) lng_delta;
+                continue;
+            }
+        }
+        starts[n_blocks] = i;
+        anchors[2*n_blocks + 0] = data[2*i + 0];
+        anchors[2*n_blocks + 1] = data[2*i + 1];
+        deltas[2*i + 0] = 0;
+        deltas[2*i + 1] = 0;
+        n_blocks++;
+    }
+    starts[n_blocks] = n;
+    delta->n = n;
+    delta->n_blocks = n_blocks;
+    delta->starts = realloc(starts, (n_blocks + 1) * sizeof(size_t));
+    delta->anchors = realloc(anchors, MAX(2 * n_blocks, 1) * sizeof(int32_t));
+    delta->deltas = deltas;
+    return delta;
+}
+
+stream_quantized_t* stream_delta_decode(const stream_delta_t* stream) {
+    stream_quantized_t* decoded = stream_quantized_create(stream->n);
+    int32_t* data = decoded->data;
+    const int16_t* deltas = stream->deltas;
+    int32_t lat, lng;
+    for (size_t block = 0; block < stream->n_blocks; block++) {
+        lat = stream->anchors[2*block + 0];
+        lng = stream->anchors[2*block + 1];
+        for (size_t i = stream->starts[block]; i < stream->starts[block + 1]; i++) {
+            lat += deltas[2*i + 0];
+            lng += deltas[2*i + 1];
+            data[2*i + 0] = lat;
+            data[2*i + 1] = lng;
+        }
+    }
+    return decoded;
+}
+
+size_t stream_delta_size(const stream_delta_t* stream) {
+    return sizeof(stream_delta_t) + (stream->n_blocks + 1) * sizeof(size_t) +
+           2 * stream->n_blocks * sizeof(int32_t) + 2 * stream->n * sizeof(int16_t);
+}
+
+void stream_delta_destroy(const stream_delta_t* stream) {
+    free(stream->starts);
+    free(stream->anchors);
+    free(stream->deltas);
+    free((void*) stream);
+}
+
+float stream_quantized_distance(const stream_quantized_t* stream) {
+    const int32_t* data = stream->data;
+    float sum = 0.0f;
+    float lat_diff, lng_diff;
+    for (size_t i = 0; i < stream->n - 1; i++) {
+        lat_diff = (float) (data[2*i + 2] - data[2*i + 0]) * DEGREES_PER_MICRODEGREE;
+        lng_diff = (float) (data[2*i + 3] - data[2*i + 1]) * DEGREES_PER_MICRODEGREE;
+        sum += sqrtf((lat_diff * lat_diff) + (lng_diff * lng_diff));
+    }
+    return sum;
+}
+
+// Same row sweep and tie rule as _full_dtw_cost_rows in alignment.c; each row's local costs come from one kernel call.
+float quantized_dtw_cost(const stream_quantized_t* a, const stream_quantized_t* b) {
+    const int32_t* a_data = a->data;
+    const int32_t* b_data = b->data;
+    const size_t a_n = a->n;
+    const size_t b_n = b->n;
+    const _quantized_local_cost_kernel_t kernel = _select_quantized_kernel();
+    float* scratch = malloc((3 * b_n + 2) * sizeof(float));
+    float* prev_costs = scratch;
+    float* curr_costs = prev_costs + (b_n + 1);
+    float* local_costs = curr_costs + (b_n + 1);
+    float* tmp;
+    for (size_t col = 0; col <= b_n; col++) {
+        prev_costs[col] = FLT_MAX;
+    }
+    prev_costs[0] = 0;
+    float dt, diag_cost, up_cost, left_cost;
+    for (size_t row = 0; row < a_n; row++) {
+        kernel(b_n, b_data, a_data[2*row + 0], a_data[2*row + 1], local_costs);
+        curr_costs[0] = FLT_MAX;
+        for (size_t col = 0; col < b_n; col++) {
+            dt = local_costs[col];
+            diag_cost = prev_costs[col];
+            up_cost   = prev_costs[col+1];
+            left_cost = curr_costs[col];
+            if (diag_cost <= up_cost && diag_cost <= left_cost) {
+                curr_costs[col+1] = dt + diag_cost;
+            } else if (up_cost <= left_cost) {
+                curr_costs[col+1] = dt + up_cost;
+            } else {
+                curr_costs[col+1] = dt + left_cost;
+            }
+        }
+        tmp = prev_costs;
+        prev_costs = curr_costs;
+        curr_costs = tmp;
+    }
+    const float cost = prev_costs[b_n];
+    free(scratch);
+    return cost;
+}
@@ -0,0 +1,273 @@
+#include <cstreamgeo/soa.h>
+#include <cstreamgeo/utilc.h>
+#include <immintrin.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Structure-of-arrays streams and their SIMD kernels. See soa.h.
+ */
+
+
+#define SOA_ALIGNMENT 64
+#define SOA_PAD_FLOATS (SOA_ALIGNMENT / sizeof(float))
+
+// out[i] = length of segment i (from point i to point i + 1), for i in [0, count).
+typedef void (*_soa_length_kernel_t)(const size_t count, const float* lat, const float* lng, float* out);
+// Sum of the lengths of segments [0, count).
+typedef float (*_soa_distance_kernel_t)(const size_t count, const float* lat, const float* lng);
+// out[k] = (b_lng[k] - lng)^2 + (b_lat[k] - lat)^2, for k in [0, count).
+typedef void (*_soa_local_cost_kernel_t)(const size_t count, const float* b_lat, const float* b_lng,
+                                         const float lat, const float lng, float* out);
+
+typedef struct {
+    _soa_length_kernel_t length;
+    _soa_distance_kernel_t distance;
+    _soa_local_cost_kernel_t local_cost;
+} _soa_kernels_t;
+
+void _soa_length_scalar(const size_t count, const float* restrict lat, const float* restrict lng, float* restrict out) {
+    float lat_diff, lng_diff;
+    for (size_t i = 0; i < count; i++) {
+        lat_diff = lat[i + 1] - lat[i];
+        lng_diff = lng[i + 1] - lng[i];
+        out[i] = sqrtf((lng_diff * lng_diff) + (lat_diff * lat_diff));
+    }
+}
+
+float _soa_distance_scalar(const size_t count, const float* restrict lat, const float* restrict lng) {
+    float sum = 0.0f;
+    float lat_diff, lng_diff;
+    for (size_t i = 0; i < count; i++) {
+        lat_diff = lat[i + 1] - lat[i];
+        lng_diff = lng[i + 1] - lng[i];
+        sum += sqrtf((lng_diff * lng_diff) + (lat_diff * lat_diff));
+    }
+    return sum;
+}
+
+void _soa_local_cost_scalar(const size_t count, const float* restrict b_lat, const float* restrict b_lng,
+                            const float lat, const float lng, float* restrict out) {
+    float lat_diff, lng_diff;
+    for (size_t k = 0; k < count; k++) {
+        lat_diff = b_lat[k] - lat;
+        lng_diff = b_lng[k] - lng;
+        out[k] = (lng_diff * lng_diff) + (lat_diff * lat_diff);
+    }
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+
+__attribute__((target("sse4.1")))
+void _soa_length_sse4(const size_t count, const float* restrict lat, const float* restrict lng, float* restrict out) {
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const __m128 lat_diff = _mm_sub_ps(_mm_loadu_ps(lat + i + 1), _mm_loadu_ps(lat + i));
+        const __m128 lng_diff = _mm_sub_ps(_mm_loadu_ps(lng + i + 1), _mm_loadu_ps(lng + i));
+        _mm_storeu_ps(out + i, _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(lng_diff, lng_diff), _mm_mul_ps(lat_diff, lat_diff))));
+    }
+    _soa_length_scalar(count - i, lat + i, lng + i, out + i);
+}
+
+__attribute__((target("sse4.1")))
+float _soa_distance_sse4(const size_t count, const float* restrict lat, const float* restrict lng) {
+    __m128 sum = _mm_setzero_ps();
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const __m128 lat_diff = _mm_sub_ps(_mm_loadu_ps(lat + i + 1), _mm_loadu_ps(lat + i));
+        const __m128 lng_diff = _mm_sub_ps(_mm_loadu_ps(lng + i + 1), _mm_loadu_ps(lng + i));
+        sum = _mm_add_ps(sum, _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(lng_diff, lng_diff), _mm_mul_ps(lat_diff, lat_diff))));
+    }
+    float lanes[4];
+    _mm_storeu_ps(lanes, sum);
+    return ((lanes[0] + lanes[1]) + (lanes[2] + lanes[3])) + _soa_distance_scalar(count - i, lat + i, lng + i);
+}
+
+__attribute__((target("sse4.1")))
+void _soa_local_cost_sse4(const size_t count, const float* restrict b_lat, const float* restrict b_lng,
+                          const float lat, const float lng, float* restrict out) {
+    const __m128 a_lat = _mm_set1_ps(lat);
+    const __m128 a_lng = _mm_set1_ps(lng);
+    size_t k = 0;
+    for (; k + 4 <= count; k += 4) {
+        const __m128 lat_diff = _mm_sub_ps(_mm_loadu_ps(b_lat + k), a_lat);
+        const __m128 lng_diff = _mm_sub_ps(_mm_loadu_ps(b_lng + k), a_lng);
+        _mm_storeu_ps(out + k, _mm_add_ps(_mm_mul_ps(lng_diff, lng_diff), _mm_mul_ps(lat_diff, lat_diff)));
+    }
+    _soa_local_cost_scalar(count - k, b_lat + k, b_lng + k, lat, lng, out + k);
+}
+
+__attribute__((target("avx2")))
+void _soa_length_avx2(const size_t count, const float* restrict lat, const float* restrict lng, float* restrict out) {
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m256 lat_diff = _mm256_sub_ps(_mm256_loadu_ps(lat + i + 1), _mm256_loadu_ps(lat + i));
+        const __m256 lng_diff = _mm256_sub_ps(_mm256_loadu_ps(lng + i + 1), _mm256_loadu_ps(lng + i));
+        _mm256_storeu_ps(out + i, _mm256_sqrt_ps(_mm256_add_ps(_mm256_mul_ps(lng_diff, lng_diff),
+                                                               _mm256_mul_ps(lat_diff, lat_diff))));
+    }
+    _soa_length_sse4(count - i, lat + i, lng + i, out + i);
+}
+
+__attribute__((target("avx2")))
+float _soa_distance_avx2(const size_t count, const float* restrict lat, const float* restrict lng) {
+    __m256 sum = _mm256_setzero_ps();
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m256 lat_diff = _mm256_sub_ps(_mm256_loadu_ps(lat + i + 1), _mm256_loadu_ps(lat + i));
+        const __m256 lng_diff = _mm256_sub_ps(_mm256_loadu_ps(lng + i + 1), _mm256_loadu_ps(lng + i));
+        sum = _mm256_add_ps(sum, _mm256_sqrt_ps(_mm256_add_ps(_mm256_mul_ps(lng_diff, lng_diff),
+                                                              _mm256_mul_ps(lat_diff, lat_diff))));
+    }
+    const __m128 half = _mm_add_ps(_mm256_castps256_ps128(sum), _mm256_extractf128_ps(sum, 1));
+    float lanes[4];
+    _mm_storeu_ps(lanes, half);
+    return ((lanes[0] + lanes[1]) + (lanes[2] + lanes[3])) + _soa_distance_scalar(count - i, lat + i, lng + i);
+}
+
+__attribute__((target("avx2")))
+void _soa_local_cost_avx2(const size_t count, const float* restrict b_lat, const float* restrict b_lng,
+                          const float lat, const float lng, float* restrict out) {
+    const __m256 a_lat = _mm256_set1_ps(lat);
+    const __m256 a_lng = _mm256_set1_ps(lng);
+    size_t k = 0;
+    for (; k + 8 <= count; k += 8) {
+        const __m256 lat_diff = _mm256_sub_ps(_mm256_loadu_ps(b_lat + k), a_lat);
+        const __m256 lng_diff = _mm256_sub_ps(_mm256_loadu_ps(b_lng + k), a_lng);
+        _mm256_storeu_ps(out + k, _mm256_add_ps(_mm256_mul_ps(lng_diff, lng_diff), _mm256_mul_ps(lat_diff, lat_diff)));
+    }
+    _soa_local_cost_sse4(count - k, b_lat + k, b_lng + k, lat, lng, out + k);
+}
+
+__attribute__((target("avx512f")))
+void _soa_length_avx512(const size_t count, const float* restrict lat, const float* restrict lng, float* restrict out) {
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        const __m512 lat_diff = _mm512_sub_ps(_mm512_loadu_ps(lat + i + 1), _mm512_loadu_ps(lat + i));
+        const __m512 lng_diff = _mm512_sub_ps(_mm512_loadu_ps(lng + i + 1), _mm512_loadu_ps(lng + i));
+        _mm512_storeu_ps(out + i, _mm512_sqrt_ps(_mm512_add_ps(_mm512_mul_ps(lng_diff, lng_diff),
+                                                               _mm512_mul_ps(lat_diff, lat_diff))));
+    }
+    _soa_length_avx2(count - i, lat + i, lng + i, out + i);
+}
+
+__attribute__((target("avx512f")))
+float _soa_distance_avx512(const size_t count, const float* restrict lat, const float* restrict lng) {
+    __m512 sum = _mm512_setzero_ps();
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        const __m512 lat_diff = _mm512_sub_ps(_mm512_loadu_ps(lat + i + 1), _mm512_loadu_ps(lat + i));
+        const __m512 lng_diff = _mm512_sub_ps(_mm512_loadu_ps(lng + i + 1), _mm512_loadu_ps(lng + i));
+        sum = _mm512_add_ps(sum, _mm512_sqrt_ps(_mm512_add_ps(_mm512_mul_ps(lng_diff, lng_diff),
+                                                              _mm512_mul_ps(lat_diff, lat_diff))));
+    }
+    return _mm512_reduce_add_ps(sum) + _soa_distance_avx2(count - i, lat + i, lng + i);
+}
+
+__attribute__((target("avx512f")))
+void _soa_local_cost_avx512(const size_t count, const float* restrict b_lat, const float* restrict b_lng,
+                            const float lat, const float lng, float* restrict out) {
+    const __m512 a_lat = _mm512_set1_ps(lat);
+    const __m512 a_lng = _mm512_set1_ps(lng);
+    size_t k = 0;
+    for (; k + 16 <= count; k += 16) {
+        const __m512 lat_diff = _mm512_sub_ps(_mm512_loadu_ps(b_lat + k), a_lat);
+        const __m512 lng_diff = _mm512_sub_ps(_mm512_loadu_ps(b_lng + k), a_lng);
+        _mm512_storeu_ps(out + k, _mm512_add_ps(_mm512_mul_ps(lng_diff, lng_diff), _mm512_mul_ps(lat_diff, lat_diff)));
+    }
+    if (k < count) {
+        const __mmask16 m = (__mmask16) ((1u << (count - k)) - 1u);
+        const __m512 lat_diff = _mm512_sub_ps(_mm512_maskz_loadu_ps(m, b_lat + k), a_lat);
+        const __m512 lng_diff = _mm512_sub_ps(_mm512_maskz_loadu_ps(m, b_lng + k), a_lng);
+        _mm512_mask_storeu_ps(out + k, m, _mm512_add_ps(_mm512_mul_ps(lng_diff, lng_diff),
+                                                        _mm512_mul_ps(lat_diff, lat_diff)));
+    }
+}
+
+#endif
+
+// Picks the widest kernels the running CPU supports (see _select_wavefront_kernel in alignment.c).
+_soa_kernels_t _select_soa_kernels() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+        return (_soa_kernels_t) {_soa_length_avx512, _soa_distance_avx512, _soa_local_cost_avx512};
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        return (_soa_kernels_t) {_soa_length_avx2, _soa_distance_avx2, _soa_local_cost_avx2};
+    }
+    if (__builtin_cpu_supports("sse4.1")) {
+        return (_soa_kernels_t) {_soa_length_sse4, _soa_distance_sse4, _soa_local_cost_sse4};
+    }
+#endif
+    return (_soa_kernels_t) {_soa_length_scalar, _soa_distance_scalar, _soa_local_cost_scalar};
+}
+
+stream_soa_t* stream_soa_create(const size_t n) {
+    stream_soa_t* soa = malloc(sizeof(stream_soa_t));
+    const size_t padded = ((n + SOA_PAD_FLOATS - 1) / SOA_PAD_FLOATS) * SOA_PAD_FLOATS;
+    // Both arrays share one allocation; padding keeps lng on a 64-byte boundary too.
+    float* buffer = aligned_alloc(SOA_ALIGNMENT, MAX(2 * padded, SOA_PAD_FLOATS) * sizeof(float));
+    memset(buffer, 0, MAX(2 * padded, SOA_PAD_FLOATS) * sizeof(float));
+    soa->lat = buffer;
+    soa->lng = buffer + padded;
+    soa->n = n;
+    return soa;
+}
+
+stream_soa_t* stream_soa_from_stream(const stream_t* stream) {
+    const size_t n = stream->n;
+    const float* data = stream->data;
+    stream_soa_t* soa = stream_soa_create(n);
+    for (size_t i = 0; i < n; i++) {
+        soa->lat[i] = data[2*i + 0];
+        soa->lng[i] = data[2*i + 1];
+    }
+    return soa;
+}
+
+stream_t* stream_soa_to_stream(const stream_soa_t* soa) {
+    const size_t n = soa->n;
+    stream_t* stream = stream_create(n);
+    float* data = stream->data;
+    for (size_t i = 0; i < n; i++) {
+        data[2*i + 0] = soa->lat[i];
+        data[2*i + 1] = soa->lng[i];
+    }
+    return stream;
+}
+
+void stream_soa_destroy(const stream_soa_t* soa) {
+    free(soa->lat);
+    free((void*) soa);
+}
+
+float stream_soa_distance(const stream_soa_t* soa) {
+    return _select_soa_kernels().distance(soa->n - 1, soa->lat, soa->lng);
+}
+
+float* stream_soa_sparsity_create(const stream_soa_t* soa) {
+    const size_t s_n = soa->n;
+    const _soa_kernels_t kernels = _select_soa_kernels();
+    float* sparsity = malloc(sizeof(float) * s_n);
+    float* lengths = malloc(sizeof(float) * (s_n - 1));
+    kernels.length(s_n - 1, soa->lat, soa->lng, lengths);
+    const float optimal_spacing = kernels.distance(s_n - 1, soa->lat, soa->lng) / (s_n - 1);
+    const float two_over_pi = 0.63661977236f;
+    float d1, d2, v;
+    for (size_t n = 0; n < s_n; n++) {
+        // The first and last points count their only neighbour twice.
+        d1 = lengths[(n == 0) ? 0 : n - 1];
+        d2 = lengths[(n == s_n - 1) ? s_n - 2 : n];
+        v = (d1 + d2) / (2 * optimal_spacing);
+        sparsity[n] = (float) (1.0 - two_over_pi * atan(v));
+    }
+    free(lengths);
+    return sparsity;
+}
+
+void dtw_local_cost_row(const stream_soa_t* soa, const float lat, const float lng, const size_t start,
+                        const size_t count, float* out) {
+    _select_soa_kernels().local_cost(count, soa->lat + start, soa->lng + start, lat, lng, out);
+}
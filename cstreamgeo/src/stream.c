@@ -1,4 +1,7 @@
 #include <cstreamgeo/cstreamgeo.h>
+#include <cstreamgeo/parallel.h>
+#include <cstreamgeo/utilc.h>
+#include <immintrin.h>
 #include <stdbool.h>
 #include <stdlib.h>
 #include <stdarg.h>
@@ -74,9 +77,13 @@ float stream_distance(const stream_t* stream) {
 }
 
 float* stream_sparsity_create(const stream_t *stream) {
+    return stream_sparsity_create_ws(stream, NULL);
+}
+
+float* stream_sparsity_create_ws(const stream_t *stream, streamgeo_workspace_t* ws) {
     const size_t s_n = stream->n;
     const float* data = stream->data;
-    float* sparsity = malloc(sizeof(float) * s_n);
+    float* sparsity = streamgeo_workspace_alloc(ws, sizeof(float) * s_n);
 
     const float optimal_spacing = stream_distance(stream) / (s_n - 1);
     const float two_over_pi = 0.63661977236f;
@@ -110,42 +117,75 @@ void stream_statistics_printf(const stream_t* stream) {
     free((void*) sparsity);
 }
 
-float _point_line_distance(float px, float py, float sx, float sy, float ex, float ey) {
-    return (sx == ex && sy == ey) ?
-           (px - sx) * (px - sx) + (py - sy) * (py - sy) :
-           fabsf((ex - sx) * (sy - py) - (sx - px) * (ey - sy)) / sqrtf((ex - sx) * (ex - sx) + (ey - sy) * (ey - sy));
-}
-
-void _douglas_peucker(const stream_t* input, const size_t start, const size_t end, const float epsilon, bool* indices) {
-    const float* input_data = input->data;
-
-    float d_max = 0.0f;
+// Finds the interior point of [start, end] farthest from the line through the endpoints, as
+//     |(ex - sx) * (sy - py) - (sx - px) * (ey - sy)| / length,
+// or, when the endpoints coincide, the squared distance from the start point. Returns its index (or `start` if
+// there is no interior) and writes its distance to `d_max`. The first point wins ties.
+// Rounded division by a positive constant never reverses an ordering, so a point whose numerator does not exceed
+// the best one seen cannot win, and the division is only done for new running maxima; the length is computed once.
+size_t _douglas_peucker_farthest(const float* data, const size_t start, const size_t end, float* d_max) {
+    const float sx = data[2 * start];
+    const float sy = data[2 * start + 1];
+    const float ex = data[2 * end];
+    const float ey = data[2 * end + 1];
+    const int degenerate = (sx == ex && sy == ey);
+    const float length = sqrtf((ex - sx) * (ex - sx) + (ey - sy) * (ey - sy));
+    float best = 0.0f;
+    float numerator_best = 0.0f;
     size_t index_max = start;
-    float sx = input_data[2 * start];
-    float sy = input_data[2 * start + 1];
-    float ex = input_data[2 * end];
-    float ey = input_data[2 * end + 1];
-    // Identify the point with largest distance from its neighbors.
+    float px, py, numerator, d;
     for (size_t i = start + 1; i < end; ++i) {
-        float d = _point_line_distance(input_data[2 * i], input_data[2 * i + 1], sx, sy, ex, ey);
-        if (d > d_max) {
-            index_max = i;
-            d_max = d;
+        px = data[2 * i];
+        py = data[2 * i + 1];
+        numerator = degenerate ? (px - sx) * (px - sx) + (py - sy) * (py - sy)
+                               : fabsf((ex - sx) * (sy - py) - (sx - px) * (ey - sy));
+        if (numerator > numerator_best) {
+            numerator_best = numerator;
+            d = degenerate ? numerator : numerator / length;
+            if (d > best) {
+                index_max = i;
+                best = d;
+            }
         }
     }
-    // If it's at least epsilon away, we need to *keep* this point as it's "significant".
-    if (d_max > epsilon) {
-        // Recurse left-half.
-        if (index_max - start > 1) {
-            _douglas_peucker(input, start, index_max, epsilon, indices);
-        }
-        // Add the significant point.
-        indices[index_max] = 1;
-        // Recurse right-half.
-        if (end - index_max > 1) {
-            _douglas_peucker(input, index_max, end, epsilon, indices);
+    *d_max = best;
+    return index_max;
+}
+
+// Iterative Ramer-Douglas-Peucker over an explicit stack of [start, end] spans, so long streams cannot overflow the
+// call stack. Spans are split at their farthest point while it is more than epsilon away; the kept points do not
+// depend on the order spans are visited in.
+void _douglas_peucker(const stream_t* input, const size_t start, const size_t end, const float epsilon, bool* indices) {
+    const float* input_data = input->data;
+    // Pending spans have disjoint interiors of at least one point each, so there are never more than n / 2 + 1.
+    size_t* stack = malloc(2 * (input->n / 2 + 1) * sizeof(size_t));
+    size_t depth = 0;
+    stack[2 * depth + 0] = start;
+    stack[2 * depth + 1] = end;
+    depth++;
+    size_t span_start, span_end, index_max;
+    float d_max;
+    while (depth > 0) {
+        depth--;
+        span_start = stack[2 * depth + 0];
+        span_end = stack[2 * depth + 1];
+        index_max = _douglas_peucker_farthest(input_data, span_start, span_end, &d_max);
+        // If it's at least epsilon away, we need to *keep* this point as it's "significant".
+        if (d_max > epsilon) {
+            indices[index_max] = 1;
+            if (span_end - index_max > 1) {
+                stack[2 * depth + 0] = index_max;
+                stack[2 * depth + 1] = span_end;
+                depth++;
+            }
+            if (index_max - span_start > 1) {
+                stack[2 * depth + 0] = span_start;
+                stack[2 * depth + 1] = index_max;
+                depth++;
+            }
         }
     }
+    free(stack);
 }
 
 
@@ -173,12 +213,260 @@ void downsample_rdp(stream_t *input, const float epsilon) {
     free(indices);
 }
 
-/*
+// Returns the index of the first point at or after `from` that lies more than sqrt(threshold) from (lat, lng), or n.
+typedef size_t (*_radial_scan_kernel_t)(const float* data, const size_t from, const size_t n, const float lat,
+                                        const float lng, const float threshold);
+
+size_t _radial_scan_scalar(const float* data, const size_t from, const size_t n, const float lat, const float lng,
+                           const float threshold) {
+    float lat_diff, lng_diff;
+    for (size_t i = from; i < n; i++) {
+        lat_diff = data[2*i + 0] - lat;
+        lng_diff = data[2*i + 1] - lng;
+        if ((lat_diff * lat_diff) + (lng_diff * lng_diff) > threshold) {
+            return i;
+        }
+    }
+    return n;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+
+// Four points per step; the movemask of the comparison gives the first far point directly.
+__attribute__((target("sse4.1")))
+size_t _radial_scan_sse4(const float* data, const size_t from, const size_t n, const float lat, const float lng,
+                         const float threshold) {
+    const __m128 anchor = _mm_set_ps(lng, lat, lng, lat);
+    const __m128 limit = _mm_set1_ps(threshold);
+    size_t i = from;
+    for (; i + 4 <= n; i += 4) {
+        const __m128 lo = _mm_sub_ps(_mm_loadu_ps(data + 2*i), anchor);
+        const __m128 hi = _mm_sub_ps(_mm_loadu_ps(data + 2*i + 4), anchor);
+        const __m128 distances = _mm_hadd_ps(_mm_mul_ps(lo, lo), _mm_mul_ps(hi, hi));
+        const int far = _mm_movemask_ps(_mm_cmpgt_ps(distances, limit));
+        if (far) {
+            return i + (size_t) __builtin_ctz((unsigned) far);
+        }
+    }
+    return _radial_scan_scalar(data, i, n, lat, lng, threshold);
+}
+
+// Eight points per step. hadd works within 128 bit lanes, leaving points in order 0 1 4 5 2 3 6 7; the permute
+// restores it so the lowest set mask bit is the first far point.
+__attribute__((target("avx2")))
+size_t _radial_scan_avx2(const float* data, const size_t from, const size_t n, const float lat, const float lng,
+                         const float threshold) {
+    const __m256 anchor = _mm256_set_ps(lng, lat, lng, lat, lng, lat, lng, lat);
+    const __m256 limit = _mm256_set1_ps(threshold);
+    size_t i = from;
+    for (; i + 8 <= n; i += 8) {
+        const __m256 lo = _mm256_sub_ps(_mm256_loadu_ps(data + 2*i), anchor);
+        const __m256 hi = _mm256_sub_ps(_mm256_loadu_ps(data + 2*i + 8), anchor);
+        const __m256 sums = _mm256_hadd_ps(_mm256_mul_ps(lo, lo), _mm256_mul_ps(hi, hi));
+        const __m256 distances = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(sums), 0xD8));
+        const int far = _mm256_movemask_ps(_mm256_cmp_ps(distances, limit, _CMP_GT_OQ));
+        if (far) {
+            return i + (size_t) __builtin_ctz((unsigned) far);
+        }
+    }
+    return _radial_scan_sse4(data, i, n, lat, lng, threshold);
+}
+
+#endif
+
+// Picks the widest kernel the running CPU supports (see _select_soa_kernels in soa.c).
+_radial_scan_kernel_t _select_radial_scan_kernel() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return _radial_scan_avx2;
+    }
+    if (__builtin_cpu_supports("sse4.1")) {
+        return _radial_scan_sse4;
+    }
+#endif
+    return _radial_scan_scalar;
+}
+
+// Writes the points of `data` kept by radial-distance simplification to `out` and returns how many there are.
+// `out` may be `data` itself: a point is always written at or before the position it was read from.
+size_t _radial_distance(const float* data, const size_t n, const float epsilon, float* out) {
+    if (n <= 2) {
+        for (size_t i = 0; i < 2 * n; i++) {
+            out[i] = data[i];
+        }
+        return n;
+    }
+    const _radial_scan_kernel_t scan = _select_radial_scan_kernel();
+    const float threshold = epsilon * epsilon;
+    float lat = data[0];
+    float lng = data[1];
+    out[0] = lat;
+    out[1] = lng;
+    size_t kept = 1;
+    // The last point is always kept, so only the interior is scanned.
+    for (size_t i = scan(data, 1, n - 1, lat, lng, threshold); i < n - 1;
+         i = scan(data, i + 1, n - 1, lat, lng, threshold)) {
+        lat = data[2*i + 0];
+        lng = data[2*i + 1];
+        out[2*kept + 0] = lat;
+        out[2*kept + 1] = lng;
+        kept++;
+    }
+    out[2*kept + 0] = data[2*(n - 1) + 0];
+    out[2*kept + 1] = data[2*(n - 1) + 1];
+    return kept + 1;
+}
+
 stream_t* downsample_radial_distance(const stream_t* input, const float epsilon) {
-    printf("NOT YET IMPLEMENTED\n");
-    return NULL;
+    stream_t* output = stream_create(input->n);
+    output->n = _radial_distance(input->data, input->n, epsilon, output->data);
+    output->data = realloc(output->data, 2 * output->n * sizeof(float));
+    return output;
 }
 
+void downsample_radial_distance_in_place(stream_t* input, const float epsilon) {
+    input->n = _radial_distance(input->data, input->n, epsilon, input->data);
+    input->data = realloc(input->data, 2 * input->n * sizeof(float));
+}
+
+typedef struct {
+    stream_collection_t* collection;
+    float epsilon;
+} _radial_distance_batch_t;
+
+void _radial_distance_task(void* context, const size_t index, const size_t thread_id) {
+    (void) thread_id;
+    _radial_distance_batch_t* batch = context;
+    downsample_radial_distance_in_place(batch->collection->data[index], batch->epsilon);
+}
+
+void downsample_radial_distance_collection(stream_collection_t* collection, const float epsilon, const size_t nthreads) {
+    _radial_distance_batch_t batch = {collection, epsilon};
+    parallel_for(collection->n, nthreads, _radial_distance_task, &batch);
+}
+
+// Visvalingam-Whyatt state: the points still in the stream as a doubly linked list, and an indexed binary min-heap of
+// the interior ones keyed on twice the area of the triangle each forms with its neighbours (ties go to the lower
+// index, so results do not depend on heap layout). position[i] is point i's slot in the heap.
+typedef struct {
+    const float* data;
+    size_t* prev;
+    size_t* next;
+    float* area;
+    size_t* heap;
+    size_t* position;
+    size_t size;
+} _visvalingam_t;
+
+float _visvalingam_area(const _visvalingam_t* vw, const size_t i) {
+    const float* data = vw->data;
+    const size_t a = vw->prev[i];
+    const size_t c = vw->next[i];
+    return fabsf((data[2*i] - data[2*a]) * (data[2*c + 1] - data[2*a + 1]) -
+                 (data[2*c] - data[2*a]) * (data[2*i + 1] - data[2*a + 1]));
+}
+
+int _visvalingam_less(const _visvalingam_t* vw, const size_t i, const size_t j) {
+    return vw->area[i] < vw->area[j] || (vw->area[i] == vw->area[j] && i < j);
+}
+
+void _visvalingam_place(_visvalingam_t* vw, const size_t slot, const size_t i) {
+    vw->heap[slot] = i;
+    vw->position[i] = slot;
+}
+
+void _visvalingam_sift_up(_visvalingam_t* vw, size_t slot) {
+    const size_t i = vw->heap[slot];
+    while (slot > 0 && _visvalingam_less(vw, i, vw->heap[(slot - 1) / 2])) {
+        _visvalingam_place(vw, slot, vw->heap[(slot - 1) / 2]);
+        slot = (slot - 1) / 2;
+    }
+    _visvalingam_place(vw, slot, i);
+}
+
+void _visvalingam_sift_down(_visvalingam_t* vw, size_t slot) {
+    const size_t i = vw->heap[slot];
+    size_t child;
+    while ((child = 2 * slot + 1) < vw->size) {
+        if (child + 1 < vw->size && _visvalingam_less(vw, vw->heap[child + 1], vw->heap[child])) {
+            child++;
+        }
+        if (!_visvalingam_less(vw, vw->heap[child], i)) {
+            break;
+        }
+        _visvalingam_place(vw, slot, vw->heap[child]);
+        slot = child;
+    }
+    _visvalingam_place(vw, slot, i);
+}
+
+// Recomputes the area of interior point i after one of its neighbours went away, and restores the heap order.
+void _visvalingam_update(_visvalingam_t* vw, const size_t i) {
+    const float old_area = vw->area[i];
+    vw->area[i] = _visvalingam_area(vw, i);
+    if (vw->area[i] < old_area) {
+        _visvalingam_sift_up(vw, vw->position[i]);
+    } else {
+        _visvalingam_sift_down(vw, vw->position[i]);
+    }
+}
+
+void downsample_to_count(stream_t* input, const size_t k) {
+    const size_t n = input->n;
+    const size_t target = MAX(k, 2);
+    if (n <= target) {
+        return;
+    }
+    float* data = input->data;
+    size_t* buffer = malloc(4 * n * sizeof(size_t));
+    _visvalingam_t vw = {data, buffer, buffer + n, malloc(n * sizeof(float)), buffer + 2*n, buffer + 3*n, n - 2};
+    for (size_t i = 0; i < n; i++) {
+        vw.prev[i] = i - 1;  // Wraps for the first point, which is never looked at.
+        vw.next[i] = i + 1;
+    }
+    for (size_t i = 1; i < n - 1; i++) {
+        vw.area[i] = _visvalingam_area(&vw, i);
+        vw.heap[i - 1] = i;
+        vw.position[i] = i - 1;
+    }
+    for (size_t slot = vw.size / 2; slot-- > 0;) {
+        _visvalingam_sift_down(&vw, slot);
+    }
+    size_t removed, before, after;
+    for (size_t remaining = n; remaining > target; remaining--) {
+        removed = vw.heap[0];
+        vw.size--;
+        if (vw.size > 0) {
+            _visvalingam_place(&vw, 0, vw.heap[vw.size]);
+            _visvalingam_sift_down(&vw, 0);
+        }
+        before = vw.prev[removed];
+        after = vw.next[removed];
+        vw.next[before] = after;
+        vw.prev[after] = before;
+        if (before > 0) {
+            _visvalingam_update(&vw, before);
+        }
+        if (after < n - 1) {
+            _visvalingam_update(&vw, after);
+        }
+    }
+    // Walking the list from the first point visits the survivors in order; compacting in place is safe because each
+    // is written at or before its old position.
+    size_t count = 0;
+    for (size_t i = 0; i < n; i = vw.next[i]) {
+        data[2*count + 0] = data[2*i + 0];
+        data[2*count + 1] = data[2*i + 1];
+        count++;
+    }
+    free(vw.area);
+    free(buffer);
+    input->n = count;
+    input->data = realloc(data, 2 * count * sizeof(float));
+}
+
+/*
 stream_t* resample_fixed_factor(const stream_t* input, const size_t n, const size_t m) {
     printf("NOT YET IMPLEMENTED\n");
     return NULL;
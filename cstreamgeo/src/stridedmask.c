@@ -1,13 +1,18 @@
 #include <cstreamgeo/stridedmask.h>
 #include <cstreamgeo/utilc.h>
 #include <stdio.h>
+#include <math.h>
 
 strided_mask_t* strided_mask_create(const size_t n_rows, const size_t n_cols) {
-    strided_mask_t* mask = malloc(sizeof(strided_mask_t));
+    return strided_mask_create_ws(n_rows, n_cols, NULL);
+}
+
+strided_mask_t* strided_mask_create_ws(const size_t n_rows, const size_t n_cols, streamgeo_workspace_t* ws) {
+    strided_mask_t* mask = streamgeo_workspace_alloc(ws, sizeof(strided_mask_t));
     mask->n_rows = n_rows;
     mask->n_cols = n_cols;
-    mask->start_cols = malloc(n_rows * sizeof(size_t));
-    mask->end_cols = malloc(n_rows * sizeof(size_t));
+    mask->start_cols = streamgeo_workspace_alloc(ws, n_rows * sizeof(size_t));
+    mask->end_cols = streamgeo_workspace_alloc(ws, n_rows * sizeof(size_t));
     return mask;
 }
 
@@ -26,9 +31,13 @@ strided_mask_t* strided_mask_create_from_list(const size_t n_rows, const size_t
 }
 
 void strided_mask_destroy(const strided_mask_t* mask) {
-    free(mask->start_cols);
-    free(mask->end_cols);
-    free((void*) mask);
+    strided_mask_destroy_ws(mask, NULL);
+}
+
+void strided_mask_destroy_ws(const strided_mask_t* mask, streamgeo_workspace_t* ws) {
+    streamgeo_workspace_free(ws, mask->start_cols);
+    streamgeo_workspace_free(ws, mask->end_cols);
+    streamgeo_workspace_free(ws, (void*) mask);
 }
 
 void strided_mask_printf(const strided_mask_t* mask) {
@@ -75,19 +84,20 @@ size_t* strided_mask_to_index_pairs(const strided_mask_t* mask, size_t* path_len
 }
 
 strided_mask_t* strided_mask_expand(const strided_mask_t* mask, const int row_parity, const int col_parity, const size_t radius) {
+    return strided_mask_expand_ws(mask, row_parity, col_parity, radius, NULL);
+}
+
+strided_mask_t* strided_mask_expand_ws(const strided_mask_t* mask, const int row_parity, const int col_parity,
+                                       const size_t radius, streamgeo_workspace_t* ws) {
     const size_t n_rows_initial = mask->n_rows;
     const size_t n_cols_initial = mask->n_cols;
     const size_t* start_cols_initial = mask->start_cols;
     const size_t* end_cols_initial = mask->end_cols;
     const size_t n_rows_final = 2 * n_rows_initial + row_parity;
     const size_t n_cols_final = 2 * n_cols_initial + col_parity;
-    size_t* start_cols_final = malloc(n_rows_final * sizeof(size_t));
-    size_t* end_cols_final = malloc(n_rows_final * sizeof(size_t));
-    strided_mask_t* retmask = malloc(sizeof(strided_mask_t));
-    retmask->n_rows = n_rows_final;
-    retmask->n_cols = n_cols_final;
-    retmask->start_cols = start_cols_final;
-    retmask->end_cols = end_cols_final;
+    strided_mask_t* retmask = strided_mask_create_ws(n_rows_final, n_cols_final, ws);
+    size_t* start_cols_final = retmask->start_cols;
+    size_t* end_cols_final = retmask->end_cols;
     for (int row = 0; row < (int) n_rows_final; row++) {
         // NOTE: `row` is an int on purpose, we want to be able to subtract values and see negative numbers.
         size_t prev_row = (size_t) (MIN ( MAX(row - (int) radius,                          0), 2*((int) n_rows_initial-1)) / 2);
@@ -97,3 +107,52 @@ strided_mask_t* strided_mask_expand(const strided_mask_t* mask, const int row_pa
     }
     return retmask;
 }
+
+// Widens runs so that every row's run reaches at least the column before the next row's run starts. Without this, a
+// steep window can leave rows whose runs only touch diagonally-nonadjacent cells, and no warp path fits inside it.
+// Monotone start and end columns stay monotone.
+void _strided_mask_connect(strided_mask_t* mask) {
+    for (size_t row = 0; row + 1 < mask->n_rows; row++) {
+        if (mask->start_cols[row + 1] > 0) {
+            mask->end_cols[row] = MAX(mask->end_cols[row], mask->start_cols[row + 1] - 1);
+        }
+    }
+}
+
+strided_mask_t* strided_mask_create_sakoe_chiba(const size_t n_rows, const size_t n_cols, const size_t band) {
+    strided_mask_t* mask = strided_mask_create(n_rows, n_cols);
+    const double slope = (n_rows > 1) ? (double) (n_cols - 1) / (double) (n_rows - 1) : 0.0;
+    double diagonal;
+    for (size_t row = 0; row < n_rows; row++) {
+        diagonal = slope * row;
+        mask->start_cols[row] = (size_t) MAX(floor(diagonal) - (double) band, 0.0);
+        mask->end_cols[row] = (size_t) MIN(ceil(diagonal) + (double) band, (double) (n_cols - 1));
+    }
+    mask->end_cols[n_rows - 1] = n_cols - 1;
+    _strided_mask_connect(mask);
+    return mask;
+}
+
+strided_mask_t* strided_mask_create_sakoe_chiba_fraction(const size_t n_rows, const size_t n_cols, const float fraction) {
+    const size_t band = (size_t) ceil(fraction * (double) MAX(n_rows, n_cols));
+    return strided_mask_create_sakoe_chiba(n_rows, n_cols, band);
+}
+
+strided_mask_t* strided_mask_create_itakura(const size_t n_rows, const size_t n_cols, const float slope) {
+    strided_mask_t* mask = strided_mask_create(n_rows, n_cols);
+    const double s = MAX((double) slope, 1.0);
+    const double last_col = (double) (n_cols - 1);
+    double x, lo, hi;
+    for (size_t row = 0; row < n_rows; row++) {
+        // Normalized coordinates: x, y in [0, 1]. Paths leave the origin and arrive at (1, 1) with slopes in [1/s, s].
+        x = (n_rows > 1) ? (double) row / (double) (n_rows - 1) : 1.0;
+        lo = MAX(x / s, 1.0 - s * (1.0 - x));
+        hi = MIN(s * x, 1.0 - (1.0 - x) / s);
+        mask->start_cols[row] = (size_t) MIN(MAX(floor(lo * last_col), 0.0), last_col);
+        mask->end_cols[row] = (size_t) MIN(MAX(ceil(hi * last_col), 0.0), last_col);
+    }
+    mask->start_cols[0] = 0;
+    mask->end_cols[n_rows - 1] = n_cols - 1;
+    _strided_mask_connect(mask);
+    return mask;
+}
@@ -0,0 +1,120 @@
+#include <cstreamgeo/workspace.h>
+#include <cstreamgeo/utilc.h>
+#include <stdlib.h>
+
+/**
+ * Bump-allocating scratch arena. See workspace.h.
+ */
+
+
+#define WORKSPACE_ALIGNMENT 64
+#define WORKSPACE_DEFAULT_BYTES (64 * 1024)
+
+typedef struct _workspace_block {
+    struct _workspace_block* next;  // Later (spare or in use) block in the chain
+    size_t capacity;                // Usable bytes in `data`
+    size_t used;                    // Bytes handed out from `data`
+    _Alignas(WORKSPACE_ALIGNMENT) unsigned char data[];
+} _workspace_block_t;
+
+struct streamgeo_workspace {
+    _workspace_block_t* head;       // First block in the chain
+    _workspace_block_t* current;    // Block allocations are bumped from; blocks after it are spares
+    size_t capacity;                // Sum of block capacities
+};
+
+_workspace_block_t* _workspace_block_create(const size_t capacity) {
+    _workspace_block_t* block = aligned_alloc(WORKSPACE_ALIGNMENT, sizeof(_workspace_block_t) + capacity);
+    block->next = NULL;
+    block->capacity = capacity;
+    block->used = 0;
+    return block;
+}
+
+size_t _workspace_round_up(const size_t bytes) {
+    return (bytes + WORKSPACE_ALIGNMENT - 1) & ~((size_t) WORKSPACE_ALIGNMENT - 1);
+}
+
+streamgeo_workspace_t* streamgeo_workspace_create(const size_t initial_bytes) {
+    streamgeo_workspace_t* ws = malloc(sizeof(streamgeo_workspace_t));
+    const size_t capacity = _workspace_round_up(initial_bytes ? initial_bytes : WORKSPACE_DEFAULT_BYTES);
+    ws->head = _workspace_block_create(capacity);
+    ws->current = ws->head;
+    ws->capacity = capacity;
+    return ws;
+}
+
+void _workspace_chain_destroy(_workspace_block_t* block) {
+    _workspace_block_t* next;
+    while (block) {
+        next = block->next;
+        free(block);
+        block = next;
+    }
+}
+
+void streamgeo_workspace_destroy(streamgeo_workspace_t* ws) {
+    _workspace_chain_destroy(ws->head);
+    free(ws);
+}
+
+void streamgeo_workspace_reset(streamgeo_workspace_t* ws) {
+    if (ws->head->next) {
+        _workspace_chain_destroy(ws->head);
+        ws->head = _workspace_block_create(ws->capacity);
+    }
+    ws->head->used = 0;
+    ws->current = ws->head;
+}
+
+size_t streamgeo_workspace_capacity(const streamgeo_workspace_t* ws) {
+    return ws->capacity;
+}
+
+void* streamgeo_workspace_alloc(streamgeo_workspace_t* ws, const size_t bytes) {
+    if (ws == NULL) {
+        return malloc(bytes);
+    }
+    const size_t size = _workspace_round_up(MAX(bytes, 1));
+    _workspace_block_t* block = ws->current;
+    if (block->capacity - block->used < size) {
+        // Move on to the next spare block; if there is none that fits, chain a new one in front of the spares.
+        if (block->next && block->next->capacity >= size) {
+            block = block->next;
+        } else {
+            _workspace_block_t* fresh = _workspace_block_create(MAX(2 * block->capacity, size));
+            fresh->next = block->next;
+            block->next = fresh;
+            ws->capacity += fresh->capacity;
+            block = fresh;
+        }
+        block->used = 0;
+        ws->current = block;
+    }
+    void* ptr = block->data + block->used;
+    block->used += size;
+    return ptr;
+}
+
+void streamgeo_workspace_free(streamgeo_workspace_t* ws, void* ptr) {
+    if (ws == NULL) {
+        free(ptr);
+    }
+}
+
+streamgeo_workspace_mark_t streamgeo_workspace_mark(const streamgeo_workspace_t* ws) {
+    streamgeo_workspace_mark_t mark = {NULL, 0};
+    if (ws != NULL) {
+        mark.block = ws->current;
+        mark.used = ws->current->used;
+    }
+    return mark;
+}
+
+void streamgeo_workspace_release(streamgeo_workspace_t* ws, const streamgeo_workspace_mark_t mark) {
+    if (ws == NULL) {
+        return;
+    }
+    ws->current = mark.block;
+    ws->current->used = mark.used;
+}
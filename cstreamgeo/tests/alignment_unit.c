@@ -1,7 +1,10 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <float.h>
+#include <math.h>
 
 #include <cstreamgeo/cstreamgeo.h>
+#include <cstreamgeo/io.h>
 
 #include "test.h"
 
@@ -56,11 +59,554 @@ void fast_align_test_small() {
     stream_destroy(b);
 }
 
+void fast_align_test_full_window() {
+    // With a radius this large, the expanded window covers the whole cost matrix,
+    // so the banded windowed DTW must reproduce the full DTW exactly.
+    const size_t a_n = 40;
+    const size_t b_n = 37;
+    const size_t radius = 30;
+    stream_t* a = stream_create(a_n);
+    stream_t* b = stream_create(b_n);
+    for (size_t i = 0; i < a_n; i++) {
+        a->data[2*i] = (float) i;
+        a->data[2*i+1] = (float) ((i * 7) % 5);
+    }
+    for (size_t i = 0; i < b_n; i++) {
+        b->data[2*i] = 1.1f * i;
+        b->data[2*i+1] = (float) ((i * 3) % 4);
+    }
+    const warp_summary_t* full = full_warp_summary_create(a, b);
+    const warp_summary_t* fast = fast_warp_summary_create(a, b, radius);
+
+    assert_true(full->cost == fast->cost);
+    assert_int_equal(full->path_length, fast->path_length);
+    for (size_t i = 0; i < 2*full->path_length; i++) {
+        assert_int_equal(full->index_pairs[i], fast->index_pairs[i]);
+    }
+    warp_summary_destroy(full);
+    warp_summary_destroy(fast);
+    stream_destroy(a);
+    stream_destroy(b);
+}
+
+void full_cost_matches_full_align_test() {
+    // The SIMD wavefront kernels must agree bit-for-bit with the scalar DP, across sizes that exercise vector tails.
+    const size_t sizes[6][2] = {{1, 1}, {5, 9}, {33, 32}, {64, 100}, {257, 131}, {500, 517}};
+    srand(42);
+    for (size_t s = 0; s < 6; s++) {
+        stream_t* a = stream_create(sizes[s][0]);
+        stream_t* b = stream_create(sizes[s][1]);
+        for (size_t i = 0; i < 2*a->n; i++) a->data[i] = (float) rand() / RAND_MAX;
+        for (size_t i = 0; i < 2*b->n; i++) b->data[i] = (float) rand() / RAND_MAX;
+        const warp_summary_t* full = full_warp_summary_create(a, b);
+        assert_true(full_dtw_cost(a, b) == full->cost);
+        assert_true(full_dtw_cost(b, a) == full->cost);
+        warp_summary_destroy(full);
+        stream_destroy(a);
+        stream_destroy(b);
+    }
+}
+
+void linear_space_align_test() {
+    // Random data has no ties, so the divide-and-conquer path must match the table traceback exactly.
+    const size_t sizes[5][2] = {{1, 1}, {1, 70}, {90, 1}, {4, 3}, {301, 257}};
+    srand(7);
+    for (size_t s = 0; s < 5; s++) {
+        stream_t* a = stream_create(sizes[s][0]);
+        stream_t* b = stream_create(sizes[s][1]);
+        for (size_t i = 0; i < 2*a->n; i++) a->data[i] = (float) rand() / RAND_MAX;
+        for (size_t i = 0; i < 2*b->n; i++) b->data[i] = (float) rand() / RAND_MAX;
+        const warp_summary_t* table = full_warp_summary_create_with_recovery(a, b, PATH_RECOVERY_TABLE);
+        const warp_summary_t* linear = full_warp_summary_create_with_recovery(a, b, PATH_RECOVERY_LINEAR_SPACE);
+        assert_true(table->cost == linear->cost);
+        assert_int_equal(table->path_length, linear->path_length);
+        for (size_t i = 0; i < 2*table->path_length; i++) {
+            assert_int_equal(table->index_pairs[i], linear->index_pairs[i]);
+        }
+        warp_summary_destroy(table);
+        warp_summary_destroy(linear);
+        stream_destroy(a);
+        stream_destroy(b);
+    }
+}
+
+void bounded_cost_test() {
+    const size_t a_n = 40;
+    const size_t b_n = 37;
+    stream_t* a = stream_create(a_n);
+    stream_t* b = stream_create(b_n);
+    srand(7);
+    for (size_t i = 0; i < 2*a_n; i++) a->data[i] = (float) rand() / RAND_MAX;
+    for (size_t i = 0; i < 2*b_n; i++) b->data[i] = (float) rand() / RAND_MAX;
+    const float cost = full_dtw_cost(a, b);
+
+    assert_true(full_dtw_cost_bounded(a, b, cost) == cost);
+    assert_true(full_dtw_cost_bounded(a, b, FLT_MAX) == cost);
+    assert_true(isinf(full_dtw_cost_bounded(a, b, 0.5f * cost)));
+    assert_true(isinf(full_dtw_cost_bounded(a, b, 0.0f)));
+
+    // A window covering every cell must agree with the unwindowed cost.
+    strided_mask_t* window = strided_mask_create(a_n, b_n);
+    for (size_t row = 0; row < a_n; row++) {
+        window->start_cols[row] = 0;
+        window->end_cols[row] = b_n - 1;
+    }
+    assert_true(windowed_dtw_cost_bounded(a, b, window, FLT_MAX) == cost);
+    assert_true(isinf(windowed_dtw_cost_bounded(a, b, window, 0.5f * cost)));
+    strided_mask_destroy(window);
+
+    stream_destroy(a);
+    stream_destroy(b);
+}
+
+void windowed_align_test() {
+    const size_t a_n = 80;
+    const size_t b_n = 95;
+    stream_t* a = stream_create(a_n);
+    stream_t* b = stream_create(b_n);
+    srand(9);
+    for (size_t i = 0; i < 2*a_n; i++) a->data[i] = (float) rand() / RAND_MAX;
+    for (size_t i = 0; i < 2*b_n; i++) b->data[i] = (float) rand() / RAND_MAX;
+    const warp_summary_t* full = full_warp_summary_create(a, b);
+
+    // A band covering the whole matrix reproduces full DTW exactly.
+    strided_mask_t* wide = strided_mask_create_sakoe_chiba(a_n, b_n, b_n);
+    const warp_summary_t* windowed = windowed_warp_summary_create(a, b, wide);
+    assert_true(windowed->cost == full->cost);
+    assert_true(windowed_dtw_cost(a, b, wide) == full->cost);
+    assert_int_equal(windowed->path_length, full->path_length);
+    for (size_t i = 0; i < 2*full->path_length; i++) {
+        assert_int_equal(windowed->index_pairs[i], full->index_pairs[i]);
+    }
+    warp_summary_destroy(windowed);
+    strided_mask_destroy(wide);
+
+    // Narrower windows can only cost more, and their paths stay inside them.
+    strided_mask_t* windows[3] = {
+            strided_mask_create_sakoe_chiba(a_n, b_n, 0),
+            strided_mask_create_sakoe_chiba_fraction(a_n, b_n, 0.1f),
+            strided_mask_create_itakura(a_n, b_n, 2.0f)
+    };
+    for (size_t w = 0; w < 3; w++) {
+        windowed = windowed_warp_summary_create(a, b, windows[w]);
+        assert_true(windowed->cost >= full->cost);
+        assert_true(windowed_dtw_cost(a, b, windows[w]) == windowed->cost);
+        for (size_t i = 0; i < windowed->path_length; i++) {
+            const size_t row = windowed->index_pairs[2*i];
+            const size_t col = windowed->index_pairs[2*i + 1];
+            assert_true(windows[w]->start_cols[row] <= col && col <= windows[w]->end_cols[row]);
+        }
+        warp_summary_destroy(windowed);
+        strided_mask_destroy(windows[w]);
+    }
+    warp_summary_destroy(full);
+    stream_destroy(a);
+    stream_destroy(b);
+}
+// `similarity` as it was written before the rejection cascade: only the distance ratio and start/mid/end checks may
+// short circuit, everything else is scored on the FastDTW path.
+float reference_similarity(const stream_t* a, const stream_t* b, const size_t radius) {
+    if (a->n < 2 || b->n < 2) return 0.0f;
+    const float a_distance = stream_distance(a);
+    const float b_distance = stream_distance(b);
+    const float ratio = a_distance / b_distance;
+    if (ratio < 0.4 || ratio > 2.5) return 0.0f;
+    const float min_distance = 0.3f * fminf(a_distance, b_distance);
+    const size_t a_i[3] = {0, a->n / 2, a->n - 1};
+    const size_t b_i[3] = {0, b->n / 2, b->n - 1};
+    for (size_t k = 0; k < 3; k++) {
+        const float lat_diff = b->data[2*b_i[k]] - a->data[2*a_i[k]];
+        const float lng_diff = b->data[2*b_i[k]+1] - a->data[2*a_i[k]+1];
+        if (sqrtf((lng_diff * lng_diff) + (lat_diff * lat_diff)) > min_distance) return 0.0f;
+    }
+    float* a_sparsity = stream_sparsity_create(a);
+    float* b_sparsity = stream_sparsity_create(b);
+    const warp_summary_t* summary = fast_warp_summary_create(a, b, radius);
+    float total_weight = 0.0f;
+    float total_weight_error = 0.0f;
+    for (size_t n = 0; n < summary->path_length; n++) {
+        const size_t i = summary->index_pairs[2*n];
+        const size_t j = summary->index_pairs[2*n+1];
+        const float lat_diff = b->data[2*j] - a->data[2*i];
+        const float lng_diff = b->data[2*j+1] - a->data[2*i+1];
+        const float unitless_cost = sqrtf((lng_diff * lng_diff) + (lat_diff * lat_diff)) / min_distance;
+        const float error = (float) (1.0 - exp(-unitless_cost * unitless_cost));
+        const float weight = (float) (a_sparsity[i] * b_sparsity[j] * (0.1 + 0.9 * sin(3.1415926535f * i / a->n)) *
+                                      (0.1 + 0.9 * sin(3.1415926535f * j / b->n)));
+        total_weight += weight;
+        total_weight_error += (error * weight);
+    }
+    warp_summary_destroy(summary);
+    free(a_sparsity);
+    free(b_sparsity);
+    return (float) (1.0 - total_weight_error / total_weight);
+}
+
+void similarity_cascade_test() {
+    // A straight 20-degree line with a 20-degree excursion in longitude at index `bump`.
+    const size_t n = 21;
+    stream_t* a = stream_create(n);
+    stream_t* b = stream_create(n);
+    for (size_t i = 0; i < n; i++) {
+        a->data[2*i] = b->data[2*i] = (float) i;
+        a->data[2*i+1] = b->data[2*i+1] = 0.0f;
+    }
+    a->data[2*15+1] = 20.0f;
+    b->data[2*5+1] = 20.0f;
+    const stream_t* reversed = stream_create_from_list(3, 20.0, 0.0, 10.0, 0.0, 0.0, 0.0);
+    const stream_t* far_away = stream_create_from_list(3, 0.0, 100.0, 10.0, 100.0, 20.0, 100.0);
+    const stream_t* straight = stream_create_from_list(3, 0.0, 0.0, 10.0, 0.0, 20.0, 0.0);
+    const stream_t* short_line = stream_create_from_list(2, 0.0, 0.0, 1.0, 0.0);
+    const stream_t* single = stream_create_from_list(1, 0.0, 0.0);
+
+    similarity_stats_reset();
+    assert_true(similarity(single, straight, 1) == 0.0f);
+    assert_true(similarity(short_line, straight, 1) == 0.0f);
+    assert_true(similarity(far_away, straight, 1) == 0.0f);
+    assert_true(similarity(reversed, straight, 1) == 0.0f);
+    // Endpoints and midpoints agree, so the pair is scored even though the excursions are 10 points apart.
+    assert_true(similarity(a, b, 1) == reference_similarity(a, b, 1));
+    assert_true(similarity(a, b, 1) > 0.0f);
+    assert_true(similarity(a, a, 1) > 0.99f);
+
+    similarity_stats_t stats;
+    similarity_stats_get(&stats);
+    assert_int_equal(stats.evaluated, 7);
+    assert_int_equal(stats.rejected_improper, 1);
+    assert_int_equal(stats.rejected_distance_ratio, 1);
+    assert_int_equal(stats.rejected_bounding_box, 0);
+    assert_int_equal(stats.rejected_lb_kim, 2);
+    assert_int_equal(stats.rejected_lb_keogh, 0);
+    assert_int_equal(stats.aligned, 3);
+
+    // The strict cascade also rejects on bounding boxes, extents and the envelope.
+    similarity_stats_reset();
+    const stream_t* offset = stream_create_from_list(3, 0.0, 5.0, 10.0, 5.0, 20.0, 5.0);
+    assert_true(similarity_strict(far_away, straight, 1) == 0.0f);
+    assert_true(similarity_strict(reversed, straight, 1) == 0.0f);
+    assert_true(similarity_strict(a, b, 1) == 0.0f);
+    assert_true(similarity_strict(a, a, 1) == similarity(a, a, 1));
+    assert_true(similarity_strict(offset, straight, 1) == similarity(offset, straight, 1));
+    similarity_stats_get(&stats);
+    assert_int_equal(stats.evaluated, 7);
+    assert_int_equal(stats.rejected_bounding_box, 1);
+    assert_int_equal(stats.rejected_lb_kim, 1);
+    assert_int_equal(stats.rejected_lb_keogh, 1);
+    assert_int_equal(stats.aligned, 4);
+
+    similarity_stats_reset();
+    similarity_stats_get(&stats);
+    assert_int_equal(stats.evaluated, 0);
+
+    stream_destroy(a);
+    stream_destroy(b);
+    stream_destroy(offset);
+    stream_destroy(reversed);
+    stream_destroy(far_away);
+    stream_destroy(straight);
+    stream_destroy(short_line);
+    stream_destroy(single);
+}
+
+void similarity_matches_reference_test() {
+    // Noisy copies of a winding route, some with a single GPS glitch a quarter of the way in, which must not change
+    // how the pair is judged.
+    const size_t n = 200;
+    stream_t* route = stream_create(n);
+    for (size_t i = 0; i < n; i++) {
+        route->data[2*i] = (float) i / 100;
+        route->data[2*i+1] = sinf((float) i / 30);
+    }
+    srand(12);
+    for (size_t c = 0; c < 12; c++) {
+        const size_t m = 150 + (size_t) (rand() % 100);
+        stream_t* copy = stream_create(m);
+        for (size_t i = 0; i < m; i++) {
+            const size_t k = i * (n - 1) / (m - 1);
+            copy->data[2*i] = route->data[2*k] + 0.01f * ((float) rand() / RAND_MAX - 0.5f);
+            copy->data[2*i+1] = route->data[2*k+1] + 0.01f * ((float) rand() / RAND_MAX - 0.5f);
+        }
+        if (c % 2) {
+            copy->data[2*(m / 4)] += 1.5f;
+        }
+        const float expected = reference_similarity(route, copy, 4);
+        assert_true(fabsf(similarity(route, copy, 4) - expected) <= 1e-6f);
+        assert_true(expected > 0.9f);
+        stream_destroy(copy);
+    }
+    stream_destroy(route);
+}
+
+void similarity_batch_test() {
+    // Noisy copies of a winding route, of varying lengths, plus one improper stream.
+    const size_t n_candidates = 40;
+    const stream_t* query = stream_create(120);
+    float* q = query->data;
+    srand(11);
+    for (size_t i = 0; i < query->n; i++) {
+        q[2*i] = (float) i / 10;
+        q[2*i+1] = sinf((float) i / 15);
+    }
+    stream_collection_t* candidates = stream_collection_create(n_candidates);
+    for (size_t c = 0; c < n_candidates; c++) {
+        const size_t n = (c == 7) ? 1 : 60 + 5 * c;
+        stream_t* candidate = stream_create(n);
+        for (size_t i = 0; i < n; i++) {
+            const float t = (float) i * (query->n - 1) / (n > 1 ? n - 1 : 1);
+            candidate->data[2*i] = t / 10 + 0.05f * ((float) rand() / RAND_MAX - 0.5f);
+            candidate->data[2*i+1] = sinf(t / 15) + 0.05f * ((float) rand() / RAND_MAX - 0.5f) + 0.01f * c;
+        }
+        candidates->data[c] = candidate;
+    }
+    float out[n_candidates];
+    const size_t thread_counts[3] = {0, 1, 3};
+    for (size_t t = 0; t < 3; t++) {
+        similarity_batch(query, candidates, 4, out, thread_counts[t]);
+        for (size_t c = 0; c < n_candidates; c++) {
+            assert_true(out[c] == similarity(query, candidates->data[c], 4));
+        }
+        assert_true(out[7] == 0.0f);
+        assert_true(out[0] > 0.5f);
+    }
+    stream_collection_destroy(candidates);
+    stream_destroy(query);
+}
+
+void workspace_variants_test() {
+    // The _ws variants must reproduce the heap versions exactly, and stop growing the workspace once warmed up.
+    const size_t a_n = 300;
+    const size_t b_n = 270;
+    stream_t* a = stream_create(a_n);
+    stream_t* b = stream_create(b_n);
+    for (size_t i = 0; i < a_n; i++) {
+        a->data[2*i] = (float) i / 10;
+        a->data[2*i+1] = sinf((float) i / 20);
+    }
+    for (size_t i = 0; i < b_n; i++) {
+        b->data[2*i] = (float) i / 9;
+        b->data[2*i+1] = sinf((float) i / 18) + 0.01f;
+    }
+    streamgeo_workspace_t* ws = streamgeo_workspace_create(0);
+    size_t capacity = 0;
+    for (size_t round = 0; round < 3; round++) {
+        const warp_summary_t* heap = fast_warp_summary_create(a, b, 4);
+        const warp_summary_t* arena = fast_warp_summary_create_ws(a, b, 4, ws);
+        assert_true(heap->cost == arena->cost);
+        assert_int_equal(heap->path_length, arena->path_length);
+        for (size_t i = 0; i < 2*heap->path_length; i++) {
+            assert_int_equal(heap->index_pairs[i], arena->index_pairs[i]);
+        }
+        warp_summary_destroy(heap);
+        heap = full_warp_summary_create(a, b);
+        arena = full_warp_summary_create_ws(a, b, ws);
+        assert_true(heap->cost == arena->cost);
+        assert_int_equal(heap->path_length, arena->path_length);
+        warp_summary_destroy(heap);
+        assert_true(similarity(a, b, 4) == similarity_ws(a, b, 4, ws));
+        streamgeo_workspace_reset(ws);
+        if (round > 0) {
+            assert_int_equal(streamgeo_workspace_capacity(ws), capacity);
+        }
+        capacity = streamgeo_workspace_capacity(ws);
+    }
+    streamgeo_workspace_destroy(ws);
+    stream_destroy(a);
+    stream_destroy(b);
+}
+
+void subsequence_dtw_test() {
+    // Activity: a straight approach, two laps of the segment, then a straight exit, all far from the segment's loop.
+    const size_t seg_n = 50;
+    const size_t lead_n = 30;
+    stream_t* segment = stream_create(seg_n);
+    for (size_t i = 0; i < seg_n; i++) {
+        segment->data[2*i] = cosf(6.0f * i / seg_n);
+        segment->data[2*i+1] = sinf(6.0f * i / seg_n);
+    }
+    const size_t act_n = lead_n + 2 * seg_n + lead_n;
+    stream_t* activity = stream_create(act_n);
+    for (size_t i = 0; i < act_n; i++) {
+        if (i < lead_n || i >= lead_n + 2 * seg_n) {
+            activity->data[2*i] = 10.0f + i;
+            activity->data[2*i+1] = 10.0f;
+        } else {
+            const size_t k = (i - lead_n) % seg_n;
+            activity->data[2*i] = segment->data[2*k] + 0.001f * (i >= lead_n + seg_n);
+            activity->data[2*i+1] = segment->data[2*k+1];
+        }
+    }
+    const subsequence_match_t best = subsequence_dtw_find(segment, activity);
+    assert_int_equal(best.start, lead_n);
+    assert_int_equal(best.end, lead_n + seg_n - 1);
+    assert_true(best.cost == 0.0f);
+
+    subsequence_match_t matches[3];
+    const size_t found = subsequence_dtw_find_top_k(segment, activity, 3, matches);
+    assert_true(found >= 2);
+    assert_int_equal(matches[0].start, lead_n);
+    assert_int_equal(matches[0].end, lead_n + seg_n - 1);
+    assert_int_equal(matches[1].start, lead_n + seg_n);
+    assert_int_equal(matches[1].end, lead_n + 2 * seg_n - 1);
+    assert_true(matches[1].cost < 1e-3f);
+    for (size_t m = 1; m < found; m++) {
+        assert_true(matches[m - 1].cost <= matches[m].cost);
+    }
+
+    // A stream searched for inside itself matches all of itself.
+    const subsequence_match_t self = subsequence_dtw_find(segment, segment);
+    assert_int_equal(self.start, 0);
+    assert_int_equal(self.end, seg_n - 1);
+    stream_destroy(segment);
+    stream_destroy(activity);
+}
+
+void dtw_stream_test() {
+    srand(5);
+    stream_t* reference = stream_create(60);
+    stream_t* activity = stream_create(150);
+    for (size_t i = 0; i < 2*reference->n; i++) reference->data[i] = (float) rand() / RAND_MAX;
+    for (size_t i = 0; i < 2*activity->n; i++) activity->data[i] = (float) rand() / RAND_MAX;
+    // Embed a slightly perturbed copy of the reference in the middle of the activity.
+    for (size_t i = 0; i < reference->n; i++) {
+        activity->data[2*(40 + i) + 0] = reference->data[2*i + 0] + 0.001f;
+        activity->data[2*(40 + i) + 1] = reference->data[2*i + 1];
+    }
+
+    // Closed begin, no band: after every point, the cost is exactly the full DTW cost of the prefix.
+    dtw_stream_state_t* closed = dtw_stream_create(reference, 0, 0);
+    stream_t prefix = {activity->data, 0};
+    for (size_t j = 0; j < activity->n; j++) {
+        dtw_stream_push(closed, activity->data[2*j], activity->data[2*j+1]);
+        prefix.n = j + 1;
+        if (j % 10 == 0) {
+            assert_true(dtw_stream_cost(closed) == full_dtw_cost(reference, &prefix));
+        }
+    }
+    assert_true(dtw_stream_cost(closed) == full_dtw_cost(reference, activity));
+    dtw_stream_destroy(closed);
+
+    // Open begin: the best match is the one found by subsequence DTW, with or without a generous band.
+    const subsequence_match_t expected = subsequence_dtw_find(reference, activity);
+    assert_int_equal(expected.start, 40);
+    assert_int_equal(expected.end, 40 + reference->n - 1);
+    const size_t bands[2] = {0, 20};
+    for (size_t b = 0; b < 2; b++) {
+        dtw_stream_state_t* open = dtw_stream_create(reference, 1, bands[b]);
+        for (size_t j = 0; j < activity->n; j++) {
+            dtw_stream_push(open, activity->data[2*j], activity->data[2*j+1]);
+            if (40 <= j && j < 40 + reference->n) {
+                assert_int_equal(dtw_stream_position(open), j - 40);
+            }
+        }
+        const subsequence_match_t best = dtw_stream_best_match(open);
+        assert_int_equal(best.start, expected.start);
+        assert_int_equal(best.end, expected.end);
+        if (bands[b] == 0) {
+            assert_true(best.cost == expected.cost);
+        }
+        dtw_stream_destroy(open);
+    }
+    stream_destroy(reference);
+    stream_destroy(activity);
+}
+
+void pairwise_cost_matrix_test() {
+    const size_t n = 23;
+    stream_collection_t* collection = stream_collection_create(n);
+    srand(5);
+    for (size_t c = 0; c < n; c++) {
+        stream_t* stream = stream_create(10 + 13 * c);
+        for (size_t i = 0; i < 2*stream->n; i++) stream->data[i] = (float) rand() / RAND_MAX;
+        collection->data[c] = stream;
+    }
+    const size_t radius = 3;
+    float* full = pairwise_cost_matrix(collection, ALIGNMENT_FULL, radius, 4);
+    float* fast = pairwise_cost_matrix(collection, ALIGNMENT_FAST, radius, 0);
+    size_t expected_index = 0;
+    for (size_t i = 0; i < n; i++) {
+        assert_true(pairwise_cost_get(full, n, i, i) == 0.0f);
+        for (size_t j = i + 1; j < n; j++) {
+            // Pairs are packed row by row.
+            assert_int_equal(pairwise_cost_index(n, i, j), expected_index);
+            assert_int_equal(pairwise_cost_index(n, j, i), expected_index);
+            expected_index++;
+            const warp_summary_t* fast_summary = fast_warp_summary_create(collection->data[i], collection->data[j], radius);
+            assert_true(pairwise_cost_get(full, n, i, j) == full_dtw_cost(collection->data[i], collection->data[j]));
+            assert_true(pairwise_cost_get(full, n, j, i) == pairwise_cost_get(full, n, i, j));
+            assert_true(pairwise_cost_get(fast, n, i, j) == fast_summary->cost);
+            warp_summary_destroy(fast_summary);
+        }
+    }
+    free(full);
+    free(fast);
+    stream_collection_destroy(collection);
+}
+
+void medoid_consensus_test() {
+    // Parallel lines at longitudes 0, 1, 2 and 9. DTW costs are squared distances, so the line at 2 has the smallest
+    // total cost (3 * (4 + 1 + 49) = 162, against 198 for the line at 1): being nearest the outlier matters more than
+    // being central among the other three.
+    stream_collection_t* collection = stream_collection_create(4);
+    collection->data[0] = stream_create_from_list(3, 0.0, 0.0, 1.0, 0.0, 2.0, 0.0);
+    collection->data[1] = stream_create_from_list(3, 0.0, 1.0, 1.0, 1.0, 2.0, 1.0);
+    collection->data[2] = stream_create_from_list(3, 0.0, 2.0, 1.0, 2.0, 2.0, 2.0);
+    collection->data[3] = stream_create_from_list(3, 0.0, 9.0, 1.0, 9.0, 2.0, 9.0);
+    assert_int_equal(medoid_consensus(collection, 0), 2);
+    assert_int_equal(medoid_consensus(collection, 1), 2);
+    stream_collection_destroy(collection);
+}
+
+void dba_consensus_test() {
+    // Two parallel lines of equal length align point-to-point, so the barycenter is the line halfway between them.
+    const size_t n = 50;
+    stream_collection_t* collection = stream_collection_create(2);
+    collection->data[0] = stream_create(n);
+    collection->data[1] = stream_create(n);
+    for (size_t i = 0; i < n; i++) {
+        collection->data[0]->data[2*i] = collection->data[1]->data[2*i] = (float) i;
+        collection->data[0]->data[2*i+1] = 0.0f;
+        collection->data[1]->data[2*i+1] = 2.0f;
+    }
+    for (int approximate = 0; approximate <= 1; approximate++) {
+        stream_t* consensus = dba_consensus(collection, approximate, 3);
+        assert_int_equal(consensus->n, n);
+        for (size_t i = 0; i < n; i++) {
+            assert_true(consensus->data[2*i] == (float) i);
+            assert_true(consensus->data[2*i+1] == 1.0f);
+        }
+        stream_destroy(consensus);
+    }
+    stream_collection_destroy(collection);
+
+    // With zero iterations, the consensus is a copy of the first stream.
+    collection = stream_collection_create(1);
+    collection->data[0] = stream_create_from_list(3, 1.0, 2.0, 3.0, 4.0, 5.0, 6.0);
+    stream_t* consensus = dba_consensus(collection, 0, 0);
+    for (size_t i = 0; i < 6; i++) {
+        assert_true(consensus->data[i] == collection->data[0]->data[i]);
+    }
+    stream_destroy(consensus);
+    stream_collection_destroy(collection);
+}
 
 int main() {
     const struct CMUnitTest tests[] = {
             cmocka_unit_test(full_align_test_small),
-            //cmocka_unit_test(fast_align_test_small),
+            cmocka_unit_test(fast_align_test_small),
+            cmocka_unit_test(fast_align_test_full_window),
+            cmocka_unit_test(full_cost_matches_full_align_test),
+            cmocka_unit_test(linear_space_align_test),
+            cmocka_unit_test(bounded_cost_test),
+            cmocka_unit_test(windowed_align_test),
+            cmocka_unit_test(similarity_cascade_test),
+            cmocka_unit_test(similarity_matches_reference_test),
+            cmocka_unit_test(similarity_batch_test),
+            cmocka_unit_test(workspace_variants_test),
+            cmocka_unit_test(subsequence_dtw_test),
+            cmocka_unit_test(dtw_stream_test),
+            cmocka_unit_test(pairwise_cost_matrix_test),
+            cmocka_unit_test(medoid_consensus_test),
+            cmocka_unit_test(dba_consensus_test),
     };
     return cmocka_run_group_tests(tests, NULL, NULL);
 }
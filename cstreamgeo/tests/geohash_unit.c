@@ -0,0 +1,160 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <cstreamgeo/cstreamgeo.h>
+#include <cstreamgeo/geohash.h>
+
+#include "test.h"
+
+// Textbook geohash: bisect each interval one bit at a time, alternating longitude and latitude.
+void reference_geohash(const float lat, const float lng, const size_t precision, char* out) {
+    const char* alphabet = "0123456789bcdefghjkmnpqrstuvwxyz";
+    double lat_lo = -90.0, lat_hi = 90.0, lng_lo = -180.0, lng_hi = 180.0;
+    int even = 1;
+    for (size_t c = 0; c < precision; c++) {
+        int digit = 0;
+        for (int b = 0; b < 5; b++) {
+            double* lo = even ? &lng_lo : &lat_lo;
+            double* hi = even ? &lng_hi : &lat_hi;
+            const double x = even ? lng : lat;
+            const double mid = (*lo + *hi) / 2;
+            digit <<= 1;
+            if (x >= mid) {
+                digit |= 1;
+                *lo = mid;
+            } else {
+                *hi = mid;
+            }
+            even = !even;
+        }
+        out[c] = alphabet[digit];
+    }
+    out[precision] = '\0';
+}
+
+void geohash_known_values_test() {
+    char text[GEOHASH_MAX_PRECISION + 1];
+    // "u4pruydqqvj" at full precision, but a float cannot resolve the last two characters.
+    geohash_to_string(geohash_encode(57.64911f, 10.40744f, 9), 9, text);
+    assert_string_equal(text, "u4pruydqq");
+    geohash_to_string(geohash_encode(42.6f, -5.6f, 5), 5, text);
+    assert_string_equal(text, "ezs42");
+    // -1e-30 + 90 rounds to exactly 90, but the point is still south of the equator.
+    geohash_to_string(geohash_encode(-1e-30f, 10.0f, 5), 5, text);
+    assert_string_equal(text, "kpzpg");
+    geohash_to_string(geohash_encode(1e-30f, 10.0f, 5), 5, text);
+    assert_string_equal(text, "s0p05");
+
+    uint64_t hash;
+    assert_true(geohash_from_string("ezs42", 5, &hash));
+    float lat, lng;
+    geohash_decode(hash, 5, &lat, &lng);
+    assert_true(fabsf(lat - 42.605f) < 0.01f);
+    assert_true(fabsf(lng - -5.603f) < 0.01f);
+    // Decoding gives the cell center, which encodes back to the same cell.
+    assert_int_equal(geohash_encode(lat, lng, 5), hash);
+
+    assert_false(geohash_from_string("ezsa2", 5, &hash));  // 'a' is not in the alphabet.
+    assert_false(geohash_from_string("", 0, &hash));
+}
+
+void geohash_matches_bisection_test() {
+    srand(1);
+    char expected[GEOHASH_MAX_PRECISION + 1];
+    char actual[GEOHASH_MAX_PRECISION + 1];
+    const size_t n = 20000;
+    stream_t* stream = stream_create(n);
+    for (size_t i = 0; i < n; i++) {
+        // Mix arbitrary points with exact cell boundaries, the poles and antimeridian, tiny values whose sum with
+        // the half range rounds onto a boundary, and floats just either side of boundaries.
+        const int kind = rand() % 6;
+        const int shift = 1 + rand() % 20;
+        const float tiny = (float) (rand() % 2 ? 1 : -1) * ldexpf(1.0f, -(rand() % 140));
+        const float lat_edge = (float) (-90.0 + 180.0 * (rand() % (1 << shift)) / (1 << shift));
+        const float lng_edge = (float) (-180.0 + 360.0 * (rand() % (1 << shift)) / (1 << shift));
+        const float direction = (rand() % 2) ? INFINITY : -INFINITY;
+        stream->data[2*i] = (kind == 0) ? (float) (rand() % 3 - 1) * 90.0f :
+                            (kind == 1) ? lat_edge :
+                            (kind == 2) ? tiny :
+                            (kind == 3) ? nextafterf(lat_edge, direction) :
+                            180.0f * ((float) rand() / RAND_MAX) - 90.0f;
+        stream->data[2*i+1] = (kind == 0) ? (float) (rand() % 3 - 1) * 180.0f :
+                              (kind == 1) ? lng_edge :
+                              (kind == 2) ? -tiny :
+                              (kind == 3) ? nextafterf(lng_edge, direction) :
+                              360.0f * ((float) rand() / RAND_MAX) - 180.0f;
+    }
+    uint64_t hashes[n];
+    for (size_t precision = 1; precision <= GEOHASH_MAX_PRECISION; precision++) {
+        geohash_encode_stream(stream, precision, hashes);
+        for (size_t i = 0; i < n; i++) {
+            reference_geohash(stream->data[2*i], stream->data[2*i+1], precision, expected);
+            geohash_to_string(hashes[i], precision, actual);
+            assert_string_equal(actual, expected);
+            assert_int_equal(geohash_encode(stream->data[2*i], stream->data[2*i+1], precision), hashes[i]);
+            uint64_t parsed;
+            assert_true(geohash_from_string(actual, precision, &parsed));
+            assert_int_equal(parsed, hashes[i]);
+        }
+    }
+    stream_destroy(stream);
+}
+
+void geohash_cells_test() {
+    // Two walks that share their first half.
+    const size_t n = 500;
+    stream_t* a = stream_create(n);
+    stream_t* b = stream_create(n);
+    for (size_t i = 0; i < n; i++) {
+        a->data[2*i] = 37.0f + 1e-3f * i;
+        a->data[2*i+1] = -122.0f;
+        b->data[2*i] = (i < n / 2) ? a->data[2*i] : 37.0f;
+        b->data[2*i+1] = (i < n / 2) ? -122.0f : -122.0f - 1e-3f * i;
+    }
+    geohash_cells_t* a_cells = geohash_cells_create(a, 6);
+    geohash_cells_t* b_cells = geohash_cells_create(b, 6);
+    assert_int_equal(a_cells->precision, 6);
+    assert_true(a_cells->n > 1 && a_cells->n < n);
+    for (size_t i = 1; i < a_cells->n; i++) {
+        assert_true(a_cells->cells[i - 1] < a_cells->cells[i]);
+    }
+    for (size_t i = 0; i < n; i++) {  // Every point's cell is in the set.
+        const uint64_t hash = geohash_encode(a->data[2*i], a->data[2*i+1], 6);
+        size_t found = 0;
+        for (size_t c = 0; c < a_cells->n; c++) {
+            found |= (a_cells->cells[c] == hash);
+        }
+        assert_true(found);
+    }
+    const size_t common = geohash_cells_intersection_size(a_cells, b_cells);
+    assert_true(common > 0 && common < a_cells->n);
+    assert_int_equal(geohash_cells_intersection_size(a_cells, a_cells), a_cells->n);
+    assert_true(geohash_cells_overlap(a_cells, b_cells));
+
+    stream_t* far = stream_create(2);
+    far->data[0] = -33.9f; far->data[1] = 151.2f;
+    far->data[2] = -33.8f; far->data[3] = 151.3f;
+    geohash_cells_t* far_cells = geohash_cells_create(far, 6);
+    assert_false(geohash_cells_overlap(a_cells, far_cells));
+    assert_int_equal(geohash_cells_intersection_size(a_cells, far_cells), 0);
+
+    geohash_cells_destroy(far_cells);
+    geohash_cells_destroy(b_cells);
+    geohash_cells_destroy(a_cells);
+    stream_destroy(far);
+    stream_destroy(b);
+    stream_destroy(a);
+}
+
+int main() {
+    const struct CMUnitTest tests[] = {
+            cmocka_unit_test(geohash_known_values_test),
+            cmocka_unit_test(geohash_matches_bisection_test),
+            cmocka_unit_test(geohash_cells_test),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
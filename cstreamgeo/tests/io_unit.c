@@ -1,9 +1,13 @@
+#define _POSIX_C_SOURCE 200809L  // truncate
+
 #include <cstreamgeo/cstreamgeo.h>
 #include <cstreamgeo/io.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <math.h>
+#include <unistd.h>
 #include "test.h"
 #include "config.h" // Contains make-time generated benchmark_data_dir #define macro
 
@@ -48,10 +52,359 @@ void io_test_collection_size_many() {
 
 }
 
+void io_test_binary_mmap() {
+    const size_t sizes[4] = {3, 0, 17, 1};
+    stream_collection_t* streams = stream_collection_create(4);
+    for (size_t i = 0; i < 4; i++) {
+        streams->data[i] = stream_create(sizes[i]);
+        for (size_t k = 0; k < 2 * sizes[i]; k++) {
+            streams->data[i]->data[k] = (float) (100 * i + k) + 0.25f;
+        }
+    }
+    const char* output = "mmap.stream";
+    write_streams_to_binary(output, streams);
+
+    const stream_collection_t* mapped = stream_collection_mmap(output);
+    assert_non_null(mapped);
+    assert_int_equal(mapped->n, 4);
+    for (size_t i = 4; i-- > 0; ) {  // Random access in any order.
+        assert_int_equal(mapped->data[i]->n, sizes[i]);
+        assert_int_equal(((uintptr_t) mapped->data[i]->data) % 64, 0);
+        assert_memory_equal(mapped->data[i]->data, streams->data[i]->data, 2 * sizes[i] * sizeof(float));
+    }
+    stream_collection_munmap(mapped);
+
+    const stream_collection_t* copied = read_streams_from_binary(output);
+    assert_non_null(copied);
+    assert_int_equal(copied->n, 4);
+    for (size_t i = 0; i < 4; i++) {
+        assert_int_equal(copied->data[i]->n, sizes[i]);
+        assert_memory_equal(copied->data[i]->data, streams->data[i]->data, 2 * sizes[i] * sizeof(float));
+    }
+    stream_collection_destroy(copied);
+
+    // Legacy files are still readable, but cannot be mapped.
+    FILE* fp = fopen(output, "w");
+    fwrite(&(streams->n), sizeof(size_t), 1, fp);
+    for (size_t i = 0; i < 4; i++) {
+        fwrite(&(streams->data[i]->n), sizeof(size_t), 1, fp);
+        fwrite(streams->data[i]->data, sizeof(float), 2 * sizes[i], fp);
+    }
+    fclose(fp);
+    const stream_collection_t* legacy = read_streams_from_binary(output);
+    assert_int_equal(legacy->n, 4);
+    for (size_t i = 0; i < 4; i++) {
+        assert_int_equal(legacy->data[i]->n, sizes[i]);
+        assert_memory_equal(legacy->data[i]->data, streams->data[i]->data, 2 * sizes[i] * sizeof(float));
+    }
+    stream_collection_destroy(legacy);
+    assert_null(stream_collection_mmap(output));
+
+    // A truncated versioned file is rejected rather than read out of bounds.
+    write_streams_to_binary(output, streams);
+    assert_int_equal(truncate(output, 200), 0);
+    assert_null(stream_collection_mmap(output));
+    assert_null(read_streams_from_binary(output));
+
+    remove(output);
+    stream_collection_destroy(streams);
+}
+
+void io_test_json_numbers_match_strtof() {
+    // Random fixed-precision decimals, as in our data, plus forms that exercise the strtof fallback.
+    srand(4);
+    char text[160];
+    char number[64];
+    for (size_t trial = 0; trial < 200000; trial++) {
+        const int decimals = rand() % 10;
+        const long whole = rand() % 200 - 100;
+        const long fraction = ((long) rand() << 16 ^ rand()) % 1000000000L;
+        snprintf(number, sizeof(number), "%s%ld.%0*ld", (whole == 0 && rand() % 2) ? "-" : "", whole,
+                 decimals + 1, fraction % (long) pow(10, decimals + 1));
+        snprintf(text, sizeof(text), "[[%s,%s]]", number, number);
+        stream_t* stream = parse_stream_from_json(text, strlen(text), NULL);
+        assert_non_null(stream);
+        assert_int_equal(stream->n, 1);
+        assert_true(stream->data[0] == strtof(number, NULL));
+        stream_destroy(stream);
+    }
+    // The last three are longer than the fallback's stack buffer: zero padded, with an exponent, and many digits.
+    char padded[200] = "-0.";
+    char exponent[200] = "1.5";
+    char digits[200] = "3.";
+    for (size_t i = 0; i < 150; i++) {
+        strcat(padded, "0");
+        strcat(exponent, "0");
+        strcat(digits, (i % 10 == 3) ? "7" : "1");
+    }
+    strcat(padded, "123");
+    strcat(exponent, "e-3");
+    const char* unusual[9] = {"1e3", "-2.5E-3", "0", "-0.0", "12345678901234567890.5", "3.4028235e38",
+                              padded, exponent, digits};
+    char long_text[256];
+    for (size_t i = 0; i < 9; i++) {
+        snprintf(long_text, sizeof(long_text), "[ [ %s , 1 ] ]\n", unusual[i]);
+        stream_t* stream = parse_stream_from_json(long_text, strlen(long_text), NULL);
+        assert_non_null(stream);
+        assert_true(stream->data[0] == strtof(unusual[i], NULL));
+        stream_destroy(stream);
+    }
+}
+
+void io_test_json_errors() {
+    const char* inputs[7] = {"[[1,2],[3,4]", "[[1,2] [3,4]]", "[[1;2]]", "[[1,2]]x", "[\n  [1,.5]]", "[[1.,2]]", "[[1,2],]"};
+    const size_t lines[7] = {1, 1, 1, 1, 2, 1, 1};
+    const size_t columns[7] = {13, 8, 4, 8, 6, 5, 8};
+    json_error_t error;
+    for (size_t i = 0; i < 7; i++) {
+        assert_null(parse_stream_from_json(inputs[i], strlen(inputs[i]), &error));
+        assert_int_equal(error.line, lines[i]);
+        assert_int_equal(error.column, columns[i]);
+        assert_non_null(error.message);
+    }
+    stream_t* empty = parse_stream_from_json(" [ ] ", 5, &error);
+    assert_int_equal(empty->n, 0);
+    stream_destroy(empty);
+
+    const char* output = "malformed.json";
+    FILE* fp = fopen(output, "w");
+    fputs("[[1,2],[3,4]]\n\n  [[5, 6]]  \n[[7,8]] [[9,10]]\n", fp);
+    fclose(fp);
+    assert_null(read_streams_from_json(output));
+    fp = fopen(output, "w");
+    fputs("[[1,2],[3,4]]\n\n  [[5, 6]]  \n", fp);
+    fclose(fp);
+    const stream_collection_t* streams = read_streams_from_json(output);
+    assert_int_equal(streams->n, 2);
+    assert_int_equal(streams->data[0]->n, 2);
+    assert_true(streams->data[0]->data[3] == 4.0f);
+    assert_int_equal(streams->data[1]->n, 1);
+    assert_true(streams->data[1]->data[1] == 6.0f);
+    stream_collection_destroy(streams);
+    remove(output);
+}
+
+void io_test_json_parallel() {
+    // Several megabytes, so the file is split into many chunks, with line lengths varying by orders of magnitude.
+    srand(5);
+    const char* output = "parallel.json";
+    const size_t n_lines = 3000;
+    FILE* fp = fopen(output, "w");
+    for (size_t line = 0; line < n_lines; line++) {
+        const size_t n = (line % 100 == 0) ? 5000 : 1 + (size_t) rand() % 100;
+        fputc('[', fp);
+        for (size_t i = 0; i < n; i++) {
+            fprintf(fp, "%s[%zu.%06d,-%zu.%06d]", i ? "," : "", line, rand() % 1000000, i, rand() % 1000000);
+        }
+        fputs((line % 7 == 0) ? "]\n\n" : "]\n", fp);
+    }
+    fclose(fp);
+    const stream_collection_t* serial = read_streams_from_json(output);
+    assert_non_null(serial);
+    assert_int_equal(serial->n, n_lines);
+    const size_t threads[3] = {2, 7, 0};
+    for (size_t t = 0; t < 3; t++) {
+        const stream_collection_t* parallel = read_streams_from_json_parallel(output, threads[t]);
+        assert_non_null(parallel);
+        assert_int_equal(parallel->n, n_lines);
+        for (size_t i = 0; i < n_lines; i++) {
+            assert_int_equal(parallel->data[i]->n, serial->data[i]->n);
+            assert_int_equal((size_t) parallel->data[i]->data[0], i);  // Line order is preserved.
+            assert_memory_equal(parallel->data[i]->data, serial->data[i]->data, 2 * serial->data[i]->n * sizeof(float));
+        }
+        stream_collection_destroy(parallel);
+    }
+    stream_collection_destroy(serial);
+
+    // A malformed line near the end is still rejected.
+    fp = fopen(output, "a");
+    fputs("[[1,2]\n", fp);
+    fclose(fp);
+    assert_null(read_streams_from_json_parallel(output, 4));
+    remove(output);
+}
+
+void assert_collections_equal(const stream_collection_t* a, const stream_collection_t* b) {
+    assert_non_null(a);
+    assert_non_null(b);
+    assert_int_equal(a->n, b->n);
+    for (size_t i = 0; i < a->n; i++) {
+        assert_int_equal(a->data[i]->n, b->data[i]->n);
+        assert_memory_equal(a->data[i]->data, b->data[i]->data, 2 * a->data[i]->n * sizeof(float));
+    }
+}
+
+#ifdef STREAMGEO_HAVE_ZLIB
+#include <zlib.h>
+
+// Compresses `input` into `output`, split into two gzip members to check that concatenated members are read too.
+void gzip_file(const char* input, const char* output) {
+    FILE* in = fopen(input, "rb");
+    fseek(in, 0, SEEK_END);
+    const size_t length = (size_t) ftell(in);
+    rewind(in);
+    char* buffer = malloc(length + 1);
+    assert_int_equal(fread(buffer, 1, length, in), length);
+    fclose(in);
+    gzFile gz = gzopen(output, "wb");
+    gzwrite(gz, buffer, (unsigned) (length / 2));
+    gzclose(gz);
+    gz = gzopen(output, "ab");
+    gzwrite(gz, buffer + length / 2, (unsigned) (length - length / 2));
+    gzclose(gz);
+    free(buffer);
+}
+
+void io_test_gzip_input() {
+    char filename[1024];
+    snprintf(filename, sizeof(filename), "%sactivities/615703770.json.gz", BENCHMARK_DATA_DIR);
+    const stream_collection_t* activity = read_streams_from_json(filename);
+    assert_non_null(activity);
+    assert_int_equal(activity->n, 1);
+    assert_true(activity->data[0]->n > 1000);
+    assert_true(activity->data[0]->data[0] == 37.773812f);
+    stream_collection_destroy(activity);
+
+    // Several decompressed blocks, including one line longer than the parse buffer.
+    srand(6);
+    const char* plain = "compressed.json";
+    const char* compressed = "compressed.json.gz";
+    FILE* fp = fopen(plain, "w");
+    for (size_t line = 0; line < 400; line++) {
+        const size_t n = (line == 200) ? 250000 : 1 + (size_t) rand() % 1000;
+        fputc('[', fp);
+        for (size_t i = 0; i < n; i++) {
+            fprintf(fp, "%s[%d.%06d,-%d.%06d]", i ? "," : "", rand() % 90, rand() % 1000000, rand() % 180, rand() % 1000000);
+        }
+        fputs("]\n", fp);
+    }
+    fclose(fp);
+    gzip_file(plain, compressed);
+    const stream_collection_t* expected = read_streams_from_json(plain);
+    const stream_collection_t* streams = read_streams_from_json_parallel(compressed, 4);
+    assert_collections_equal(streams, expected);
+    stream_collection_destroy(streams);
+    assert_int_equal(truncate(compressed, 100000), 0);
+    assert_null(read_streams_from_json(compressed));
+
+    // Both binary formats, compressed.
+    write_streams_to_binary(plain, expected);
+    gzip_file(plain, compressed);
+    streams = read_streams_from_binary(compressed);
+    assert_collections_equal(streams, expected);
+    stream_collection_destroy(streams);
+    fp = fopen(plain, "w");
+    fwrite(&(expected->n), sizeof(size_t), 1, fp);
+    for (size_t i = 0; i < expected->n; i++) {
+        fwrite(&(expected->data[i]->n), sizeof(size_t), 1, fp);
+        fwrite(expected->data[i]->data, sizeof(float), 2 * expected->data[i]->n, fp);
+    }
+    fclose(fp);
+    gzip_file(plain, compressed);
+    streams = read_streams_from_binary(compressed);
+    assert_collections_equal(streams, expected);
+    stream_collection_destroy(streams);
+
+    assert_int_equal(truncate(compressed, 100000), 0);
+    assert_null(read_streams_from_binary(compressed));
+
+    stream_collection_destroy(expected);
+    remove(plain);
+    remove(compressed);
+}
+#else
+void io_test_gzip_input() {
+    char filename[1024];
+    snprintf(filename, sizeof(filename), "%sactivities/615703770.json.gz", BENCHMARK_DATA_DIR);
+    assert_null(read_streams_from_json(filename));  // Built without zlib: refused rather than parsed as text.
+}
+#endif
+
+#ifdef STREAMGEO_HAVE_ZSTD
+#include <zstd.h>
+
+// Compresses `input` into `output`, split into two zstd frames to check that concatenated frames are read too.
+void zstd_file(const char* input, const char* output) {
+    FILE* in = fopen(input, "rb");
+    fseek(in, 0, SEEK_END);
+    const size_t length = (size_t) ftell(in);
+    rewind(in);
+    char* buffer = malloc(length + 1);
+    assert_int_equal(fread(buffer, 1, length, in), length);
+    fclose(in);
+    const size_t halves[2] = {length / 2, length - length / 2};
+    char* frame = malloc(ZSTD_compressBound(length));
+    FILE* out = fopen(output, "wb");
+    for (size_t h = 0; h < 2; h++) {
+        const size_t size = ZSTD_compress(frame, ZSTD_compressBound(length), buffer + h * halves[0], halves[h], 3);
+        assert_false(ZSTD_isError(size));
+        fwrite(frame, 1, size, out);
+    }
+    fclose(out);
+    free(frame);
+    free(buffer);
+}
+
+void io_test_zstd_input() {
+    // Decompressed sizes just either side of multiples of the reader's 1 MB blocks, so that the output of the last
+    // zstd block straddles a block boundary and has to be flushed after the input runs out.
+    const size_t targets[5] = {5000, (1 << 20) - 3000, (1 << 20) + 3000, (1 << 20) + 60000, (2 << 20) + 100};
+    const char* plain = "compressed.json";
+    const char* compressed = "compressed.json.zst";
+    srand(7);
+    for (size_t t = 0; t < 5; t++) {
+        FILE* fp = fopen(plain, "w");
+        size_t written = 0;
+        while (written < targets[t]) {
+            const size_t n = 1 + (size_t) rand() % 200;
+            written += (size_t) fprintf(fp, "[");
+            for (size_t i = 0; i < n; i++) {
+                written += (size_t) fprintf(fp, "%s[%d.%06d,-%d.%06d]", i ? "," : "", rand() % 90, rand() % 1000000,
+                                            rand() % 180, rand() % 1000000);
+            }
+            written += (size_t) fprintf(fp, "]\n");
+        }
+        fclose(fp);
+        zstd_file(plain, compressed);
+        const stream_collection_t* expected = read_streams_from_json(plain);
+        const stream_collection_t* streams = read_streams_from_json_parallel(compressed, 4);
+        assert_collections_equal(streams, expected);
+        stream_collection_destroy(streams);
+
+        write_streams_to_binary(plain, expected);
+        zstd_file(plain, compressed);
+        streams = read_streams_from_binary(compressed);
+        assert_collections_equal(streams, expected);
+        stream_collection_destroy(streams);
+        stream_collection_destroy(expected);
+    }
+    assert_int_equal(truncate(compressed, 3000), 0);
+    assert_null(read_streams_from_binary(compressed));
+    remove(plain);
+    remove(compressed);
+}
+#else
+void io_test_zstd_input() {
+    const char* compressed = "compressed.json.zst";
+    FILE* fp = fopen(compressed, "wb");
+    const unsigned char magic[8] = {0x28, 0xb5, 0x2f, 0xfd, 0, 0, 0, 0};
+    fwrite(magic, 1, sizeof(magic), fp);
+    fclose(fp);
+    assert_null(read_streams_from_json(compressed));  // Built without zstd: refused rather than parsed as text.
+    remove(compressed);
+}
+#endif
+
 int main() {
     const struct CMUnitTest tests[] = {
             cmocka_unit_test(io_test_collection_size_one),
             cmocka_unit_test(io_test_collection_size_many),
+            cmocka_unit_test(io_test_binary_mmap),
+            cmocka_unit_test(io_test_json_numbers_match_strtof),
+            cmocka_unit_test(io_test_json_errors),
+            cmocka_unit_test(io_test_json_parallel),
+            cmocka_unit_test(io_test_gzip_input),
+            cmocka_unit_test(io_test_zstd_input),
     };
 
     return cmocka_run_group_tests(tests, NULL, NULL);
@@ -0,0 +1,110 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include <cstreamgeo/cstreamgeo.h>
+#include <cstreamgeo/lowerbound.h>
+
+#include "test.h"
+
+void bounding_box_test() {
+    const stream_t* stream = stream_create_from_list(4, 1.0, 2.0, -3.0, 5.0, 4.0, -1.0, 0.0, 0.0);
+    const bounding_box_t box = stream_bounding_box(stream);
+    assert_true(box.min_lat == -3.0f);
+    assert_true(box.max_lat == 4.0f);
+    assert_true(box.min_lng == -1.0f);
+    assert_true(box.max_lng == 5.0f);
+    stream_destroy(stream);
+
+    // Boxes [0, 1]x[0, 1] and [4, 5]x[5, 6] are 3 apart in lat and 4 apart in lng.
+    const bounding_box_t a = {0.0f, 1.0f, 0.0f, 1.0f};
+    const bounding_box_t b = {4.0f, 5.0f, 5.0f, 6.0f};
+    assert_true(lb_bounding_box(&a, &b) == 5.0f);
+    assert_true(lb_bounding_box(&b, &a) == 5.0f);
+    assert_true(lb_bounding_box(&a, &a) == 0.0f);
+}
+
+void envelope_matches_brute_force_test() {
+    const size_t n = 50;
+    stream_t* stream = stream_create(n);
+    srand(3);
+    for (size_t i = 0; i < 2*n; i++) stream->data[i] = (float) rand() / RAND_MAX;
+    const size_t windows[4] = {0, 1, 7, 60};
+    for (size_t w = 0; w < 4; w++) {
+        const size_t window = windows[w];
+        const stream_envelope_t* envelope = stream_envelope_create(stream, window);
+        assert_int_equal(envelope->n, n);
+        for (size_t i = 0; i < n; i++) {
+            const size_t lo = (i > window) ? i - window : 0;
+            const size_t hi = (i + window < n) ? i + window : n - 1;
+            for (size_t c = 0; c < 2; c++) {
+                float lower = stream->data[2*lo + c];
+                float upper = stream->data[2*lo + c];
+                for (size_t k = lo; k <= hi; k++) {
+                    lower = fminf(lower, stream->data[2*k + c]);
+                    upper = fmaxf(upper, stream->data[2*k + c]);
+                }
+                assert_true(envelope->lower[2*i + c] == lower);
+                assert_true(envelope->upper[2*i + c] == upper);
+            }
+        }
+        stream_envelope_destroy(envelope);
+    }
+    stream_destroy(stream);
+}
+
+void lb_kim_test() {
+    // Same path in opposite directions: boxes coincide, but the endpoints are 10 apart.
+    const stream_t* a = stream_create_from_list(3, 0.0, 0.0, 5.0, 0.0, 10.0, 0.0);
+    const stream_t* b = stream_create_from_list(3, 10.0, 0.0, 5.0, 0.0, 0.0, 0.0);
+    bounding_box_t a_box = stream_bounding_box(a);
+    bounding_box_t b_box = stream_bounding_box(b);
+    assert_true(lb_bounding_box(&a_box, &b_box) == 0.0f);
+    assert_true(lb_kim(a, &a_box, b, &b_box) == 10.0f);
+    assert_true(lb_kim(a, &a_box, a, &a_box) == 0.0f);
+    stream_destroy(b);
+
+    // Same endpoints, but `c` bulges 3 further in longitude.
+    const stream_t* c = stream_create_from_list(3, 0.0, 0.0, 5.0, 3.0, 10.0, 0.0);
+    const bounding_box_t c_box = stream_bounding_box(c);
+    assert_true(lb_kim(a, &a_box, c, &c_box) == 3.0f);
+    stream_destroy(a);
+    stream_destroy(c);
+}
+
+void lb_keogh_test() {
+    // A straight line, and the same line with a 2-degree excursion at index 5.
+    const size_t n = 11;
+    stream_t* a = stream_create(n);
+    stream_t* b = stream_create(n);
+    for (size_t i = 0; i < n; i++) {
+        a->data[2*i] = b->data[2*i] = (float) i;
+        a->data[2*i+1] = b->data[2*i+1] = 0.0f;
+    }
+    b->data[2*5+1] = 2.0f;
+    const stream_envelope_t* envelope = stream_envelope_create(a, 2);
+    assert_true(lb_keogh(envelope, a) == 0.0f);
+    assert_true(lb_keogh(envelope, b) == 2.0f);
+    stream_envelope_destroy(envelope);
+
+    // Candidates of a different length are mapped onto the query's index range.
+    const stream_t* c = stream_create_from_list(3, 0.0, 0.0, 5.0, 0.0, 10.0, 0.0);
+    const stream_envelope_t* b_envelope = stream_envelope_create(b, 0);
+    assert_true(lb_keogh(b_envelope, c) == 2.0f);
+    stream_envelope_destroy(b_envelope);
+    stream_destroy(a);
+    stream_destroy(b);
+    stream_destroy(c);
+}
+
+int main() {
+    const struct CMUnitTest tests[] = {
+            cmocka_unit_test(bounding_box_test),
+            cmocka_unit_test(envelope_matches_brute_force_test),
+            cmocka_unit_test(lb_kim_test),
+            cmocka_unit_test(lb_keogh_test),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
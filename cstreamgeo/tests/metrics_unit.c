@@ -0,0 +1,148 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include <cstreamgeo/cstreamgeo.h>
+
+#include "test.h"
+
+float brute_force_directed_hausdorff(const stream_t* a, const stream_t* b) {
+    float cmax = 0.0f;
+    for (size_t i = 0; i < a->n; i++) {
+        float cmin = INFINITY;
+        for (size_t j = 0; j < b->n; j++) {
+            const float lat_diff = b->data[2*j] - a->data[2*i];
+            const float lng_diff = b->data[2*j+1] - a->data[2*i+1];
+            cmin = fminf(cmin, (lng_diff * lng_diff) + (lat_diff * lat_diff));
+        }
+        cmax = fmaxf(cmax, cmin);
+    }
+    return sqrtf(cmax);
+}
+
+void hausdorff_matches_brute_force_test() {
+    srand(1);
+    const size_t sizes[6][2] = {{1, 1}, {1, 40}, {40, 1}, {17, 300}, {500, 500}, {2000, 150}};
+    for (size_t s = 0; s < 6; s++) {
+        for (size_t shape = 0; shape < 3; shape++) {
+            // Ordinary walks, a walk along a single parallel (degenerate grid), and one with an outlier.
+            stream_t* a = random_walk(sizes[s][0], 37.0, -122.0, 1e-3, 1e-3, -1);
+            stream_t* b = random_walk(sizes[s][1], 37.0, -122.0, (shape == 1) ? 0.0 : 1e-3, 1e-3, -1);
+            if (shape == 2) {
+                a->data[a->n] += 0.5f;
+            }
+            const float ab = brute_force_directed_hausdorff(a, b);
+            const float ba = brute_force_directed_hausdorff(b, a);
+            assert_true(directed_hausdorff_distance(a, b) == ab);
+            assert_true(directed_hausdorff_distance(b, a) == ba);
+            assert_true(hausdorff_distance(a, b) == fmaxf(ab, ba));
+            assert_true(hausdorff_distance(b, a) == fmaxf(ab, ba));
+            stream_destroy(b);
+            stream_destroy(a);
+        }
+    }
+}
+
+void hausdorff_edge_cases_test() {
+    stream_t* empty = stream_create(0);
+    stream_t* point = stream_create_from_list(1, 1.0f, 2.0f);
+    stream_t* far = stream_create_from_list(2, 4.0f, 6.0f, 4.0f, 6.0f);
+    assert_true(directed_hausdorff_distance(empty, point) == 0.0f);
+    assert_true(isinf(directed_hausdorff_distance(point, empty)));
+    assert_true(directed_hausdorff_distance(point, point) == 0.0f);
+    assert_true(hausdorff_distance(point, far) == 5.0f);
+    stream_destroy(far);
+    stream_destroy(point);
+    stream_destroy(empty);
+}
+
+// Full-table discrete Frechet over the cells allowed by `window` (all cells if NULL).
+float brute_force_frechet(const stream_t* a, const stream_t* b, const strided_mask_t* window) {
+    float* table = malloc(a->n * b->n * sizeof(float));
+    for (size_t i = 0; i < a->n; i++) {
+        for (size_t j = 0; j < b->n; j++) {
+            const float lat_diff = b->data[2*j] - a->data[2*i];
+            const float lng_diff = b->data[2*j+1] - a->data[2*i+1];
+            const float d = (lng_diff * lng_diff) + (lat_diff * lat_diff);
+            float best = (i == 0 && j == 0) ? 0.0f : INFINITY;
+            if (i > 0) best = fminf(best, table[(i-1)*b->n + j]);
+            if (j > 0) best = fminf(best, table[i*b->n + j-1]);
+            if (i > 0 && j > 0) best = fminf(best, table[(i-1)*b->n + j-1]);
+            const int allowed = !window || (j >= window->start_cols[i] && j <= window->end_cols[i]);
+            table[i*b->n + j] = allowed ? fmaxf(d, best) : INFINITY;
+        }
+    }
+    const float result = sqrtf(table[a->n * b->n - 1]);
+    free(table);
+    return result;
+}
+
+void frechet_matches_brute_force_test() {
+    srand(2);
+    const size_t sizes[5][2] = {{1, 1}, {1, 40}, {40, 1}, {17, 300}, {400, 350}};
+    for (size_t s = 0; s < 5; s++) {
+        stream_t* a = random_walk(sizes[s][0], 37.0, -122.0, 1e-3, 1e-3, -1);
+        stream_t* b = random_walk(sizes[s][1], 37.0, -122.0, 1e-3, 1e-3, -1);
+        const float expected = brute_force_frechet(a, b, NULL);
+        assert_true(discrete_frechet_distance(a, b) == expected);
+        assert_true(discrete_frechet_distance(b, a) == expected);
+        assert_true(discrete_frechet_distance(a, b) >= hausdorff_distance(a, b));
+        assert_true(frechet_within(a, b, expected * 1.001f));
+        assert_true(frechet_within(b, a, expected * 1.001f));
+        if (expected > 0.0f) {
+            assert_false(frechet_within(a, b, expected * 0.999f));
+            assert_false(frechet_within(b, a, expected * 0.999f));
+        }
+        stream_destroy(b);
+        stream_destroy(a);
+    }
+}
+
+void frechet_within_windowed_test() {
+    srand(3);
+    stream_t* a = random_walk(300, 37.0, -122.0, 1e-3, 1e-3, -1);
+    stream_t* b = random_walk(260, 37.0, -122.0, 1e-3, 1e-3, -1);
+    const size_t bands[4] = {0, 3, 20, 300};
+    for (size_t k = 0; k < 4; k++) {
+        strided_mask_t* window = strided_mask_create_sakoe_chiba(a->n, b->n, bands[k]);
+        const float expected = brute_force_frechet(a, b, window);
+        assert_true(expected >= discrete_frechet_distance(a, b));
+        assert_true(frechet_within_windowed(a, b, window, expected * 1.001f));
+        assert_false(frechet_within_windowed(a, b, window, expected * 0.999f));
+        strided_mask_destroy(window);
+    }
+    stream_destroy(b);
+    stream_destroy(a);
+}
+
+void frechet_edge_cases_test() {
+    stream_t* empty = stream_create(0);
+    stream_t* point = stream_create_from_list(1, 1.0f, 2.0f);
+    stream_t* segment = stream_create_from_list(2, 1.0f, 2.0f, 4.0f, 6.0f);
+    stream_t* reversed = stream_create_from_list(2, 4.0f, 6.0f, 1.0f, 2.0f);
+    assert_true(isinf(discrete_frechet_distance(empty, point)));
+    assert_false(frechet_within(point, empty, 1e9f));
+    assert_true(discrete_frechet_distance(point, segment) == 5.0f);
+    // Same points, opposite direction: Hausdorff is 0 but Frechet must pair the far ends.
+    assert_true(hausdorff_distance(segment, reversed) == 0.0f);
+    assert_true(discrete_frechet_distance(segment, reversed) == 5.0f);
+    assert_true(frechet_within(segment, reversed, 5.0f));
+    assert_false(frechet_within(segment, reversed, 4.9f));
+    stream_destroy(reversed);
+    stream_destroy(segment);
+    stream_destroy(point);
+    stream_destroy(empty);
+}
+
+int main() {
+    const struct CMUnitTest tests[] = {
+            cmocka_unit_test(hausdorff_matches_brute_force_test),
+            cmocka_unit_test(hausdorff_edge_cases_test),
+            cmocka_unit_test(frechet_matches_brute_force_test),
+            cmocka_unit_test(frechet_within_windowed_test),
+            cmocka_unit_test(frechet_edge_cases_test),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,53 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdatomic.h>
+
+#include <cstreamgeo/parallel.h>
+
+#include "test.h"
+
+typedef struct {
+    atomic_int* visits;
+    size_t nthreads;
+    atomic_int bad_thread_ids;
+} visit_context_t;
+
+void visit_task(void* context, const size_t index, const size_t thread_id) {
+    visit_context_t* ctx = context;
+    atomic_fetch_add(&ctx->visits[index], 1);
+    if (thread_id >= ctx->nthreads) atomic_fetch_add(&ctx->bad_thread_ids, 1);
+    // Uneven task costs, so that threads finish their own blocks at different times and steal.
+    volatile size_t spin = 0;
+    for (size_t i = 0; i < (index % 7) * 1000; i++) spin += i;
+}
+
+void parallel_for_visits_each_index_once_test() {
+    const size_t sizes[4] = {0, 1, 5, 1000};
+    const size_t threads[4] = {0, 1, 3, 16};
+    for (size_t s = 0; s < 4; s++) {
+        for (size_t t = 0; t < 4; t++) {
+            const size_t n = sizes[s];
+            visit_context_t ctx;
+            ctx.visits = calloc(n + 1, sizeof(atomic_int));
+            ctx.nthreads = parallel_thread_count(n, threads[t]);
+            atomic_init(&ctx.bad_thread_ids, 0);
+            const size_t used = parallel_for(n, threads[t], visit_task, &ctx);
+            assert_int_equal(used, ctx.nthreads);
+            assert_true(used >= 1 && (n == 0 || used <= n));
+            for (size_t i = 0; i < n; i++) {
+                assert_int_equal(atomic_load(&ctx.visits[i]), 1);
+            }
+            assert_int_equal(atomic_load(&ctx.bad_thread_ids), 0);
+            free(ctx.visits);
+        }
+    }
+}
+
+int main() {
+    const struct CMUnitTest tests[] = {
+            cmocka_unit_test(parallel_for_visits_each_index_once_test),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
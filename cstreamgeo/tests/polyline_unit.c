@@ -0,0 +1,125 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <cstreamgeo/cstreamgeo.h>
+#include <cstreamgeo/io.h>
+#include <cstreamgeo/polyline.h>
+
+#include "test.h"
+
+void polyline_reference_test() {
+    // The worked example from Google's documentation.
+    const char* encoded = "_p~iF~ps|U_ulLnnqC_mqNvxq`@";
+    const float expected[6] = {38.5f, -120.2f, 40.7f, -120.95f, 43.252f, -126.453f};
+    stream_t* stream = stream_from_polyline(encoded, strlen(encoded));
+    assert_non_null(stream);
+    assert_int_equal(stream->n, 3);
+    for (size_t i = 0; i < 6; i++) {
+        assert_true(stream->data[i] == expected[i]);
+    }
+    char* polyline = stream_to_polyline(stream);
+    assert_string_equal(polyline, encoded);
+    free(polyline);
+    stream_destroy(stream);
+
+    stream_t* empty = stream_from_polyline("", 0);
+    assert_int_equal(empty->n, 0);
+    polyline = stream_to_polyline(empty);
+    assert_string_equal(polyline, "");
+    free(polyline);
+    stream_destroy(empty);
+}
+
+void polyline_round_trip_test() {
+    srand(1);
+    const size_t sizes[5] = {1, 2, 31, 32, 5000};
+    for (size_t s = 0; s < 5; s++) {
+        stream_t* stream = random_walk(sizes[s], 37.0, -122.0, 0.02, 0.02, 5);
+        char* polyline = stream_to_polyline(stream);
+        stream_t* decoded = stream_from_polyline(polyline, strlen(polyline));
+        assert_non_null(decoded);
+        assert_int_equal(decoded->n, stream->n);
+        assert_memory_equal(decoded->data, stream->data, 2 * stream->n * sizeof(float));
+        stream_destroy(decoded);
+        free(polyline);
+        stream_destroy(stream);
+    }
+}
+
+void polyline_malformed_test() {
+    const char* inputs[5] = {
+            "_p~iF~ps|U_ulLnnqC_mqNvxq",   // Last value unterminated.
+            "_p~iF~ps|U_ulL",              // Odd number of values.
+            "_p~iF ~ps|U",                 // Character below '?'.
+            "_p~iF~ps|U\x7f?",             // Character above '~'.
+            "~~~~~~~?_p~iF",               // Value longer than 32 bits.
+    };
+    for (size_t i = 0; i < 5; i++) {
+        assert_null(stream_from_polyline(inputs[i], strlen(inputs[i])));
+    }
+}
+
+void polyline_unencodable_test() {
+    // Coordinates a decoder cannot represent are refused rather than written past the buffer or encoded wrongly.
+    const float values[5] = {1e9f, -1e9f, 21475.0f, NAN, INFINITY};
+    for (size_t i = 0; i < 5; i++) {
+        stream_t* stream = stream_create_from_list(2, 1.0, 2.0, 0.0, 0.0);
+        stream->data[2] = values[i];
+        assert_null(stream_to_polyline(stream));
+        stream->data[2] = 0.0f;
+        stream->data[3] = values[i];
+        assert_null(stream_to_polyline(stream));
+        stream_destroy(stream);
+    }
+    // The largest magnitudes still allowed round trip.
+    stream_t* stream = stream_create_from_list(2, 21474.0, -21474.0, -21474.0, 21474.0);
+    char* polyline = stream_to_polyline(stream);
+    assert_non_null(polyline);
+    stream_t* decoded = stream_from_polyline(polyline, strlen(polyline));
+    assert_non_null(decoded);
+    assert_memory_equal(decoded->data, stream->data, 4 * sizeof(float));
+    stream_destroy(decoded);
+    free(polyline);
+    stream_destroy(stream);
+}
+
+void polyline_batch_test() {
+    srand(2);
+    const size_t n = 50;
+    stream_collection_t* streams = stream_collection_create(n);
+    for (size_t i = 0; i < n; i++) {
+        streams->data[i] = random_walk(1 + (size_t) rand() % 300, 37.0, -122.0, 0.02, 0.02, 5);
+    }
+    char** polylines = stream_collection_to_polylines(streams, 4);
+    stream_collection_t* decoded = stream_collection_from_polylines((const char* const*) polylines, n, 3);
+    assert_non_null(decoded);
+    assert_int_equal(decoded->n, n);
+    for (size_t i = 0; i < n; i++) {
+        assert_int_equal(decoded->data[i]->n, streams->data[i]->n);
+        assert_memory_equal(decoded->data[i]->data, streams->data[i]->data, 2 * streams->data[i]->n * sizeof(float));
+    }
+    stream_collection_destroy(decoded);
+
+    polylines[17][0] = ' ';
+    assert_null(stream_collection_from_polylines((const char* const*) polylines, n, 3));
+    for (size_t i = 0; i < n; i++) {
+        free(polylines[i]);
+    }
+    free(polylines);
+    stream_collection_destroy(streams);
+}
+
+int main() {
+    const struct CMUnitTest tests[] = {
+            cmocka_unit_test(polyline_reference_test),
+            cmocka_unit_test(polyline_round_trip_test),
+            cmocka_unit_test(polyline_malformed_test),
+            cmocka_unit_test(polyline_unencodable_test),
+            cmocka_unit_test(polyline_batch_test),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,136 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <float.h>
+#include <math.h>
+
+#include <cstreamgeo/cstreamgeo.h>
+#include <cstreamgeo/quantized.h>
+
+#include "test.h"
+
+void quantize_round_trip_test() {
+    srand(1);
+    stream_t* stream = random_walk(1000, 37.0, -122.0, 1e-4, 1e-4, 6);
+    stream_quantized_t* quantized = stream_quantize(stream);
+    assert_int_equal(quantized->n, stream->n);
+    stream_t* back = stream_dequantize(quantized);
+    for (size_t i = 0; i < 2*stream->n; i++) {
+        assert_true(back->data[i] == stream->data[i]);
+    }
+    stream_destroy(back);
+    stream_quantized_destroy(quantized);
+    stream_destroy(stream);
+
+    // Near the origin floats are finer than a microdegree, so integers survive the trip instead.
+    stream_quantized_t* small = stream_quantized_create(4);
+    const int32_t values[8] = {0, 1, -1, 7999999, 5432109, -7654321, 123, -456};
+    for (size_t i = 0; i < 8; i++) {
+        small->data[i] = values[i];
+    }
+    stream_t* small_stream = stream_dequantize(small);
+    stream_quantized_t* small_back = stream_quantize(small_stream);
+    for (size_t i = 0; i < 8; i++) {
+        assert_int_equal(small_back->data[i], values[i]);
+    }
+    stream_quantized_destroy(small_back);
+    stream_destroy(small_stream);
+    stream_quantized_destroy(small);
+}
+
+void delta_round_trip_test() {
+    srand(2);
+    const size_t sizes[5] = {1, 63, 64, 65, 1000};
+    for (size_t s = 0; s < 5; s++) {
+        stream_t* stream = random_walk(sizes[s], 37.0, -122.0, 1e-3, 1e-3, 6);
+        stream_quantized_t* quantized = stream_quantize(stream);
+        stream_delta_t* delta = stream_delta_encode(quantized);
+        assert_int_equal(delta->n_blocks, (sizes[s] + STREAM_DELTA_BLOCK - 1) / STREAM_DELTA_BLOCK);
+        stream_quantized_t* decoded = stream_delta_decode(delta);
+        for (size_t i = 0; i < 2*quantized->n; i++) {
+            assert_int_equal(decoded->data[i], quantized->data[i]);
+        }
+        if (sizes[s] == 1000) {
+            assert_true(stream_delta_size(delta) < sizes[s] * 2 * sizeof(float) * 6 / 10);
+        }
+        stream_quantized_destroy(decoded);
+        stream_delta_destroy(delta);
+        stream_quantized_destroy(quantized);
+        stream_destroy(stream);
+    }
+
+    // Jumps too large for int16 start new blocks.
+    stream_quantized_t* jumpy = stream_quantized_create(5);
+    const int32_t values[10] = {0, 0, 32767, -32768, 0, 0, 180000000, -180000000, 180000001, -180000001};
+    for (size_t i = 0; i < 10; i++) {
+        jumpy->data[i] = values[i];
+    }
+    stream_delta_t* delta = stream_delta_encode(jumpy);
+    assert_int_equal(delta->n_blocks, 3);
+    stream_quantized_t* decoded = stream_delta_decode(delta);
+    for (size_t i = 0; i < 10; i++) {
+        assert_int_equal(decoded->data[i], values[i]);
+    }
+    stream_quantized_destroy(decoded);
+    stream_delta_destroy(delta);
+    stream_quantized_destroy(jumpy);
+}
+
+void quantized_kernels_test() {
+    srand(3);
+    const size_t sizes[4] = {2, 7, 33, 250};
+    for (size_t s = 0; s < 4; s++) {
+        stream_t* a = random_walk(sizes[s], 37.0, -122.0, 1e-4, 1e-4, 6);
+        stream_t* b = random_walk(sizes[s] + 3, 37.0, -122.0, 1e-4, 1e-4, 6);
+        stream_quantized_t* qa = stream_quantize(a);
+        stream_quantized_t* qb = stream_quantize(b);
+
+        // At this step size float coordinates are too coarse for stream_distance to be a useful reference.
+        double distance = 0.0;
+        for (size_t i = 0; i + 1 < qa->n; i++) {
+            const double lat_diff = (qa->data[2*i+2] - qa->data[2*i]) / 1e6;
+            const double lng_diff = (qa->data[2*i+3] - qa->data[2*i+1]) / 1e6;
+            distance += sqrt(lat_diff * lat_diff + lng_diff * lng_diff);
+        }
+        assert_true(fabs(stream_quantized_distance(qa) - distance) <= 1e-5 * distance);
+
+        // Reference row sweep with the scalar local cost; the SIMD kernels must match it exactly.
+        float prev[qb->n + 1];
+        float curr[qb->n + 1];
+        for (size_t col = 0; col <= qb->n; col++) {
+            prev[col] = FLT_MAX;
+        }
+        prev[0] = 0;
+        for (size_t row = 0; row < qa->n; row++) {
+            curr[0] = FLT_MAX;
+            for (size_t col = 0; col < qb->n; col++) {
+                const float lat_diff = (float) (qb->data[2*col] - qa->data[2*row]) * 1e-6f;
+                const float lng_diff = (float) (qb->data[2*col+1] - qa->data[2*row+1]) * 1e-6f;
+                const float dt = (lat_diff * lat_diff) + (lng_diff * lng_diff);
+                const float best = (prev[col] <= prev[col+1] && prev[col] <= curr[col]) ? prev[col] :
+                                   (prev[col+1] <= curr[col]) ? prev[col+1] : curr[col];
+                curr[col+1] = dt + best;
+            }
+            for (size_t col = 0; col <= qb->n; col++) {
+                prev[col] = curr[col];
+            }
+        }
+        const float cost = quantized_dtw_cost(qa, qb);
+        assert_true(cost == prev[qb->n]);
+
+        stream_quantized_destroy(qb);
+        stream_quantized_destroy(qa);
+        stream_destroy(b);
+        stream_destroy(a);
+    }
+}
+
+int main() {
+    const struct CMUnitTest tests[] = {
+            cmocka_unit_test(quantize_round_trip_test),
+            cmocka_unit_test(delta_round_trip_test),
+            cmocka_unit_test(quantized_kernels_test),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
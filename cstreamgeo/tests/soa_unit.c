@@ -0,0 +1,84 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include <cstreamgeo/cstreamgeo.h>
+#include <cstreamgeo/soa.h>
+
+#include "test.h"
+
+void soa_round_trip_test() {
+    srand(1);
+    const size_t sizes[4] = {1, 15, 16, 1001};
+    for (size_t s = 0; s < 4; s++) {
+        stream_t* stream = random_walk(sizes[s], 37.0, -122.0, 1e-4, 1e-4, -1);
+        stream_soa_t* soa = stream_soa_from_stream(stream);
+        assert_int_equal(soa->n, stream->n);
+        assert_int_equal(((uintptr_t) soa->lat) % 64, 0);
+        assert_int_equal(((uintptr_t) soa->lng) % 64, 0);
+        for (size_t i = 0; i < stream->n; i++) {
+            assert_true(soa->lat[i] == stream->data[2*i]);
+            assert_true(soa->lng[i] == stream->data[2*i+1]);
+        }
+        stream_t* back = stream_soa_to_stream(soa);
+        for (size_t i = 0; i < 2*stream->n; i++) {
+            assert_true(back->data[i] == stream->data[i]);
+        }
+        stream_destroy(back);
+        stream_soa_destroy(soa);
+        stream_destroy(stream);
+    }
+}
+
+void soa_distance_and_sparsity_test() {
+    srand(2);
+    const size_t sizes[4] = {2, 17, 100, 5003};
+    for (size_t s = 0; s < 4; s++) {
+        stream_t* stream = random_walk(sizes[s], 37.0, -122.0, 1e-4, 1e-4, -1);
+        stream_soa_t* soa = stream_soa_from_stream(stream);
+        const float expected = stream_distance(stream);
+        assert_true(fabsf(stream_soa_distance(soa) - expected) <= 1e-5f * expected);
+        float* expected_sparsity = stream_sparsity_create(stream);
+        float* sparsity = stream_soa_sparsity_create(soa);
+        for (size_t i = 0; i < stream->n; i++) {
+            assert_true(fabsf(sparsity[i] - expected_sparsity[i]) <= 1e-4f);
+        }
+        free(expected_sparsity);
+        free(sparsity);
+        stream_soa_destroy(soa);
+        stream_destroy(stream);
+    }
+}
+
+void dtw_local_cost_row_test() {
+    // Must be bit-identical to the scalar DTW local cost, including vector tails at every offset.
+    srand(3);
+    stream_t* stream = random_walk(53, 37.0, -122.0, 1e-4, 1e-4, -1);
+    stream_soa_t* soa = stream_soa_from_stream(stream);
+    float out[53];
+    const float lat = 37.001f;
+    const float lng = -122.0005f;
+    for (size_t start = 0; start < 20; start++) {
+        for (size_t count = 0; start + count <= stream->n; count += 7) {
+            dtw_local_cost_row(soa, lat, lng, start, count, out);
+            for (size_t k = 0; k < count; k++) {
+                const float lat_diff = stream->data[2*(start + k)] - lat;
+                const float lng_diff = stream->data[2*(start + k) + 1] - lng;
+                assert_true(out[k] == (lng_diff * lng_diff) + (lat_diff * lat_diff));
+            }
+        }
+    }
+    stream_soa_destroy(soa);
+    stream_destroy(stream);
+}
+
+int main() {
+    const struct CMUnitTest tests[] = {
+            cmocka_unit_test(soa_round_trip_test),
+            cmocka_unit_test(soa_distance_and_sparsity_test),
+            cmocka_unit_test(dtw_local_cost_row_test),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -1,8 +1,11 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <math.h>
 
 #include <cstreamgeo/cstreamgeo.h>
+#include <cstreamgeo/io.h>
 
 #include "test.h"
 
@@ -124,6 +127,236 @@ void compute_ramer_douglas_peucker_test_duplicates() {
     stream_destroy(stream);
 }
 
+// The original recursive Ramer-Douglas-Peucker; downsample_rdp must keep exactly the same points.
+void recursive_rdp_reference(const float* data, const size_t start, const size_t end, const float epsilon,
+                             unsigned char* keep) {
+    const float sx = data[2*start], sy = data[2*start+1], ex = data[2*end], ey = data[2*end+1];
+    float d_max = 0.0f;
+    size_t index_max = start;
+    for (size_t i = start + 1; i < end; i++) {
+        const float px = data[2*i], py = data[2*i+1];
+        const float d = (sx == ex && sy == ey) ?
+                        (px - sx) * (px - sx) + (py - sy) * (py - sy) :
+                        fabsf((ex - sx) * (sy - py) - (sx - px) * (ey - sy)) /
+                        sqrtf((ex - sx) * (ex - sx) + (ey - sy) * (ey - sy));
+        if (d > d_max) {
+            index_max = i;
+            d_max = d;
+        }
+    }
+    if (d_max > epsilon) {
+        if (index_max - start > 1) {
+            recursive_rdp_reference(data, start, index_max, epsilon, keep);
+        }
+        keep[index_max] = 1;
+        if (end - index_max > 1) {
+            recursive_rdp_reference(data, index_max, end, epsilon, keep);
+        }
+    }
+}
+
+void compute_ramer_douglas_peucker_test_matches_recursive() {
+    srand(5);
+    const size_t n = 20000;
+    unsigned char* keep = malloc(n);
+    for (size_t shape = 0; shape < 3; shape++) {
+        stream_t* stream = stream_create(n);
+        for (size_t i = 0; i < n; i++) {
+            const float t = (float) i;
+            if (shape == 0) {         // Random walk
+                stream->data[2*i] = (i == 0) ? 0.0f : stream->data[2*i-2] + (float) rand() / RAND_MAX - 0.5f;
+                stream->data[2*i+1] = (i == 0) ? 0.0f : stream->data[2*i-1] + (float) rand() / RAND_MAX - 0.5f;
+            } else if (shape == 1) {  // Laps of a track, with noise and repeated points
+                stream->data[2*i] = 100.0f * cosf(t * 0.01f) + (float) (rand() % 3);
+                stream->data[2*i+1] = 50.0f * sinf(t * 0.01f);
+            } else {                  // Inward spiral, which makes every split very uneven
+                stream->data[2*i] = (float) (n - i) * cosf(t * 0.05f);
+                stream->data[2*i+1] = (float) (n - i) * sinf(t * 0.05f);
+            }
+        }
+        const float epsilons[4] = {0.0f, 0.5f, 2.0f, 30.0f};
+        for (size_t e = 0; e < 4; e++) {
+            memset(keep, 0, n);
+            keep[0] = keep[n-1] = 1;
+            recursive_rdp_reference(stream->data, 0, n - 1, epsilons[e], keep);
+            stream_t* copy = stream_create(n);
+            memcpy(copy->data, stream->data, 2 * n * sizeof(float));
+            downsample_rdp(copy, epsilons[e]);
+            size_t kept = 0;
+            for (size_t i = 0; i < n; i++) {
+                if (keep[i]) {
+                    assert_true(kept < copy->n);
+                    assert_memory_equal(copy->data + 2*kept, stream->data + 2*i, 2 * sizeof(float));
+                    kept++;
+                }
+            }
+            assert_int_equal(copy->n, kept);
+            stream_destroy(copy);
+        }
+        stream_destroy(stream);
+    }
+    free(keep);
+}
+
+void radial_distance_test_small() {
+    size_t a_n = 7;
+    stream_t* stream = stream_create_from_list(a_n,
+                                                     0.0, 0.0,
+                                                     0.5, 0.0, // disappears
+                                                     1.5, 0.0,
+                                                     2.0, 0.5, // disappears
+                                                     2.0, 0.8, // disappears
+                                                     4.0, 0.0,
+                                                     4.5, 0.0  // last point, always kept
+    );
+    stream_t* copy = downsample_radial_distance(stream, 1.0);
+    downsample_radial_distance_in_place(stream, 1.0);
+    assert_int_equal(stream->n, 4);
+    assert_int_equal(copy->n, 4);
+    float correct[8] = {0.0, 0.0, 1.5, 0.0, 4.0, 0.0, 4.5, 0.0};
+    for (int i = 0; i < 8; i++) {
+        assert_true(stream->data[i] == correct[i]);
+        assert_true(copy->data[i] == correct[i]);
+    }
+    stream_destroy(copy);
+    stream_destroy(stream);
+}
+
+// Reference radial-distance simplification, one point at a time.
+size_t radial_distance_reference(const stream_t* input, const float epsilon, size_t* kept) {
+    size_t n = 0;
+    size_t anchor = 0;
+    kept[n++] = 0;
+    for (size_t i = 1; i + 1 < input->n; i++) {
+        const float lat_diff = input->data[2*i] - input->data[2*anchor];
+        const float lng_diff = input->data[2*i+1] - input->data[2*anchor+1];
+        if (sqrtf((lat_diff * lat_diff) + (lng_diff * lng_diff)) > epsilon) {
+            kept[n++] = anchor = i;
+        }
+    }
+    kept[n++] = input->n - 1;
+    return n;
+}
+
+void radial_distance_test_random() {
+    srand(4);
+    const size_t sizes[5] = {1, 2, 3, 37, 5000};
+    const float epsilons[3] = {0.0f, 2.5f, 40.0f};
+    size_t* kept = malloc(5000 * sizeof(size_t));
+    stream_collection_t* collection = stream_collection_create(5);
+    for (size_t s = 0; s < 5; s++) {
+        stream_t* stream = stream_create(sizes[s]);
+        for (size_t i = 0; i < 2 * sizes[s]; i++) {
+            stream->data[i] = (i < 2) ? 0.0f : stream->data[i - 2] + (float) rand() / RAND_MAX - 0.3f;
+        }
+        for (size_t e = 0; e < 3; e++) {
+            const size_t n = (stream->n <= 2) ? stream->n : radial_distance_reference(stream, epsilons[e], kept);
+            stream_t* simplified = downsample_radial_distance(stream, epsilons[e]);
+            assert_int_equal(simplified->n, n);
+            for (size_t i = 0; i < n; i++) {
+                const size_t k = (stream->n <= 2) ? i : kept[i];
+                assert_true(simplified->data[2*i] == stream->data[2*k]);
+                assert_true(simplified->data[2*i+1] == stream->data[2*k+1]);
+            }
+            stream_destroy(simplified);
+        }
+        collection->data[s] = stream;
+    }
+    // The batch version must agree with the single-stream one.
+    stream_t* expected[5];
+    for (size_t s = 0; s < 5; s++) {
+        expected[s] = downsample_radial_distance(collection->data[s], 2.5f);
+    }
+    downsample_radial_distance_collection(collection, 2.5f, 4);
+    for (size_t s = 0; s < 5; s++) {
+        assert_int_equal(collection->data[s]->n, expected[s]->n);
+        assert_memory_equal(collection->data[s]->data, expected[s]->data, 2 * expected[s]->n * sizeof(float));
+        stream_destroy(expected[s]);
+    }
+    stream_collection_destroy(collection);
+    free(kept);
+}
+
+void downsample_to_count_test_small() {
+    size_t a_n = 6;
+    stream_t* stream = stream_create_from_list(a_n,
+                                                     0.0, 0.0,
+                                                     1.0, 0.1, // disappears first: smallest triangle
+                                                     2.0, 0.0,
+                                                     3.0, 5.0,
+                                                     4.0, 0.5, // disappears second
+                                                     6.0, 0.0
+    );
+    downsample_to_count(stream, 10);
+    assert_int_equal(stream->n, 6);
+    downsample_to_count(stream, 4);
+    assert_int_equal(stream->n, 4);
+    float correct[8] = {0.0, 0.0, 2.0, 0.0, 3.0, 5.0, 6.0, 0.0};
+    for (int i = 0; i < 8; i++) {
+        assert_true(stream->data[i] == correct[i]);
+    }
+    downsample_to_count(stream, 0);
+    assert_int_equal(stream->n, 2);
+    assert_true(stream->data[0] == 0.0f && stream->data[3] == 0.0f && stream->data[2] == 6.0f);
+    stream_destroy(stream);
+}
+
+// Quadratic Visvalingam-Whyatt: rescan every surviving interior point for the smallest area at each step.
+size_t visvalingam_reference(const float* data, const size_t n, const size_t k, unsigned char* alive) {
+    memset(alive, 1, n);
+    size_t remaining = n;
+    while (remaining > k) {
+        size_t best = 0, a = 0;
+        float best_area = INFINITY;
+        for (size_t i = 1; i + 1 < n; i++) {
+            if (!alive[i]) {
+                continue;
+            }
+            size_t c = i + 1;
+            while (!alive[c]) c++;
+            const float area = fabsf((data[2*i] - data[2*a]) * (data[2*c+1] - data[2*a+1]) -
+                                     (data[2*c] - data[2*a]) * (data[2*i+1] - data[2*a+1]));
+            if (area < best_area) {
+                best = i;
+                best_area = area;
+            }
+            a = i;
+        }
+        alive[best] = 0;
+        remaining--;
+    }
+    return remaining;
+}
+
+void downsample_to_count_test_matches_reference() {
+    srand(6);
+    const size_t n = 400;
+    unsigned char* alive = malloc(n);
+    stream_t* stream = stream_create(n);
+    for (size_t i = 0; i < 2 * n; i++) {
+        // Coarse integer steps, so many triangles tie on area.
+        stream->data[i] = (i < 2) ? 0.0f : stream->data[i - 2] + (float) (rand() % 5) - 2.0f;
+    }
+    const size_t targets[5] = {399, 200, 37, 3, 2};
+    for (size_t t = 0; t < 5; t++) {
+        const size_t kept = visvalingam_reference(stream->data, n, targets[t], alive);
+        stream_t* copy = stream_create(n);
+        memcpy(copy->data, stream->data, 2 * n * sizeof(float));
+        downsample_to_count(copy, targets[t]);
+        assert_int_equal(copy->n, kept);
+        size_t j = 0;
+        for (size_t i = 0; i < n; i++) {
+            if (alive[i]) {
+                assert_memory_equal(copy->data + 2*j, stream->data + 2*i, 2 * sizeof(float));
+                j++;
+            }
+        }
+        stream_destroy(copy);
+    }
+    stream_destroy(stream);
+    free(alive);
+}
+
 int main() {
     const struct CMUnitTest tests[] = {
             cmocka_unit_test(create_from_list_test),
@@ -132,7 +365,12 @@ int main() {
             cmocka_unit_test(compute_sparsity_unevenly_spaced_test),
             cmocka_unit_test(compute_ramer_douglas_peucker_test_small),
             cmocka_unit_test(compute_ramer_douglas_peucker_test_medium),
-            cmocka_unit_test(compute_ramer_douglas_peucker_test_duplicates)
+            cmocka_unit_test(compute_ramer_douglas_peucker_test_duplicates),
+            cmocka_unit_test(compute_ramer_douglas_peucker_test_matches_recursive),
+            cmocka_unit_test(radial_distance_test_small),
+            cmocka_unit_test(radial_distance_test_random),
+            cmocka_unit_test(downsample_to_count_test_small),
+            cmocka_unit_test(downsample_to_count_test_matches_reference)
     };
 
     return cmocka_run_group_tests(tests, NULL, NULL);
@@ -398,6 +398,68 @@ void expand_radius_two_row_col_parity_test() {
     strided_mask_destroy(expanded);
 }
 
+// A window is usable for DTW if runs are monotone, it covers both corners, and consecutive runs connect.
+void assert_window_valid(const strided_mask_t* mask) {
+    const size_t n_rows = mask->n_rows;
+    assert_int_equal(mask->start_cols[0], 0);
+    assert_int_equal(mask->end_cols[n_rows - 1], mask->n_cols - 1);
+    for (size_t row = 0; row < n_rows; row++) {
+        assert_true(mask->start_cols[row] <= mask->end_cols[row]);
+        assert_true(mask->end_cols[row] < mask->n_cols);
+        if (row > 0) {
+            assert_true(mask->start_cols[row - 1] <= mask->start_cols[row]);
+            assert_true(mask->end_cols[row - 1] <= mask->end_cols[row]);
+            assert_true(mask->start_cols[row] <= mask->end_cols[row - 1] + 1);
+        }
+    }
+}
+
+void sakoe_chiba_test() {
+    const size_t shapes[5][2] = {{1, 1}, {1, 7}, {7, 1}, {5, 9}, {40, 13}};
+    for (size_t s = 0; s < 5; s++) {
+        for (size_t band = 0; band < 4; band++) {
+            strided_mask_t* mask = strided_mask_create_sakoe_chiba(shapes[s][0], shapes[s][1], band);
+            assert_window_valid(mask);
+            strided_mask_destroy(mask);
+        }
+    }
+    strided_mask_t* mask = strided_mask_create_sakoe_chiba(5, 9, 1);
+    strided_mask_printf(mask);
+    const size_t start_cols[5] = {0, 1, 3, 5, 7};
+    const size_t end_cols[5] = {1, 3, 5, 7, 8};
+    for (size_t row = 0; row < 5; row++) {
+        assert_int_equal(mask->start_cols[row], start_cols[row]);
+        assert_int_equal(mask->end_cols[row], end_cols[row]);
+    }
+    strided_mask_destroy(mask);
+    // A band at least as wide as the matrix covers all of it.
+    mask = strided_mask_create_sakoe_chiba_fraction(20, 30, 1.0f);
+    for (size_t row = 0; row < 20; row++) {
+        assert_int_equal(mask->start_cols[row], 0);
+        assert_int_equal(mask->end_cols[row], 29);
+    }
+    strided_mask_destroy(mask);
+}
+
+void itakura_test() {
+    const size_t shapes[5][2] = {{1, 1}, {1, 7}, {7, 1}, {9, 9}, {40, 13}};
+    const float slopes[3] = {1.0f, 1.5f, 2.0f};
+    for (size_t s = 0; s < 5; s++) {
+        for (size_t k = 0; k < 3; k++) {
+            strided_mask_t* mask = strided_mask_create_itakura(shapes[s][0], shapes[s][1], slopes[k]);
+            assert_window_valid(mask);
+            strided_mask_destroy(mask);
+        }
+    }
+    // Narrow at the corners, widest in the middle.
+    strided_mask_t* mask = strided_mask_create_itakura(9, 9, 2.0f);
+    strided_mask_printf(mask);
+    assert_int_equal(mask->end_cols[0] - mask->start_cols[0], 0);
+    assert_int_equal(mask->end_cols[8] - mask->start_cols[8], 0);
+    assert_true(mask->end_cols[4] - mask->start_cols[4] >= 4);
+    strided_mask_destroy(mask);
+}
+
 int main() {
     const struct CMUnitTest tests[] = {
         cmocka_unit_test(create_test),
@@ -412,6 +474,8 @@ int main() {
         cmocka_unit_test(expand_radius_one_row_col_parity_test),
         cmocka_unit_test(expand_radius_two_test),
         cmocka_unit_test(expand_radius_two_row_col_parity_test),
+        cmocka_unit_test(sakoe_chiba_test),
+        cmocka_unit_test(itakura_test),
     };
 
     return cmocka_run_group_tests(tests, NULL, NULL);
@@ -2,6 +2,30 @@
 #include <stdarg.h>
 #include <stddef.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
 #include "vendor/cmocka/cmocka.h"
 
+#include <cstreamgeo/cstreamgeo.h>
+
 #define DESCRIBE_TEST fprintf(stderr, "--- %s\n", __func__)
+
+// A random walk of n points starting from (lat, lng), each move drawn uniformly from [-step/2, step/2) per coordinate.
+// With digits >= 0 the walk stays on a grid of that many decimal digits, like our source data; positions are kept as
+// whole multiples of the grid so rounding never accumulates. Pass a negative digits for no grid.
+static inline stream_t* random_walk(const size_t n, const double lat, const double lng,
+                                    const double lat_step, const double lng_step, const int digits) {
+    stream_t* stream = stream_create(n);
+    const double scale = (digits < 0) ? 1.0 : pow(10.0, digits);
+    double y = (digits < 0) ? lat : round(lat * scale);
+    double x = (digits < 0) ? lng : round(lng * scale);
+    for (size_t i = 0; i < n; i++) {
+        const double dy = lat_step * scale * ((double) rand() / RAND_MAX - 0.5);
+        const double dx = lng_step * scale * ((double) rand() / RAND_MAX - 0.5);
+        y += (digits < 0) ? dy : round(dy);
+        x += (digits < 0) ? dx : round(dx);
+        stream->data[2*i] = (float) (y / scale);
+        stream->data[2*i+1] = (float) (x / scale);
+    }
+    return stream;
+}
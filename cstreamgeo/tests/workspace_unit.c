@@ -0,0 +1,81 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <cstreamgeo/workspace.h>
+
+#include "test.h"
+
+void workspace_alignment_test() {
+    streamgeo_workspace_t* ws = streamgeo_workspace_create(0);
+    const size_t sizes[5] = {1, 3, 64, 65, 1000};
+    for (size_t i = 0; i < 5; i++) {
+        unsigned char* ptr = streamgeo_workspace_alloc(ws, sizes[i]);
+        assert_int_equal(((uintptr_t) ptr) % 64, 0);
+        memset(ptr, 0xAB, sizes[i]);
+    }
+    streamgeo_workspace_destroy(ws);
+}
+
+void workspace_growth_and_reset_test() {
+    streamgeo_workspace_t* ws = streamgeo_workspace_create(256);
+    assert_int_equal(streamgeo_workspace_capacity(ws), 256);
+    // Overflow the first block several times over; earlier allocations must stay intact.
+    unsigned char* first = streamgeo_workspace_alloc(ws, 200);
+    memset(first, 1, 200);
+    for (size_t i = 0; i < 10; i++) {
+        unsigned char* ptr = streamgeo_workspace_alloc(ws, 500);
+        memset(ptr, 2, 500);
+    }
+    for (size_t i = 0; i < 200; i++) {
+        assert_int_equal(first[i], 1);
+    }
+    const size_t capacity = streamgeo_workspace_capacity(ws);
+    assert_true(capacity >= 256 + 10 * 512);
+    // Reset coalesces the chain into one block of the same total size, so the same workload no longer grows it.
+    streamgeo_workspace_reset(ws);
+    assert_int_equal(streamgeo_workspace_capacity(ws), capacity);
+    streamgeo_workspace_alloc(ws, 200);
+    for (size_t i = 0; i < 10; i++) {
+        streamgeo_workspace_alloc(ws, 500);
+    }
+    assert_int_equal(streamgeo_workspace_capacity(ws), capacity);
+    streamgeo_workspace_destroy(ws);
+}
+
+void workspace_mark_release_test() {
+    streamgeo_workspace_t* ws = streamgeo_workspace_create(1024);
+    unsigned char* kept = streamgeo_workspace_alloc(ws, 100);
+    const streamgeo_workspace_mark_t mark = streamgeo_workspace_mark(ws);
+    unsigned char* scratch = streamgeo_workspace_alloc(ws, 100);
+    streamgeo_workspace_alloc(ws, 4000); // Spills into a new block
+    const size_t capacity = streamgeo_workspace_capacity(ws);
+    streamgeo_workspace_release(ws, mark);
+    // Memory after the mark is handed out again, and the spilled block is kept as a spare.
+    assert_ptr_equal(streamgeo_workspace_alloc(ws, 100), scratch);
+    streamgeo_workspace_alloc(ws, 4000);
+    assert_int_equal(streamgeo_workspace_capacity(ws), capacity);
+    assert_true(kept != scratch);
+    streamgeo_workspace_destroy(ws);
+}
+
+void workspace_null_is_heap_test() {
+    // A NULL workspace falls back to malloc/free, and marks are no-ops.
+    const streamgeo_workspace_mark_t mark = streamgeo_workspace_mark(NULL);
+    void* ptr = streamgeo_workspace_alloc(NULL, 128);
+    assert_non_null(ptr);
+    streamgeo_workspace_release(NULL, mark);
+    streamgeo_workspace_free(NULL, ptr);
+}
+
+int main() {
+    const struct CMUnitTest tests[] = {
+            cmocka_unit_test(workspace_alignment_test),
+            cmocka_unit_test(workspace_growth_and_reset_test),
+            cmocka_unit_test(workspace_mark_release_test),
+            cmocka_unit_test(workspace_null_is_heap_test),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -12,7 +12,11 @@ if (SANITIZE)
     endif ()
 endif ()
 
-set(OPT_FLAGS "-march=native")
+if (BUILD_PORTABLE) # SIMD kernels are selected at runtime, so the library does not need to target the build machine
+    set(OPT_FLAGS "")
+else ()
+    set(OPT_FLAGS "-march=native")
+endif ()
 
 if (FORCE_AVX) # some compilers like clang do not automagically define __AVX3__ and __BMI2__ even when the hardware supports it
     set(OPT_FLAGS "${OPT_FLAGS} -mavx2 -mbmi2")